@@ -3,6 +3,29 @@
 
 #include "linx_size_define.h"
 
+/**
+ * 事件头之后可选附带的上下文段
+ * 由 linx_apd.yaml 中的 engine.ebpf.event_context 决定附带哪些
+ */
+typedef enum {
+    LINX_EVENT_CONTEXT_CMDLINE      = 1 << 0,   /* 执行的命令行 */
+    LINX_EVENT_CONTEXT_FULLPATH     = 1 << 1,   /* 命令的绝对路径 */
+    LINX_EVENT_CONTEXT_P_FULLPATH   = 1 << 2,   /* 父进程的绝对路径 */
+    LINX_EVENT_CONTEXT_FDS          = 1 << 3,   /* 和当前任务关联的fd及其路径 */
+} linx_event_context_type_t;
+
+/**
+ * 每个上下文段的头，之后紧跟 len 字节的数据
+ * FDS 段的数据为若干个 uint32_t fd + 以'\0'结尾的路径
+ */
+typedef struct {
+    uint16_t    type;                                           /* linx_event_context_type_t */
+    uint16_t    len;                                            /* 数据长度 */
+} linx_event_context_t;
+
+/**
+ * 事件布局为：事件头 + 上下文段(context_size 字节) + 参数
+ */
 typedef struct {
     uint64_t    tid;                                            /* tid */
     uint64_t    pid;                                            /* pid */
@@ -13,15 +36,47 @@ typedef struct {
     uint64_t    res;                                            /* 返回值 */
     uint32_t    type;                                           /* 标识事件类型 */
     uint32_t    nparams;                                        /* 参数个数 */
-    uint32_t    nfds;                                           /* 当前有效的fd个数 */
-    uint32_t    fds[LINX_FDS_MAX_SIZE];                         /* 和当前任务关联的fd */
-    char        fd_path[LINX_FDS_MAX_SIZE][LINX_PATH_MAX_SIZE]; /* fd对应的路径 */
+    uint32_t    context_mask;                                   /* 附带了哪些上下文段 */
+    uint32_t    context_size;                                   /* 上下文段的总长度 */
     char        comm[LINX_COMM_MAX_SIZE];                       /* 执行的命令 */
-    char        cmdline[LINX_CMDLINE_MAX_SIZE];                 /* 执行的命令 */
-    char        fullpath[LINX_PATH_MAX_SIZE];                   /* 命令的绝对路径 */
-    char        p_fullpath[LINX_PATH_MAX_SIZE];                 /* 父进程的绝对路径 */
-    uint64_t    params_size[SYSCALL_PARAMS_MAX_COUNT];          /* 参数的长度 */
-    uint64_t    size;                                           /* 事件总大小(头+参数) */
+    uint32_t    params_size[SYSCALL_PARAMS_MAX_COUNT];          /* 参数的长度 */
+    uint64_t    size;                                           /* 事件总大小(头+上下文+参数) */
 } linx_event_t;
 
+/**
+ * 获取事件第一个参数的位置
+ */
+static inline void *linx_event_params(linx_event_t *event)
+{
+    return (uint8_t *)event + LINX_EVENT_HEADER_SIZE + event->context_size;
+}
+
+/**
+ * 查找事件附带的某个上下文段，不存在时返回NULL
+ */
+static inline const char *linx_event_context(linx_event_t *event, uint32_t type, uint16_t *len)
+{
+    uint8_t *pos = (uint8_t *)event + LINX_EVENT_HEADER_SIZE;
+    uint8_t *end = pos + event->context_size;
+    linx_event_context_t *context;
+
+    if (!(event->context_mask & type)) {
+        return NULL;
+    }
+
+    while (pos + sizeof(linx_event_context_t) <= end) {
+        context = (linx_event_context_t *)pos;
+        if (context->type == type) {
+            if (len) {
+                *len = context->len;
+            }
+            return (const char *)(context + 1);
+        }
+
+        pos += sizeof(linx_event_context_t) + context->len;
+    }
+
+    return NULL;
+}
+
 #endif /* __LINX_EVENT_H__ */
@@ -714,6 +714,8 @@ typedef enum {
     LINX_EVENT_TYPE_CACHESTAT_X = 903,
     LINX_EVENT_TYPE_FCHMODAT2_E = 904,
     LINX_EVENT_TYPE_FCHMODAT2_X = 905,
+    LINX_EVENT_TYPE_PROC_SNAPSHOT = 906,
+    LINX_EVENT_TYPE_PROC_EXIT = 907,
     LINX_EVENT_TYPE_MAX
 } linx_event_type_t;
 
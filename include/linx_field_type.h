@@ -1,6 +1,10 @@
 #ifndef __LINX_FIELD_TYPE_H__
 #define __LINX_FIELD_TYPE_H__ 
 
+#include <stdint.h>
+
+#define LINX_FIELD_ARGS_MAX     32
+
 typedef enum {
     LINX_FIELD_TYPE_UNKNOWN = 0,
     LINX_FIELD_TYPE_INT8,
@@ -23,7 +27,25 @@ typedef enum {
     LINX_FIELD_TYPE_PID,
     LINX_FIELD_TYPE_SOCKTUPLE,
     LINX_FIELD_TYPE_STRUCT,             /* 结构体指针，用于带参数的字段解析 */
+    LINX_FIELD_TYPE_CHARBUF_REF,        /* 字符串指针，字符串之前紧跟 uint32_t 长度 */
     LINX_FIELD_TYPE_MAX
 } linx_field_type_t;
 
+/**
+ * 带参数的字段(如 evt.arg)指向的参数表，参数指针之后是每个参数的长度
+ * 字符串参数的长度不含结尾的 '\0'，匹配时不需要再计算长度
+*/
+typedef struct {
+    void *data[LINX_FIELD_ARGS_MAX];
+    uint32_t len[LINX_FIELD_ARGS_MAX];
+} linx_field_args_t;
+
+/**
+ * LINX_FIELD_TYPE_CHARBUF_REF 字段指向的字符串长度，不含结尾的 '\0'
+*/
+static inline uint32_t linx_field_charbuf_ref_len(const char *str)
+{
+    return ((const uint32_t *)str)[-1];
+}
+
 #endif /* __LINX_FIELD_TYPE_H__ */
@@ -46,6 +46,11 @@
  */
 #define LINX_CHARBUF_MAX_SIZE       (4096)
 
+/**
+ * 内核中缓存的进程上下文的最大数量
+ */
+#define LINX_PROC_CTX_MAX_SIZE          (32768)
+
 /**
  * 可过滤PID的最大数量
  */
@@ -54,7 +59,12 @@
 /**
  * 可过滤COMM的最大数量
  */
-#define LINX_BPF_FILTER_COMM_MAX_SIZE   (16)
+#define LINX_BPF_FILTER_COMM_MAX_SIZE   (256)
+
+/**
+ * 可过滤UID的最大数量
+ */
+#define LINX_BPF_FILTER_UID_MAX_SIZE    (64)
 
 /**
  * 网络相关的长度定义
@@ -361,4 +361,25 @@ typedef enum {
     LINX_SYSCALL_ID_MAX
 } linx_syscall_id_t;
 
+/**
+ * 应用层根据这些系统调用的退出事件维护进程缓存
+ * 规则下推不能去掉它们，comm 和 uid 过滤也不能过滤它们的退出事件
+*/
+static inline int linx_syscall_is_proc_lifecycle(long syscall_id)
+{
+    switch (syscall_id) {
+    case LINX_SYSCALL_ID_CLONE:
+    case LINX_SYSCALL_ID_CLONE3:
+    case LINX_SYSCALL_ID_FORK:
+    case LINX_SYSCALL_ID_VFORK:
+    case LINX_SYSCALL_ID_EXECVE:
+    case LINX_SYSCALL_ID_EXECVEAT:
+    case LINX_SYSCALL_ID_CHDIR:
+    case LINX_SYSCALL_ID_FCHDIR:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
 #endif /* __LINX_SYSCALL_ID_H__ */
@@ -22,4 +22,14 @@ typedef enum {
     LINX_SYSCALL_TYPE_MAX
 } linx_syscall_type_t;
 
+/**
+ * 内核中 pid/comm 过滤表的工作方式
+ */
+typedef enum {
+    LINX_FILTER_MODE_NONE = 0,      /* 不过滤 */
+    LINX_FILTER_MODE_EXCLUDE = 1,   /* 丢弃表中的 pid/comm */
+    LINX_FILTER_MODE_INCLUDE = 2,   /* 只采集表中的 pid/comm */
+    LINX_FILTER_MODE_MAX
+} linx_filter_mode_t;
+
 #endif /* __LINX_TYPE_H__ */
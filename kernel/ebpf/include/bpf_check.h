@@ -3,41 +3,57 @@
 
 #include "maps.h"
 
-static inline int check_pid_need_filtered(uint32_t pid)
+static inline int check_filter_mode(uint8_t mode, bool found)
 {
-    for (int i = 0; i < LINX_BPF_FILTER_PID_MAX_SIZE && g_filter_pids[i]; ++i) {
-        if (pid == g_filter_pids[i]) {
-            return -1;
-        }
+    if (mode == LINX_FILTER_MODE_EXCLUDE) {
+        return found;
+    } else if (mode == LINX_FILTER_MODE_INCLUDE) {
+        return !found;
     }
 
     return 0;
 }
 
-static inline int check_comm_need_filtered(const char *comm)
+static inline int check_pid_need_filtered(void)
 {
-    int flag = 0;
-
-    for (int i = 0; 
-         i < LINX_BPF_FILTER_COMM_MAX_SIZE &&
-         g_filter_comms[i][0] != 0; 
-         ++i)
-    {
-        for (int j = 0; j < LINX_COMM_MAX_SIZE; ++j) {
-            if (comm[j] != g_filter_comms[i][j]) {
-                flag = 0;
-                break;
-            } else {
-                flag = 1;
-            }
-        }
-
-        if (flag) {
-            return -1;
-        }
+    uint32_t tgid;
+
+    if (g_filter_pid_mode == LINX_FILTER_MODE_NONE) {
+        return 0;
     }
 
-    return 0;
+    tgid = bpf_get_current_pid_tgid() >> 32;
+
+    return check_filter_mode(g_filter_pid_mode,
+                             bpf_map_lookup_elem(&filter_pid_map, &tgid) != NULL);
+}
+
+static inline int check_comm_need_filtered(void)
+{
+    linx_comm_key_t key = {0};
+
+    if (g_filter_comm_mode == LINX_FILTER_MODE_NONE) {
+        return 0;
+    }
+
+    bpf_get_current_comm(&key.comm, LINX_COMM_MAX_SIZE);
+
+    return check_filter_mode(g_filter_comm_mode,
+                             bpf_map_lookup_elem(&filter_comm_map, &key) != NULL);
+}
+
+static inline int check_uid_need_filtered(void)
+{
+    uint32_t uid;
+
+    if (g_filter_uid_mode == LINX_FILTER_MODE_NONE) {
+        return 0;
+    }
+
+    uid = (uint32_t)bpf_get_current_uid_gid();
+
+    return check_filter_mode(g_filter_uid_mode,
+                             bpf_map_lookup_elem(&filter_uid_map, &uid) != NULL);
 }
 
 static inline int check_drop_mode(void)
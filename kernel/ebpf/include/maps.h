@@ -5,16 +5,22 @@
 #include "struct_define.h"
 #include "linx_syscall_id.h"
 #include "linx_exit_extra_id.h"
+#include "linx_type.h"
 
 /**
- * 需要过滤掉的pid集合
+ * pid 过滤表的工作方式，linx_filter_mode_t
  */
-__weak uint32_t g_filter_pids[LINX_BPF_FILTER_PID_MAX_SIZE];
+__weak uint8_t g_filter_pid_mode;
 
 /**
- * 需要过滤掉的任务集合
+ * comm 过滤表的工作方式，linx_filter_mode_t
  */
-__weak char g_filter_comms[LINX_BPF_FILTER_COMM_MAX_SIZE][LINX_COMM_MAX_SIZE];
+__weak uint8_t g_filter_comm_mode;
+
+/**
+ * uid 过滤表的工作方式，linx_filter_mode_t
+ */
+__weak uint8_t g_filter_uid_mode;
 
 /**
  * 表示需要采集哪些系统调用
@@ -39,6 +45,17 @@ __weak uint8_t g_drop_mode;
  */
 __weak uint8_t g_drop_failed;
 
+/**
+ * 进程快照需要附带的上下文段，linx_event_context_type_t 的组合
+ */
+__weak uint32_t g_event_context_mask;
+
+/**
+ * ringbuf 中未读数据达到该字节数才唤醒用户态
+ * 为0时，每个事件都按默认方式唤醒
+ */
+__weak uint64_t g_wakeup_threshold;
+
 /**
  * 系统调用退出的尾部调用表
  */
@@ -70,12 +87,69 @@ struct {
 } syscall_exit_extra_tail_table __weak SEC(".maps");
 
 /**
- * 消息交互的环形缓冲区
+ * 消息交互的环形缓冲区，每个CPU一个
+ * 内层ringbuf的大小和个数由应用层在加载前设置
+ */
+struct ringbuf_map {
+	__uint(type, BPF_MAP_TYPE_RINGBUF);
+};
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+	__type(key, uint32_t);
+	__array(values, struct ringbuf_map);
+} ringbuf_maps __weak SEC(".maps");
+
+/**
+ * pid 过滤表，键为 tgid，应用层可在运行时增删
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(max_entries, LINX_BPF_FILTER_PID_MAX_SIZE);
+	__type(key, uint32_t);
+	__type(value, uint8_t);
+} filter_pid_map __weak SEC(".maps");
+
+/**
+ * comm 过滤表，键为以0填充的 comm，应用层可在运行时增删
  */
 struct {
-    __uint(type, BPF_MAP_TYPE_RINGBUF);
-    __uint(max_entries, LINX_EVENT_MAX_SIZE);
-} ringbuf_map __weak SEC(".maps");
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(max_entries, LINX_BPF_FILTER_COMM_MAX_SIZE);
+	__type(key, linx_comm_key_t);
+	__type(value, uint8_t);
+} filter_comm_map __weak SEC(".maps");
+
+/**
+ * uid 过滤表，键为当前任务的 uid，应用层可在运行时增删
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(max_entries, LINX_BPF_FILTER_UID_MAX_SIZE);
+	__type(key, uint32_t);
+	__type(value, uint8_t);
+} filter_uid_map __weak SEC(".maps");
+
+/**
+ * 已经发送过快照的进程，键为 tgid + exec_id
+ * 进程第一次被采集或 exec 后发送一次快照，退出时删除
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__uint(max_entries, LINX_PROC_CTX_MAX_SIZE);
+	__type(key, linx_proc_ctx_key_t);
+	__type(value, linx_proc_ctx_t);
+} proc_ctx_map __weak SEC(".maps");
+
+/**
+ * 每个CPU上因ringbuf已满等原因丢弃的事件个数
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__uint(max_entries, 1);
+	__type(key, uint32_t);
+	__type(value, uint64_t);
+} drop_counter_map __weak SEC(".maps");
 
 struct {
 	__uint(type, BPF_MAP_TYPE_ARRAY);
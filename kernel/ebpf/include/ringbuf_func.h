@@ -28,6 +28,9 @@ typedef struct {
 
 #define SAFE_ACCESS(x) ((x) & (LINX_EVENT_MAX_SIZE - 1))
 
+/* LINX_FDS_MAX_SIZE 个 fd 和路径不会超过 LINX_CHARBUF_MAX_SIZE */
+#define FDS_SAFE_ACCESS(x) ((x) & (LINX_CHARBUF_MAX_SIZE - 1))
+
 #define PUSH_FIXDE_VALUE_TO_RINGBUF(ringbuf, value, type)                       \
     do {                                                                        \
         *((type *)&ringbuf->data[SAFE_ACCESS(ringbuf->payload_pos)]) = value;   \
@@ -170,37 +173,45 @@ static inline long linx_get_file_path(struct file *file, char *buf, size_t size)
     return (pos < size) ? pos : size - 1;
 }
 
-static inline void linx_get_task_file(struct task_struct *task, linx_event_t *event)
+/**
+ * 将任务打开的fd及其路径写入 buf
+ * 每一项为 uint32_t fd + 以'\0'结尾的路径，返回写入的总长度
+ */
+static inline long linx_get_task_file(struct task_struct *task, uint8_t *buf)
 {
     unsigned int max_fds = 0;
     struct file **files, *file;
+    long pos = 0, len;
 
     max_fds = BPF_CORE_READ(task, files, fdt, max_fds);
     if (!max_fds) {
-        return;
+        return 0;
     }
 
     files = BPF_CORE_READ(task, files, fdt, fd);
     if (!files) {
-        return;
+        return 0;
     }
 
     max_fds = max_fds < LINX_FDS_MAX_SIZE ? max_fds : LINX_FDS_MAX_SIZE;
 
-    event->nfds = 0;
     for (int i = 0; i < max_fds; ++i) {
         if (bpf_probe_read(&file, sizeof(file), &files[i]) < 0 || !file) {
             continue;
         }
-    
-        if (event->nfds > LINX_FDS_MAX_SIZE - 1) {
-            break;
-        }
 
-        event->fds[event->nfds] = i;
-        
-        linx_get_file_path(file, &event->fd_path[event->nfds++][0], LINX_PATH_MAX_SIZE);
+        *(uint32_t *)&buf[FDS_SAFE_ACCESS(pos)] = i;
+        pos += sizeof(uint32_t);
+
+        len = linx_get_file_path(file, (char *)&buf[FDS_SAFE_ACCESS(pos)], LINX_PATH_MAX_SIZE);
+        if (len < 0) {
+            buf[FDS_SAFE_ACCESS(pos)] = '\0';
+            len = 0;
+        }
+        pos += len + 1;
     }
+
+    return pos;
 }
 
 static inline int linx_get_process_cmdline(struct task_struct *task, char *cmdline)
@@ -220,6 +231,9 @@ static inline int linx_get_process_cmdline(struct task_struct *task, char *cmdli
     }
 
     ret = bpf_probe_read_user(cmdline, len, (void *)arg_start);
+    if (ret < 0) {
+        return ret;
+    }
 
     for (int i = 0 ; i < len; ++i) {
         if (cmdline[i] == '\0') {
@@ -229,7 +243,7 @@ static inline int linx_get_process_cmdline(struct task_struct *task, char *cmdli
 
     cmdline[len - 1] = '\0';
 
-    return ret;
+    return len;
 }
 
 static inline int linx_get_comm_fullpath(struct task_struct *task, char *fullpath)
@@ -239,7 +253,9 @@ static inline int linx_get_comm_fullpath(struct task_struct *task, char *fullpat
         return -1;
     }
 
-    return (int)linx_get_file_path(file, fullpath, LINX_PATH_MAX_SIZE);
+    long len = linx_get_file_path(file, fullpath, LINX_PATH_MAX_SIZE);
+
+    return len < 0 ? (int)len : (int)len + 1;
 }
 
 static inline int linx_get_parent_fullpath(struct task_struct *task, char *fullpath)
@@ -260,6 +276,52 @@ static inline linx_ringbuf_t *linx_ringbuf_get(void)
     return (linx_ringbuf_t *)bpf_map_lookup_elem(&linx_ringbuf_maps, &cpuid);
 }
 
+/**
+ * 在 payload_pos 处写入一个上下文段，get 返回写入的数据长度
+ */
+#define PUSH_CONTEXT_TO_RINGBUF(ringbuf, context_type, get)                                 \
+    do {                                                                                    \
+        linx_event_t *__event = (linx_event_t *)ringbuf->data;                              \
+        linx_event_context_t *__context =                                                   \
+            (linx_event_context_t *)&ringbuf->data[SAFE_ACCESS(ringbuf->payload_pos)];      \
+        void *__buf = &ringbuf->data[SAFE_ACCESS(ringbuf->payload_pos +                     \
+                                                 sizeof(linx_event_context_t))];            \
+        long __len = (get);                                                                 \
+        if (__len > 0) {                                                                    \
+            __context->type = (context_type);                                               \
+            __context->len = (uint16_t)__len;                                               \
+            __event->context_mask |= (context_type);                                        \
+            ringbuf->payload_pos += sizeof(linx_event_context_t) + __len;                   \
+        }                                                                                   \
+    } while (0)
+
+/**
+ * 按 g_event_context_mask 附带进程上下文，只用于进程快照
+ * 默认只附带命令行，其余的上下文代价较大，按需开启
+ */
+static inline void linx_ringbuf_load_context(linx_ringbuf_t *ringbuf, struct task_struct *task)
+{
+    if (g_event_context_mask & LINX_EVENT_CONTEXT_CMDLINE) {
+        PUSH_CONTEXT_TO_RINGBUF(ringbuf, LINX_EVENT_CONTEXT_CMDLINE,
+                                linx_get_process_cmdline(task, __buf));
+    }
+
+    if (g_event_context_mask & LINX_EVENT_CONTEXT_FULLPATH) {
+        PUSH_CONTEXT_TO_RINGBUF(ringbuf, LINX_EVENT_CONTEXT_FULLPATH,
+                                linx_get_comm_fullpath(task, __buf));
+    }
+
+    if (g_event_context_mask & LINX_EVENT_CONTEXT_P_FULLPATH) {
+        PUSH_CONTEXT_TO_RINGBUF(ringbuf, LINX_EVENT_CONTEXT_P_FULLPATH,
+                                linx_get_parent_fullpath(task, __buf));
+    }
+
+    if (g_event_context_mask & LINX_EVENT_CONTEXT_FDS) {
+        PUSH_CONTEXT_TO_RINGBUF(ringbuf, LINX_EVENT_CONTEXT_FDS,
+                                linx_get_task_file(task, __buf));
+    }
+}
+
 static inline void linx_ringbuf_load_event(linx_ringbuf_t *ringbuf, linx_event_type_t type, long res)
 {
     struct task_struct *task = (struct task_struct *)bpf_get_current_task_btf();
@@ -267,40 +329,122 @@ static inline void linx_ringbuf_load_event(linx_ringbuf_t *ringbuf, linx_event_t
     uint64_t tg_pid = bpf_get_current_pid_tgid();
     uint64_t uid_gid = bpf_get_current_uid_gid();
 
-    event->tid = (uint64_t)(tg_pid >> 32);
-    event->pid = (uint64_t)((uint32_t)tg_pid);
+    event->tid = (uint64_t)((uint32_t)tg_pid);
+    event->pid = (uint64_t)(tg_pid >> 32);
     event->ppid = linx_get_ppid(task);
     event->uid = (uint64_t)((uint32_t)uid_gid);
     event->gid = (uint64_t)(uid_gid >> 32);
     event->time = g_boot_time + bpf_ktime_get_boot_ns();
     event->res = (uint64_t)res;
     event->type = (uint32_t)type;
+    event->context_mask = 0;
     event->size = 0;
 
     bpf_get_current_comm(&event->comm, LINX_COMM_MAX_SIZE);
-    // linx_get_task_file(task, event);
-    linx_get_process_cmdline(task, &event->cmdline[0]);
-    // linx_get_comm_fullpath(task, &event->fullpath[0]);
-    // linx_get_parent_fullpath(task , &event->p_fullpath[0]);
+
+    event->context_size = 0;
 
     ringbuf->index = 0;
     ringbuf->payload_pos = LINX_EVENT_HEADER_SIZE;
     ringbuf->reserved_event_size = LINX_EVENT_MAX_SIZE;
 }
 
+static inline void linx_ringbuf_count_drop(void)
+{
+    uint32_t key = 0;
+    uint64_t *drops = bpf_map_lookup_elem(&drop_counter_map, &key);
+    if (drops) {
+        (*drops)++;
+    }
+}
+
 static inline void linx_ringbuf_submit_event(linx_ringbuf_t *ringbuf)
 {
     if (ringbuf->payload_pos > LINX_EVENT_MAX_SIZE) {
+        linx_ringbuf_count_drop();
         return;
     }
 
     ((linx_event_t *)ringbuf->data)->size = ringbuf->payload_pos;
 
-    int err = bpf_ringbuf_output(&ringbuf_map, ringbuf->data, ringbuf->payload_pos, 0);
+    /* 写入当前CPU独占的ringbuf，各CPU之间没有锁竞争 */
+    uint32_t cpuid = (uint32_t)bpf_get_smp_processor_id();
+    void *rb = bpf_map_lookup_elem(&ringbuf_maps, &cpuid);
+    if (!rb) {
+        linx_ringbuf_count_drop();
+        return;
+    }
+
+    /**
+     * 未读数据较少时不唤醒用户态，由用户态的 epoll 超时兜底
+     * 积累到阈值后强制唤醒，减少唤醒次数
+     */
+    uint64_t flags = 0;
+    if (g_wakeup_threshold) {
+        flags = bpf_ringbuf_query(rb, BPF_RB_AVAIL_DATA) >= g_wakeup_threshold ?
+                BPF_RB_FORCE_WAKEUP : BPF_RB_NO_WAKEUP;
+    }
+
+    int err = bpf_ringbuf_output(rb, ringbuf->data, ringbuf->payload_pos, flags);
     if (err) {
-        bpf_printk("bpf_ringbuf_output error!\n");
+        linx_ringbuf_count_drop();
+        return;
+    }
+}
+
+/**
+ * 发送进程快照事件，上下文段紧跟事件头，没有参数
+ */
+static inline void linx_proc_snapshot_submit(struct task_struct *task, linx_event_type_t type, long res)
+{
+    linx_ringbuf_t *ringbuf = linx_ringbuf_get();
+    if (!ringbuf) {
+        return;
+    }
+
+    linx_ringbuf_load_event(ringbuf, type, res);
+
+    if (type == LINX_EVENT_TYPE_PROC_SNAPSHOT) {
+        linx_ringbuf_load_context(ringbuf, task);
+        ((linx_event_t *)ringbuf->data)->context_size =
+            (uint32_t)(ringbuf->payload_pos - LINX_EVENT_HEADER_SIZE);
+    }
+
+    linx_ringbuf_submit_event(ringbuf);
+}
+
+/**
+ * 当前进程第一次被采集或 exec 之后，发送一次进程快照
+ * 之后的系统调用事件不再附带进程上下文
+ */
+static inline void linx_proc_ctx_check(void)
+{
+    struct task_struct *task = (struct task_struct *)bpf_get_current_task_btf();
+    linx_proc_ctx_key_t key = {
+        .tgid = bpf_get_current_pid_tgid() >> 32,
+        .exec_id = BPF_CORE_READ(task, self_exec_id),
+    };
+    linx_proc_ctx_t proc_ctx = {0};
+
+    if (bpf_map_lookup_elem(&proc_ctx_map, &key)) {
+        return;
+    }
+
+    proc_ctx.time = g_boot_time + bpf_ktime_get_boot_ns();
+    proc_ctx.ppid = linx_get_ppid(task);
+    bpf_get_current_comm(&proc_ctx.comm, LINX_COMM_MAX_SIZE);
+
+    if (bpf_map_update_elem(&proc_ctx_map, &key, &proc_ctx, BPF_ANY)) {
         return;
     }
+
+    /* exec 之前的上下文已经失效 */
+    if (key.exec_id) {
+        key.exec_id--;
+        bpf_map_delete_elem(&proc_ctx_map, &key);
+    }
+
+    linx_proc_snapshot_submit(task, LINX_EVENT_TYPE_PROC_SNAPSHOT, 0);
 }
 
 static inline void linx_ringbuf_store_s8(linx_ringbuf_t *ringbuf, int8_t value)
@@ -10,4 +10,29 @@ typedef struct {
     uint64_t reserved_event_size;
 } linx_ringbuf_t;
 
+/**
+ * comm 过滤表的键
+ */
+typedef struct {
+    char comm[LINX_COMM_MAX_SIZE];
+} linx_comm_key_t;
+
+/**
+ * 进程上下文缓存的键，exec 之后 exec_id 会变化
+ */
+typedef struct {
+    uint64_t tgid;
+    uint64_t exec_id;
+} linx_proc_ctx_key_t;
+
+/**
+ * 进程上下文缓存的值
+ * cmdline 等较大的上下文只在快照事件中发送一次，不在此处重复保存
+ */
+typedef struct {
+    uint64_t time;          /* 发送快照的时间 */
+    uint64_t ppid;
+    char comm[LINX_COMM_MAX_SIZE];
+} linx_proc_ctx_t;
+
 #endif /* __STRUCT_DEFINE_H__ */
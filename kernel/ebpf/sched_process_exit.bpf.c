@@ -0,0 +1,31 @@
+#include "bpf_check.h"
+#include "ringbuf_func.h"
+
+/**
+ * 进程退出时删除进程上下文缓存并发送退出事件
+ * 只处理发送过快照的进程，其余的进程应用层并不关心
+ */
+SEC("tp_btf/sched_process_exit")
+int BPF_PROG(sched_proc_exit, struct task_struct *task)
+{
+    linx_proc_ctx_key_t key;
+
+    /* 只在线程组的 leader 退出时处理 */
+    if (BPF_CORE_READ(task, pid) != BPF_CORE_READ(task, tgid)) {
+        return 0;
+    }
+
+    key.tgid = BPF_CORE_READ(task, tgid);
+    key.exec_id = BPF_CORE_READ(task, self_exec_id);
+
+    if (!bpf_map_lookup_elem(&proc_ctx_map, &key)) {
+        return 0;
+    }
+
+    bpf_map_delete_elem(&proc_ctx_map, &key);
+
+    linx_proc_snapshot_submit(task, LINX_EVENT_TYPE_PROC_EXIT,
+                              (long)(BPF_CORE_READ(task, exit_code) >> 8));
+
+    return 0;
+}
@@ -1,24 +1,24 @@
 #include "bpf_check.h"
+#include "ringbuf_func.h"
 #include "get_pt_regs.h"
 
 SEC("tp_btf/sys_enter")
 int BPF_PROG(sys_enter, struct pt_regs *regs, long syscall_id)
 {
-    uint32_t pid = bpf_get_current_pid_tgid();
-    char comm[LINX_COMM_MAX_SIZE];
-    bpf_get_current_comm(&comm, LINX_COMM_MAX_SIZE);
-
-    if (check_pid_need_filtered(pid) ||
-        check_comm_need_filtered(comm) ||
-        check_drop_mode()) 
-    {
+    /* 先做不需要任何辅助函数的检查，绝大多数系统调用在这里返回 */
+    if (check_drop_mode() || !check_interesting_syscall(syscall_id)) {
         return 0;
     }
 
-    if (!check_interesting_syscall(syscall_id)) {
+    if (check_pid_need_filtered() ||
+        check_comm_need_filtered() ||
+        check_uid_need_filtered())
+    {
         return 0;
     }
 
+    linx_proc_ctx_check();
+
     bpf_tail_call(ctx, &syscall_enter_tail_table, syscall_id);
 
     return 0;
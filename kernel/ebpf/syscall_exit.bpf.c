@@ -1,29 +1,34 @@
 #include "bpf_check.h"
+#include "ringbuf_func.h"
 #include "get_pt_regs.h"
 
 SEC("tp_btf/sys_exit")
 int BPF_PROG(sys_exit, struct pt_regs *regs, long ret)
 {
     long syscall_id = get_syscall_id(regs);
-    uint32_t pid = bpf_get_current_pid_tgid();
-    char comm[LINX_COMM_MAX_SIZE];
-    bpf_get_current_comm(&comm, LINX_COMM_MAX_SIZE);
 
-    if (check_pid_need_filtered(pid) ||
-        check_comm_need_filtered(comm) ||
-        check_drop_mode()) 
-    {
+    /* 先做不需要任何辅助函数的检查，绝大多数系统调用在这里返回 */
+    if (check_drop_mode() || !check_interesting_syscall(syscall_id)) {
         return 0;
     }
 
-    if (!check_interesting_syscall(syscall_id)) {
+    if (check_drop_failed() && ret < 0) {
         return 0;
     }
 
-    if (check_drop_failed() && ret < 0) {
+    if (check_pid_need_filtered()) {
+        return 0;
+    }
+
+    /* 进程生命周期事件和随之发送的快照不受 comm、uid 过滤，应用层的进程缓存依赖它们 */
+    if (!linx_syscall_is_proc_lifecycle(syscall_id) &&
+        (check_comm_need_filtered() || check_uid_need_filtered()))
+    {
         return 0;
     }
 
+    linx_proc_ctx_check();
+
     bpf_tail_call(ctx, &syscall_exit_tail_table, syscall_id);
 
     return 0;
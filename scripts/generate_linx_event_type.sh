@@ -53,6 +53,10 @@ function generated_linx_event_type()
 		write_line
 	done < "$input_file"
 
+	# 非系统调用的内部事件，进程快照和进程退出
+	echo "    LINX_EVENT_TYPE_PROC_SNAPSHOT = $((exit_number + 1))," >> "$output_file"
+	echo "    LINX_EVENT_TYPE_PROC_EXIT = $((exit_number + 2))," >> "$output_file"
+
 	echo "    LINX_EVENT_TYPE_MAX" >> "$output_file"
     echo "} linx_event_type_t;" >> "$output_file"
     echo "" >> "$output_file"
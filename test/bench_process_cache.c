@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "linx_test.h"
+#include "linx_process_cache.h"
+#include "linx_hash_map.h"
+#include "linx_log.h"
+
+/**
+ * 进程缓存的读写竞争基准测试
+ * 多个匹配线程在读区间内查询进程，一个写线程不断地 chdir、fork 和 exit，统计每秒查询次数
+ * 每个匹配线程有 1/64 的查询落在缓存中没有的 pid 上，用来确认未命中时不会阻塞读者
+ *
+ * 用法：bench_process_cache [秒数] [线程数...]，默认每组 2 秒，线程数 1 4 16 32
+*/
+
+#define BENCH_MAX_THREADS   64
+#define BENCH_MAX_PIDS      4096
+#define BENCH_BATCH         8
+#define BENCH_MISS_PID      0x3ffffff0      /* 超过 pid_max 的上限，不会出现在缓存中 */
+
+typedef struct {
+    pthread_t thread;
+    unsigned int seed;
+    uint64_t gets;
+    uint64_t misses;
+    double max_batch;                       /* 一个读区间的最长耗时，单位秒 */
+} __attribute__((aligned(64))) bench_reader_t;
+
+static pid_t s_pids[BENCH_MAX_PIDS];
+static int s_npids = 0;
+static volatile int s_stop = 0;
+static uint64_t s_writes = 0;
+
+static void *bench_reader(void *arg)
+{
+    bench_reader_t *reader = (bench_reader_t *)arg;
+    linx_process_info_t *info;
+    uint64_t sum = 0;
+    double begin, cost;
+    pid_t pid;
+
+    while (!s_stop) {
+        begin = test_now();
+
+        linx_process_cache_read_begin();
+
+        for (int i = 0; i < BENCH_BATCH; i++) {
+            pid = (rand_r(&reader->seed) & 63) ? s_pids[rand_r(&reader->seed) % s_npids] :
+                                                 BENCH_MISS_PID + (rand_r(&reader->seed) & 15);
+            info = linx_process_cache_get(pid);
+            if (info) {
+                sum += (uint64_t)info->comm[0] + info->cwd[0];
+            } else {
+                reader->misses++;
+            }
+        }
+
+        linx_process_cache_read_end();
+
+        cost = test_now() - begin;
+        if (cost > reader->max_batch) {
+            reader->max_batch = cost;
+        }
+
+        reader->gets += BENCH_BATCH;
+    }
+
+    /* 防止查询被优化掉 */
+    reader->gets += (sum == 1);
+
+    return NULL;
+}
+
+static void *bench_writer(void *arg)
+{
+    unsigned int seed = 1;
+    uint64_t writes = 0;
+    pid_t pid, child;
+
+    (void)arg;
+
+    while (!s_stop) {
+        pid = s_pids[rand_r(&seed) % s_npids];
+
+        switch (writes % 4) {
+        case 0:
+            linx_process_cache_chdir(pid, "/tmp");
+            break;
+        case 1:
+            linx_process_cache_chdir(pid, "/usr");
+            break;
+        case 2:
+            /* 用超过 pid_max 的 pid 模拟短命的子进程 */
+            child = BENCH_MISS_PID - 1 - (pid_t)(writes & 1023);
+            linx_process_cache_fork(pid, child);
+            linx_process_cache_exit(child);
+            break;
+        default:
+            linx_process_cache_exec(pid, "bench", "bench\0--run\0", 12);
+            break;
+        }
+
+        writes++;
+        if ((writes & 1023) == 0) {
+            usleep(100);
+        }
+    }
+
+    s_writes = writes;
+
+    return NULL;
+}
+
+static void bench_run(int nthreads, int seconds)
+{
+    static bench_reader_t readers[BENCH_MAX_THREADS];
+    uint64_t gets = 0, misses = 0;
+    double max_batch = 0;
+    pthread_t writer;
+
+    memset(readers, 0, sizeof(readers));
+    s_stop = 0;
+    s_writes = 0;
+
+    for (int i = 0; i < nthreads; i++) {
+        readers[i].seed = i * 7919 + 1;
+        pthread_create(&readers[i].thread, NULL, bench_reader, &readers[i]);
+    }
+    pthread_create(&writer, NULL, bench_writer, NULL);
+
+    sleep(seconds);
+    s_stop = 1;
+
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(readers[i].thread, NULL);
+        gets += readers[i].gets;
+        misses += readers[i].misses;
+        if (readers[i].max_batch > max_batch) {
+            max_batch = readers[i].max_batch;
+        }
+    }
+    pthread_join(writer, NULL);
+
+    printf("threads=%-3d gets/s=%8.2fM per-thread=%6.2fM misses=%-9lu max-read-section=%8.1fus writes/s=%7.1fK\n",
+           nthreads, gets / 1e6 / seconds, gets / 1e6 / seconds / nthreads, (unsigned long)misses,
+           max_batch * 1e6, s_writes / 1e3 / seconds);
+}
+
+int main(int argc, char **argv)
+{
+    int default_threads[] = { 1, 4, 16, 32 };
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    linx_process_info_t *list = NULL;
+    int count = 0, nthreads;
+
+    if (seconds <= 0) {
+        seconds = 2;
+    }
+
+    if (linx_log_init("stderr", "ERROR") || linx_hash_map_init() || linx_process_cache_init()) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    /* 等待启动扫描完成 */
+    for (int i = 0; i < 50 && count == 0; i++) {
+        usleep(100000);
+        linx_process_cache_release_all(list, count);
+        linx_process_cache_get_all(&list, &count);
+    }
+
+    for (int i = 0; i < count && s_npids < BENCH_MAX_PIDS; i++) {
+        s_pids[s_npids++] = list[i].pid;
+    }
+    linx_process_cache_release_all(list, count);
+
+    if (s_npids == 0) {
+        fprintf(stderr, "process cache is empty\n");
+        return 1;
+    }
+
+    printf("processes=%d\n", s_npids);
+
+    if (argc > 2) {
+        for (int i = 2; i < argc; i++) {
+            nthreads = atoi(argv[i]);
+            if (nthreads > 0 && nthreads <= BENCH_MAX_THREADS) {
+                bench_run(nthreads, seconds);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < TEST_ARRAY_SIZE(default_threads); i++) {
+            bench_run(default_threads[i], seconds);
+        }
+    }
+
+    linx_process_cache_deinit();
+    linx_hash_map_deinit();
+
+    return 0;
+}
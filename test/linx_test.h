@@ -0,0 +1,40 @@
+#ifndef __LINX_TEST_H__
+#define __LINX_TEST_H__
+
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * 自测程序共用的检查宏，失败时打印位置并计数，不中断后续用例
+*/
+static int s_test_failed __attribute__((unused)) = 0;
+static int s_test_total __attribute__((unused)) = 0;
+
+#define TEST_CHECK(cond, fmt, ...)                                              \
+    do {                                                                        \
+        s_test_total++;                                                         \
+        if (!(cond)) {                                                          \
+            s_test_failed++;                                                    \
+            fprintf(stderr, "%s:%d: check '%s' failed: " fmt "\n",              \
+                    __FILE__, __LINE__, #cond, ##__VA_ARGS__);                  \
+        }                                                                       \
+    } while (0)
+
+/**
+ * 在 main 的最后返回
+*/
+#define TEST_REPORT()                                                           \
+    (printf("%d/%d checks passed\n", s_test_total - s_test_failed, s_test_total), \
+     s_test_failed ? 1 : 0)
+
+#define TEST_ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static inline double test_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#endif /* __LINX_TEST_H__ */
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "linx_test.h"
+#include "linx_process_cache.h"
+#include "linx_hash_map.h"
+#include "linx_log.h"
+
+/**
+ * 进程祖先自测
+ * 用超过 pid_max 的 pid 构造进程链，检查 fork、exec 和快照之后 aname[]、pname、pcmdline 的继承，
+ * 以及通过字段路径读取的结果与结构中的一致
+*/
+
+#define PC_PID_BASE     0x3f000000          /* 超过 pid_max 的上限，不会与真实进程冲突 */
+#define PC_CHAIN_LEN    (LINX_PROCESS_ANCESTOR_NUM + 3)
+
+static bool pc_str_equal(const char *got, const char *expected)
+{
+    return got && strcmp(got, expected) == 0;
+}
+
+static void pc_snapshot(pid_t pid, pid_t ppid, const char *comm, const char *args, size_t args_len)
+{
+    linx_process_snapshot_t snapshot = {
+        .pid = pid,
+        .ppid = ppid,
+        .comm = comm,
+        .comm_len = strlen(comm),
+        .cmdline = args,
+        .cmdline_len = args_len,
+    };
+
+    TEST_CHECK(linx_process_cache_snapshot(&snapshot) == 0, "snapshot %d", pid);
+}
+
+/**
+ * 检查 pid 的 aname[0..]，names 以 NULL 结束，之后的祖先应当为空字符串
+*/
+static void pc_check_lineage(pid_t pid, const char *const *names, const char *pcmdline, const char *what)
+{
+    linx_process_info_t *info;
+    const char *expected;
+    bool ended = false;
+
+    linx_process_cache_read_begin();
+
+    info = linx_process_cache_get(pid);
+    TEST_CHECK(info != NULL, "%s: pid %d not cached", what, pid);
+    if (!info) {
+        linx_process_cache_read_end();
+        return;
+    }
+
+    for (int i = 0; i < LINX_PROCESS_ANCESTOR_NUM; i++) {
+        ended = ended || !names[i];
+        expected = ended ? "" : names[i];
+        TEST_CHECK(pc_str_equal(info->aname[i], expected), "%s: aname[%d] is \"%s\", expected \"%s\"",
+                   what, i, info->aname[i] ? info->aname[i] : "(null)", expected);
+    }
+
+    TEST_CHECK(pc_str_equal(info->pcmdline, pcmdline), "%s: pcmdline is \"%s\", expected \"%s\"",
+               what, info->pcmdline ? info->pcmdline : "(null)", pcmdline);
+
+    linx_process_cache_read_end();
+}
+
+static void test_pc_fork_exec(void)
+{
+    const char root_args[] = "init\0--root";
+    const char sh_args[] = "sh\0-c\0run";
+    const char *names[LINX_PROCESS_ANCESTOR_NUM + 1] = { 0 };
+    pid_t root = PC_PID_BASE, child = PC_PID_BASE + 1, grandchild = PC_PID_BASE + 2;
+
+    pc_snapshot(root, 0, "init", root_args, sizeof(root_args));
+    names[0] = "init";
+    pc_check_lineage(root, names, "", "root");
+
+    /* fork 之后子进程与父进程同名，父进程是 aname[1] */
+    TEST_CHECK(linx_process_cache_fork(root, child) == 0, "fork");
+    names[0] = "init";
+    names[1] = "init";
+    pc_check_lineage(child, names, "init --root", "forked child");
+
+    /* exec 只改变自己的名称 */
+    TEST_CHECK(linx_process_cache_exec(child, "sh", sh_args, sizeof(sh_args)) == 0, "exec");
+    names[0] = "sh";
+    pc_check_lineage(child, names, "init --root", "child after exec");
+
+    TEST_CHECK(linx_process_cache_fork(child, grandchild) == 0, "fork grandchild");
+    names[0] = "sh";
+    names[1] = "sh";
+    names[2] = "init";
+    pc_check_lineage(grandchild, names, "sh -c run", "grandchild");
+
+    /* 祖先只在加入时确定，之后父进程 exec 不会改变已经存在的子进程 */
+    TEST_CHECK(linx_process_cache_exec(child, "bash", NULL, 0) == 0, "exec bash");
+    pc_check_lineage(grandchild, names, "sh -c run", "grandchild after parent exec");
+
+    /* 之后 fork 的子进程继承新的名称 */
+    TEST_CHECK(linx_process_cache_fork(child, grandchild + 1) == 0, "fork after exec");
+    names[0] = "bash";
+    names[1] = "bash";
+    names[2] = "init";
+    pc_check_lineage(grandchild + 1, names, "sh -c run", "child forked after parent exec");
+
+    /* 被收养后按新的父进程重新继承 */
+    pc_snapshot(grandchild, root, "sh", NULL, 0);
+    names[0] = "sh";
+    names[1] = "init";
+    names[2] = NULL;
+    pc_check_lineage(grandchild, names, "init --root", "reparented grandchild");
+
+    /* 父进程不在缓存中时没有祖先 */
+    pc_snapshot(grandchild + 2, PC_PID_BASE - 1, "orphan", NULL, 0);
+    names[0] = "orphan";
+    names[1] = NULL;
+    pc_check_lineage(grandchild + 2, names, "", "orphan");
+
+    for (pid_t pid = root; pid <= grandchild + 2; pid++) {
+        linx_process_cache_delete(pid);
+    }
+}
+
+/**
+ * 超过 LINX_PROCESS_ANCESTOR_NUM 层的链只保留最近的祖先
+*/
+static void test_pc_deep_chain(void)
+{
+    const char *names[LINX_PROCESS_ANCESTOR_NUM + 1] = { 0 };
+    char comm[PC_CHAIN_LEN][16], args[32];
+    pid_t pid = PC_PID_BASE + 100;
+    int len;
+
+    snprintf(comm[0], sizeof(comm[0]), "p0");
+    pc_snapshot(pid, 0, comm[0], "p0", 3);
+
+    for (int i = 1; i < PC_CHAIN_LEN; i++) {
+        snprintf(comm[i], sizeof(comm[i]), "p%d", i);
+        len = snprintf(args, sizeof(args), "p%d%c-n%c%d", i, '\0', '\0', i);
+        TEST_CHECK(linx_process_cache_fork(pid + i - 1, pid + i) == 0, "fork level %d", i);
+        TEST_CHECK(linx_process_cache_exec(pid + i, comm[i], args, len + 1) == 0, "exec level %d", i);
+    }
+
+    for (int i = 0; i < LINX_PROCESS_ANCESTOR_NUM; i++) {
+        names[i] = comm[PC_CHAIN_LEN - 1 - i];
+    }
+    snprintf(args, sizeof(args), "p%d -n %d", PC_CHAIN_LEN - 2, PC_CHAIN_LEN - 2);
+    pc_check_lineage(pid + PC_CHAIN_LEN - 1, names, args, "deep chain");
+
+    for (int i = 0; i < PC_CHAIN_LEN; i++) {
+        linx_process_cache_delete(pid + i);
+    }
+}
+
+/**
+ * 规则通过字段路径读取，proc.pname 即 aname[1]，越界的下标没有值
+*/
+static void test_pc_fields(void)
+{
+    static const struct {
+        const char *path;
+        const char *expected;       /* NULL 表示没有值 */
+    } cases[] = {
+        { "proc.aname.0", "leaf" },
+        { "proc.pname", "mid" },
+        { "proc.aname.1", "mid" },
+        { "proc.aname.2", "top" },
+        { "proc.aname.3", "" },
+        { "proc.pcmdline", "mid --x" },
+        { "proc.aname.99", NULL },
+    };
+    const char mid_args[] = "mid\0--x";
+    pid_t pid = PC_PID_BASE + 200;
+    linx_process_info_t *info;
+    linx_field_ctx_t ctx;
+    field_result_t field;
+    linx_field_type_t type;
+    const char *const *value;
+    char path[64];
+
+    pc_snapshot(pid, 0, "top", "top", 4);
+    pc_snapshot(pid + 1, pid, "mid", mid_args, sizeof(mid_args));
+    pc_snapshot(pid + 2, pid + 1, "leaf", "leaf", 5);
+
+    linx_process_cache_read_begin();
+
+    info = linx_process_cache_get(pid + 2);
+    TEST_CHECK(info != NULL, "leaf not cached");
+
+    for (size_t i = 0; info && i < TEST_ARRAY_SIZE(cases); i++) {
+        snprintf(path, sizeof(path), "%s", cases[i].path);
+        field = linx_hash_map_get_field_by_path(path);
+
+        memset(&ctx, 0, sizeof(ctx));
+        value = NULL;
+        if (field.found) {
+            ctx.bases[field.table_index] = info;
+            value = linx_hash_map_get_value(&ctx, &field, &type, NULL);
+        }
+
+        if (cases[i].expected) {
+            TEST_CHECK(value && type == LINX_FIELD_TYPE_CHARBUF_REF && pc_str_equal(*value, cases[i].expected),
+                       "%s is \"%s\", expected \"%s\"", cases[i].path, value ? *value : "(null)",
+                       cases[i].expected);
+        } else {
+            TEST_CHECK(value == NULL, "%s must have no value", cases[i].path);
+        }
+
+        linx_hash_map_release_field(&field);
+    }
+
+    linx_process_cache_read_end();
+
+    for (pid_t p = pid; p <= pid + 2; p++) {
+        linx_process_cache_delete(p);
+    }
+}
+
+int main(void)
+{
+    if (linx_log_init("stderr", "ERROR") || linx_hash_map_init() || linx_process_cache_init()) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    test_pc_fork_exec();
+    test_pc_deep_chain();
+    test_pc_fields();
+
+    linx_process_cache_deinit();
+    linx_hash_map_deinit();
+    linx_log_deinit();
+
+    return TEST_REPORT();
+}
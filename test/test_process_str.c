@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "linx_test.h"
+#include "linx_process_str.h"
+
+/**
+ * 进程缓存字符串驻留自测
+ * 检查相同内容共享一份、长度前缀、引用计数归零时释放，以及多个线程同时驻留和释放后统计归零
+*/
+
+#define STR_THREADS     4
+#define STR_ROUNDS      20000
+#define STR_KEYS        64
+
+static uint32_t str_len_prefix(const char *str)
+{
+    uint32_t len;
+
+    memcpy(&len, str - sizeof(uint32_t), sizeof(len));
+
+    return len;
+}
+
+static void test_str_intern(void)
+{
+    char buf[] = "/usr/bin/bash--";
+    const char *a, *b, *c, *d;
+    uint64_t count, bytes, refs;
+
+    /* 只使用前 len 个字节，不要求 '\0' 结尾 */
+    a = linx_process_str_intern(buf, 13);
+    b = linx_process_str_intern("/usr/bin/bash", 13);
+    c = linx_process_str_intern("/usr/bin/zsh", 12);
+
+    TEST_CHECK(a == b, "same content must share one copy");
+    TEST_CHECK(a != c, "different content must not be shared");
+    TEST_CHECK(strcmp(a, "/usr/bin/bash") == 0 && a[13] == '\0', "content \"%s\"", a);
+    TEST_CHECK(str_len_prefix(a) == 13, "length prefix %u", str_len_prefix(a));
+    TEST_CHECK(str_len_prefix(c) == 12, "length prefix %u", str_len_prefix(c));
+
+    linx_process_str_stats(&count, &bytes, &refs);
+    TEST_CHECK(count == 2 && refs == 3, "count %lu refs %lu", (unsigned long)count, (unsigned long)refs);
+
+    d = linx_process_str_ref(a);
+    TEST_CHECK(d == a, "ref returns the same string");
+    linx_process_str_stats(&count, NULL, &refs);
+    TEST_CHECK(count == 2 && refs == 4, "after ref: count %lu refs %lu", (unsigned long)count, (unsigned long)refs);
+
+    /* 还有引用时保留，内容不变 */
+    linx_process_str_unref(a);
+    linx_process_str_unref(b);
+    linx_process_str_unref(NULL);
+    linx_process_str_stats(&count, NULL, &refs);
+    TEST_CHECK(count == 2 && refs == 2, "after unref: count %lu refs %lu", (unsigned long)count, (unsigned long)refs);
+    TEST_CHECK(strcmp(d, "/usr/bin/bash") == 0, "content kept while referenced");
+
+    linx_process_str_unref(d);
+    linx_process_str_unref(c);
+    linx_process_str_stats(&count, &bytes, &refs);
+    TEST_CHECK(count == 0 && bytes == 0 && refs == 0, "all released: count %lu bytes %lu refs %lu",
+               (unsigned long)count, (unsigned long)bytes, (unsigned long)refs);
+
+    /* 释放后重新驻留得到新的一份，计数从1开始 */
+    a = linx_process_str_intern("/usr/bin/bash", 13);
+    linx_process_str_stats(&count, NULL, &refs);
+    TEST_CHECK(count == 1 && refs == 1, "re-intern: count %lu refs %lu", (unsigned long)count, (unsigned long)refs);
+    linx_process_str_unref(a);
+}
+
+static void test_str_empty(void)
+{
+    const char *a, *b, *c;
+    uint64_t count, refs;
+
+    a = linx_process_str_intern("", 0);
+    b = linx_process_str_intern(NULL, 0);
+    c = linx_process_str_intern("abc", 0);
+
+    TEST_CHECK(a && a == b && a == c, "empty strings share the static copy");
+    TEST_CHECK(a[0] == '\0' && str_len_prefix(a) == 0, "empty content");
+    TEST_CHECK(linx_process_str_ref(a) == a, "ref of empty string");
+
+    /* 空字符串不计引用，多次释放没有影响 */
+    linx_process_str_stats(&count, NULL, &refs);
+    TEST_CHECK(count == 0 && refs == 0, "empty not counted: count %lu refs %lu",
+               (unsigned long)count, (unsigned long)refs);
+
+    for (int i = 0; i < 4; i++) {
+        linx_process_str_unref(a);
+    }
+    TEST_CHECK(a[0] == '\0', "empty string survives unref");
+}
+
+typedef struct {
+    pthread_t thread;
+    unsigned int seed;
+    int mismatches;
+} str_worker_t;
+
+/**
+ * 每个线程反复驻留少量相同的字符串并释放，相同内容在不同线程间共享，
+ * 计数在加锁查找和无锁增加之间竞争，结束时所有字符串都应当释放
+ * TEST_CHECK 的计数不是线程安全的，工作线程只记录错误次数，由主线程检查
+*/
+static void *str_worker(void *arg)
+{
+    str_worker_t *worker = (str_worker_t *)arg;
+    const char *held[STR_KEYS] = { 0 };
+    char key[32];
+    int k, len;
+
+    for (int i = 0; i < STR_ROUNDS; i++) {
+        k = rand_r(&worker->seed) % STR_KEYS;
+
+        if (held[k]) {
+            if (rand_r(&worker->seed) & 1) {
+                linx_process_str_unref(held[k]);
+                held[k] = NULL;
+            } else {
+                linx_process_str_unref(linx_process_str_ref(held[k]));
+            }
+            continue;
+        }
+
+        len = snprintf(key, sizeof(key), "/proc/key/%d", k);
+        held[k] = linx_process_str_intern(key, len);
+        if (strcmp(held[k], key) != 0) {
+            worker->mismatches++;
+        }
+    }
+
+    for (k = 0; k < STR_KEYS; k++) {
+        linx_process_str_unref(held[k]);
+    }
+
+    return NULL;
+}
+
+static void test_str_threads(void)
+{
+    str_worker_t workers[STR_THREADS];
+    uint64_t count, bytes, refs;
+
+    for (int i = 0; i < STR_THREADS; i++) {
+        workers[i].seed = i + 1;
+        workers[i].mismatches = 0;
+        pthread_create(&workers[i].thread, NULL, str_worker, &workers[i]);
+    }
+
+    for (int i = 0; i < STR_THREADS; i++) {
+        pthread_join(workers[i].thread, NULL);
+        TEST_CHECK(workers[i].mismatches == 0, "thread %d: %d strings interned with wrong content",
+                   i, workers[i].mismatches);
+    }
+
+    linx_process_str_stats(&count, &bytes, &refs);
+    TEST_CHECK(count == 0 && bytes == 0 && refs == 0, "threads left count %lu bytes %lu refs %lu",
+               (unsigned long)count, (unsigned long)bytes, (unsigned long)refs);
+}
+
+int main(void)
+{
+    test_str_intern();
+    test_str_empty();
+    test_str_threads();
+
+    return TEST_REPORT();
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "linx_test.h"
+#include "linx_log.h"
+#include "linx_hash_map.h"
+#include "linx_event_rich.h"
+#include "linx_rule_engine_ast.h"
+#include "linx_rule_engine_load.h"
+#include "linx_rule_engine_set.h"
+#include "rule_match_vm.h"
+
+/**
+ * 规则加载自测
+ * 随项目发布的每个规则文件和整个规则目录都要能加载，
+ * 规则中引用的字段还没有注册时，该比较编译为常量假，不影响规则加载
+*/
+
+#ifndef TEST_TOPDIR
+#define TEST_TOPDIR "."
+#endif
+
+#define RULES_DIR TEST_TOPDIR "/yaml_config/linx_apd_rules"
+
+static size_t load_rules(const char *path)
+{
+    linx_rule_set_t *set;
+    size_t size = 0;
+
+    TEST_CHECK(linx_rule_engine_load(path) == 0, "load %s", path);
+
+    set = linx_rule_set_get();
+    if (set) {
+        size = set->size;
+    }
+
+    linx_rule_set_deinit();
+
+    return size;
+}
+
+static void test_load_shipped_rules(void)
+{
+    char path[1024];
+    struct dirent *entry;
+    size_t files = 0, rules = 0, size;
+    DIR *dir;
+
+    dir = opendir(RULES_DIR);
+    TEST_CHECK(dir != NULL, "open %s", RULES_DIR);
+    if (!dir) {
+        return;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", RULES_DIR, entry->d_name);
+        size = load_rules(path);
+        TEST_CHECK(size > 0, "%s has no rule loaded", entry->d_name);
+
+        files++;
+        rules += size;
+    }
+
+    closedir(dir);
+
+    TEST_CHECK(files > 0, "no rule file in %s", RULES_DIR);
+
+    size = load_rules(RULES_DIR);
+    TEST_CHECK(size == rules, "directory loaded %zu rules, files have %zu", size, rules);
+}
+
+/**
+ * 没有注册的字段取不到值，比较为假，取反后为真
+*/
+static void test_unknown_field(void)
+{
+    static const struct {
+        const char *condition;
+        bool expected;
+    } cases[] = {
+        { "fd.name = /etc/passwd", false },
+        { "not fd.name = /etc/passwd", true },
+        { "fd.name startswith /etc and not fd.name = /etc/shadow", false },
+        { "fd.name in (/etc/passwd, /etc/shadow) or not fd.filename endswith .so", true },
+    };
+    linx_rule_memo_t memo = { 0 };
+    linx_rule_match_t *match;
+    linx_field_ctx_t fields;
+    ast_node_t *ast;
+
+    memset(&fields, 0, sizeof(fields));
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(cases); i++) {
+        match = NULL;
+        ast = NULL;
+
+        TEST_CHECK(condition_to_ast(cases[i].condition, &ast) == 0, "parse \"%s\"", cases[i].condition);
+        TEST_CHECK(linx_compile_ast(ast, &match) == 0 && match, "compile \"%s\"", cases[i].condition);
+        if (!match) {
+            continue;
+        }
+
+        TEST_CHECK(linx_rule_vm_exec(match, &fields, &memo) == cases[i].expected, "\"%s\" must be %s",
+                   cases[i].condition, cases[i].expected ? "true" : "false");
+
+        linx_rule_engine_match_destroy(match);
+    }
+}
+
+int main(void)
+{
+    if (linx_log_init("stderr", "ERROR") || linx_hash_map_init() || linx_event_rich_init()) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    test_load_shipped_rules();
+    test_unknown_field();
+
+    linx_event_rich_deinit();
+    linx_hash_map_deinit();
+    linx_log_deinit();
+
+    return TEST_REPORT();
+}
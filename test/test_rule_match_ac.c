@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "linx_test.h"
+#include "rule_match_ac.h"
+
+/**
+ * Aho-Corasick 自动机自测
+ * 每个用例的命中按 "模式:起始-结束" 拼接后与期望比较，命中顺序为扫描顺序
+ * 随机用例与逐个模式的暴力查找比较全部命中
+*/
+
+#define AC_MAX_PATTERNS 16
+#define AC_MAX_HITS     512
+
+typedef struct {
+    const char *patterns[AC_MAX_PATTERNS];
+    const char *value;
+    const char *expected;
+} ac_case_t;
+
+typedef struct {
+    char text[1024];
+    size_t len;
+    uint32_t count;
+    uint32_t hits[AC_MAX_HITS][3];
+} ac_hits_t;
+
+static const ac_case_t s_cases[] = {
+    /* 经典用例，重叠和后缀模式都要报告 */
+    { { "he", "she", "his", "hers" }, "ushers", "1:1-3 0:2-3 3:2-5" },
+    { { "a", "aa", "aaa" }, "aaaa", "0:0-0 1:0-1 0:1-1 2:0-2 1:1-2 0:2-2 2:1-3 1:2-3 0:3-3" },
+    { { "abc" }, "ababcabc", "0:2-4 0:5-7" },
+    { { "abc" }, "ab", "" },
+    { { "abc" }, "", "" },
+    /* 模式互为前缀 */
+    { { "/bin", "/bin/sh", "/bin/bash" }, "/bin/bash -c /bin/sh", "0:0-3 2:0-8 0:13-16 1:13-19" },
+    /* 失败链要跳到更短的后缀，不能回到根 */
+    { { "abcd", "bce" }, "abce", "1:1-3" },
+    { { "nc -e", "ncat", "-e /bin" }, "ncat -e /bin/sh", "1:0-3 2:5-11" },
+    /* 非 ASCII 字节和 '\0' 以外的任意字节都能作为模式 */
+    { { "\xff\xfe", "\x01" }, "a\xff\xfe\x01", "0:1-2 1:3-3" },
+    /* 重复加入同一个模式返回原来的编号，编号连续 */
+    { { "x", "x", "xy" }, "xxy", "0:0-0 0:1-1 1:1-2" },
+};
+
+static void ac_record(void *arg, uint32_t pattern, size_t start, size_t end)
+{
+    ac_hits_t *hits = (ac_hits_t *)arg;
+
+    /* 随机用例只比较 hits，文本写满后不再追加 */
+    if (hits->len < sizeof(hits->text)) {
+        hits->len += snprintf(hits->text + hits->len, sizeof(hits->text) - hits->len,
+                              "%s%u:%zu-%zu", hits->len ? " " : "", pattern, start, end);
+    }
+
+    if (hits->count < AC_MAX_HITS) {
+        hits->hits[hits->count][0] = pattern;
+        hits->hits[hits->count][1] = (uint32_t)start;
+        hits->hits[hits->count][2] = (uint32_t)end;
+        hits->count++;
+    }
+}
+
+static linx_rule_ac_t *ac_build(const char *const *patterns, size_t count, int *ids)
+{
+    linx_rule_ac_t *ac = linx_rule_ac_create();
+
+    if (!ac) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count && patterns[i]; i++) {
+        ids[i] = linx_rule_ac_add(ac, patterns[i], strlen(patterns[i]));
+    }
+
+    if (linx_rule_ac_build(ac)) {
+        linx_rule_ac_destroy(ac);
+        return NULL;
+    }
+
+    return ac;
+}
+
+static void test_ac_cases(void)
+{
+    int ids[AC_MAX_PATTERNS];
+    linx_rule_ac_t *ac;
+    ac_hits_t hits;
+
+    for (size_t i = 0; i < TEST_ARRAY_SIZE(s_cases); i++) {
+        ac = ac_build(s_cases[i].patterns, AC_MAX_PATTERNS, ids);
+        TEST_CHECK(ac != NULL, "case %zu", i);
+        if (!ac) {
+            continue;
+        }
+
+        memset(&hits, 0, sizeof(hits));
+        linx_rule_ac_scan(ac, s_cases[i].value, strlen(s_cases[i].value), ac_record, &hits);
+        TEST_CHECK(strcmp(hits.text, s_cases[i].expected) == 0,
+                   "case %zu: got \"%s\", expected \"%s\"", i, hits.text, s_cases[i].expected);
+
+        linx_rule_ac_destroy(ac);
+    }
+}
+
+static void test_ac_invalid(void)
+{
+    linx_rule_ac_t *ac = linx_rule_ac_create();
+
+    TEST_CHECK(ac != NULL, "create");
+    if (!ac) {
+        return;
+    }
+
+    TEST_CHECK(linx_rule_ac_add(ac, "", 0) < 0, "empty pattern must be rejected");
+    TEST_CHECK(linx_rule_ac_add(ac, "a", 1) == 0, "first pattern id");
+    TEST_CHECK(linx_rule_ac_add(ac, "b", 1) == 1, "second pattern id");
+    TEST_CHECK(linx_rule_ac_add(ac, "a", 1) == 0, "duplicate pattern keeps its id");
+
+    linx_rule_ac_destroy(ac);
+}
+
+static int hit_compare(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(uint32_t) * 3);
+}
+
+static bool pattern_seen(const char *const *patterns, int i)
+{
+    for (int k = 0; k < i; k++) {
+        if (strcmp(patterns[k], patterns[i]) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * 小字母表上的随机模式和值，命中排序后与暴力查找的结果比较
+*/
+static void test_ac_random(void)
+{
+    const char *patterns[AC_MAX_PATTERNS] = { 0 };
+    char storage[AC_MAX_PATTERNS][8], value[64];
+    uint32_t expected[AC_MAX_HITS][3];
+    int ids[AC_MAX_PATTERNS];
+    unsigned int seed = 1;
+    uint32_t nexpected;
+    size_t value_len, plen;
+    linx_rule_ac_t *ac;
+    ac_hits_t hits;
+    int npatterns;
+
+    for (int round = 0; round < 2000; round++) {
+        npatterns = 1 + rand_r(&seed) % 8;
+        for (int i = 0; i < npatterns; i++) {
+            plen = 1 + rand_r(&seed) % 4;
+            for (size_t j = 0; j < plen; j++) {
+                storage[i][j] = 'a' + rand_r(&seed) % 3;
+            }
+            storage[i][plen] = '\0';
+            patterns[i] = storage[i];
+        }
+        patterns[npatterns] = NULL;
+
+        value_len = rand_r(&seed) % 40;
+        for (size_t j = 0; j < value_len; j++) {
+            value[j] = 'a' + rand_r(&seed) % 3;
+        }
+        value[value_len] = '\0';
+
+        ac = ac_build(patterns, AC_MAX_PATTERNS, ids);
+        if (!ac) {
+            TEST_CHECK(ac != NULL, "round %d", round);
+            continue;
+        }
+
+        memset(&hits, 0, sizeof(hits));
+        linx_rule_ac_scan(ac, value, value_len, ac_record, &hits);
+        linx_rule_ac_destroy(ac);
+
+        /* 重复的模式编号相同，只统计第一次出现的 */
+        nexpected = 0;
+        for (int i = 0; i < npatterns; i++) {
+            if (pattern_seen(patterns, i)) {
+                continue;
+            }
+
+            plen = strlen(patterns[i]);
+            for (size_t start = 0; start + plen <= value_len; start++) {
+                if (memcmp(value + start, patterns[i], plen) == 0 && nexpected < TEST_ARRAY_SIZE(expected)) {
+                    expected[nexpected][0] = (uint32_t)ids[i];
+                    expected[nexpected][1] = (uint32_t)start;
+                    expected[nexpected][2] = (uint32_t)(start + plen - 1);
+                    nexpected++;
+                }
+            }
+        }
+
+        qsort(expected, nexpected, sizeof(expected[0]), hit_compare);
+        qsort(hits.hits, hits.count, sizeof(hits.hits[0]), hit_compare);
+
+        TEST_CHECK(hits.count == nexpected && memcmp(hits.hits, expected, nexpected * sizeof(expected[0])) == 0,
+                   "round %d: value \"%s\", %u hits, expected %u", round, value, hits.count, nexpected);
+    }
+}
+
+int main(void)
+{
+    test_ac_cases();
+    test_ac_invalid();
+    test_ac_random();
+
+    return TEST_REPORT();
+}
@@ -0,0 +1,215 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fnmatch.h>
+
+#include "linx_test.h"
+#include "rule_match_glob.h"
+
+/**
+ * glob 自测
+ * 编译后的分段匹配与 fnmatch(3) 比较，glob 对应不带标志的 fnmatch，iglob 对应 FNM_CASEFOLD
+ * 用例表覆盖 '*'、'?'、[...]、'\' 转义、首尾锚定和多段模式，随机用例在小字母表上组合这些元素
+*/
+
+typedef struct {
+    const char *pattern;
+    const char *required;           /* linx_rule_glob_required 的期望值，NULL 表示没有 */
+} glob_pattern_t;
+
+static const glob_pattern_t s_patterns[] = {
+    /* 没有 '*' 时首尾都锚定 */
+    { "", NULL },
+    { "abc", "abc" },
+    { "a?c", NULL },
+    { "???", NULL },
+    /* 首尾锚定 */
+    { "*", NULL },
+    { "abc*", "abc" },
+    { "*abc", "abc" },
+    { "*abc*", "abc" },
+    { "**abc**", "abc" },
+    /* 多段，段之间跳过任意字符，'*' 也匹配 '/' */
+    { "/usr/*/bin/*", "/usr/" },     /* 长度相同时取第一段 */
+    { "*/python*", "/python" },
+    { "a*b*c", "a" },
+    { "*ab*ab*", "ab" },
+    { "*aab*ab", "aab" },
+    { "a*a*a*a", "a" },
+    { "*.sh", ".sh" },
+    { "/tmp/*.s?", "/tmp/" },
+    /* 字符集 */
+    { "[abc]", NULL },
+    { "[a-c]x", NULL },
+    { "[!a-c]x", NULL },
+    { "[^a-c]x", NULL },
+    { "[]a]", NULL },
+    { "[!]a]", NULL },
+    { "[a-]", NULL },
+    { "[-a]", NULL },
+    { "[\\]]", NULL },
+    { "[A-Z]*", NULL },
+    { "*[0-9][0-9]", NULL },
+    { "*/[.]*", NULL },
+    /* 没有闭合的 '[' 按普通字符处理 */
+    { "[abc", "[abc" },
+    { "*[", "[" },
+    /* 转义 */
+    { "\\*", "*" },
+    { "a\\?c", "a?c" },
+    { "\\[abc]", "[abc]" },
+    { "*\\**", "*" },
+    { "\\\\x", "\\x" },
+    /* 大小写 */
+    { "*BIN*", "BIN" },
+    { "[B-D]in", NULL },
+    { "\xc1*", "\xc1" },
+};
+
+static const char *s_values[] = {
+    "", "a", "b", "c", "x", "ab", "abc", "abcd", "aabc", "xabc", "abcabc", "ABC", "aBc",
+    "a?c", "axc", "a/c", "]", "]a", "-", "[", "[abc", "[abc]", "*", "**", "a*b", "\\x", "\\",
+    "ax", "dx", "Ax", "-x", "]x",
+    "ab", "aab", "abab", "aabab", "xaabyab", "aaaa", "aaa", "abxc", "ac", "acbc",
+    "/usr/bin", "/usr/local/bin/ls", "/usr//bin/", "/usr/bin/ls",
+    "/usr/bin/python3", "python", "/python", "/opt/python/x",
+    "x.sh", ".sh", "x.sh.bak", "/tmp/a.sh", "/tmp/.sh", "/tmp/a.s",
+    "a1", "a12", "12", "/x/.hidden", "/x/hidden",
+    "/BIN/", "/bin/", "Bin", "bin", "Din", "ein",
+    "\xc1", "\xe1", "\xc1x", "\xe1x",
+};
+
+static bool glob_match(const linx_rule_glob_t *glob, const char *value)
+{
+    return linx_rule_glob_match(glob, value, strlen(value));
+}
+
+static void test_glob_table(void)
+{
+    linx_rule_glob_t *glob, *iglob;
+    const char *required;
+    bool expected;
+    size_t len;
+
+    for (size_t p = 0; p < TEST_ARRAY_SIZE(s_patterns); p++) {
+        glob = linx_rule_glob_compile(s_patterns[p].pattern, false);
+        iglob = linx_rule_glob_compile(s_patterns[p].pattern, true);
+        TEST_CHECK(glob && iglob, "compile \"%s\"", s_patterns[p].pattern);
+        if (!glob || !iglob) {
+            linx_rule_glob_destroy(glob);
+            linx_rule_glob_destroy(iglob);
+            continue;
+        }
+
+        for (size_t v = 0; v < TEST_ARRAY_SIZE(s_values); v++) {
+            expected = fnmatch(s_patterns[p].pattern, s_values[v], 0) == 0;
+            TEST_CHECK(glob_match(glob, s_values[v]) == expected, "glob \"%s\" on \"%s\": expected %d",
+                       s_patterns[p].pattern, s_values[v], expected);
+
+            expected = fnmatch(s_patterns[p].pattern, s_values[v], FNM_CASEFOLD) == 0;
+            TEST_CHECK(glob_match(iglob, s_values[v]) == expected, "iglob \"%s\" on \"%s\": expected %d",
+                       s_patterns[p].pattern, s_values[v], expected);
+        }
+
+        len = 0;
+        required = linx_rule_glob_required(glob, &len);
+        if (s_patterns[p].required) {
+            TEST_CHECK(required && len == strlen(s_patterns[p].required) &&
+                       memcmp(required, s_patterns[p].required, len) == 0,
+                       "required of \"%s\": got \"%.*s\", expected \"%s\"", s_patterns[p].pattern,
+                       required ? (int)len : 6, required ? required : "(null)", s_patterns[p].required);
+        } else {
+            TEST_CHECK(required == NULL, "required of \"%s\": got \"%.*s\", expected none",
+                       s_patterns[p].pattern, (int)len, required);
+        }
+
+        /* 自动机区分大小写，iglob 不提供预筛选的字面量 */
+        TEST_CHECK(linx_rule_glob_required(iglob, &len) == NULL, "iglob \"%s\" has no required literal",
+                   s_patterns[p].pattern);
+
+        linx_rule_glob_destroy(glob);
+        linx_rule_glob_destroy(iglob);
+    }
+}
+
+/**
+ * 值中包含必须出现的字面量是匹配的必要条件
+*/
+static bool glob_required_holds(const linx_rule_glob_t *glob, const char *value, bool matched)
+{
+    const char *required;
+    size_t len;
+
+    required = linx_rule_glob_required(glob, &len);
+    if (!required || !matched) {
+        return true;
+    }
+
+    return memmem(value, strlen(value), required, len) != NULL;
+}
+
+/**
+ * 随机组合模式元素和值，与 fnmatch 比较
+*/
+static void test_glob_random(void)
+{
+    static const char *tokens[] = {
+        "a", "b", "A", "/", "*", "*", "?", "[ab]", "[!a]", "[A-B]", "\\*", "\\a", "[]b]",
+    };
+    static const char value_bytes[] = "abAB/*]";
+    char pattern[64], value[32];
+    linx_rule_glob_t *glob, *iglob;
+    unsigned int seed = 1;
+    size_t plen, vlen;
+    bool expected, got;
+    int ntokens;
+
+    for (int round = 0; round < 3000; round++) {
+        plen = 0;
+        ntokens = 1 + rand_r(&seed) % 6;
+        for (int i = 0; i < ntokens; i++) {
+            plen += snprintf(pattern + plen, sizeof(pattern) - plen, "%s",
+                             tokens[rand_r(&seed) % TEST_ARRAY_SIZE(tokens)]);
+        }
+
+        glob = linx_rule_glob_compile(pattern, false);
+        iglob = linx_rule_glob_compile(pattern, true);
+        TEST_CHECK(glob && iglob, "compile \"%s\"", pattern);
+        if (!glob || !iglob) {
+            linx_rule_glob_destroy(glob);
+            linx_rule_glob_destroy(iglob);
+            continue;
+        }
+
+        for (int k = 0; k < 20; k++) {
+            vlen = rand_r(&seed) % 10;
+            for (size_t i = 0; i < vlen; i++) {
+                value[i] = value_bytes[rand_r(&seed) % (sizeof(value_bytes) - 1)];
+            }
+            value[vlen] = '\0';
+
+            expected = fnmatch(pattern, value, 0) == 0;
+            got = glob_match(glob, value);
+            TEST_CHECK(got == expected, "glob \"%s\" on \"%s\": expected %d", pattern, value, expected);
+            TEST_CHECK(glob_required_holds(glob, value, got), "glob \"%s\" matched \"%s\" without its literal",
+                       pattern, value);
+
+            expected = fnmatch(pattern, value, FNM_CASEFOLD) == 0;
+            TEST_CHECK(glob_match(iglob, value) == expected, "iglob \"%s\" on \"%s\": expected %d",
+                       pattern, value, expected);
+        }
+
+        linx_rule_glob_destroy(glob);
+        linx_rule_glob_destroy(iglob);
+    }
+}
+
+int main(void)
+{
+    test_glob_table();
+    test_glob_random();
+
+    return TEST_REPORT();
+}
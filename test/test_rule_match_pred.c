@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "linx_test.h"
+#include "linx_log.h"
+#include "linx_hash_map.h"
+#include "rule_match_pred.h"
+
+/**
+ * 共享谓词自测
+ * 同一字段上的字面量达到一定数量后由一个自动机一次算出整组结果，
+ * 这里检查分组计算(linx_rule_pred_test)与逐个计算(linx_rule_pred_eval)的结果一致，
+ * 并逐个检查 ne、endswith、pmatch 在边界上的期望值
+*/
+
+#define PRED_VALUE_SIZE 128
+
+typedef struct {
+    linx_rule_op_t op;
+    const char *strs[4];
+} pred_def_t;
+
+/* 前三个谓词有逐个的期望值，其余的让字段上的字面量数量超过分组的阈值 */
+static const pred_def_t s_preds[] = {
+    { LINX_RULE_OP_STR_NE, { "/bin/sh" } },
+    { LINX_RULE_OP_STR_ENDSWITH, { ".sh" } },
+    { LINX_RULE_OP_LIST_PMATCH, { "/etc", "/usr/lib/", "/var/log" } },
+    { LINX_RULE_OP_STR_EQ, { "/bin/sh" } },
+    { LINX_RULE_OP_STR_NE, { "/usr/bin/bash" } },
+    { LINX_RULE_OP_STR_CONTAINS, { "passwd" } },
+    { LINX_RULE_OP_STR_STARTSWITH, { "/tmp/" } },
+    { LINX_RULE_OP_STR_ENDSWITH, { "/nc" } },
+    { LINX_RULE_OP_LIST_IN, { "/bin/bash", "/bin/zsh" } },
+    { LINX_RULE_OP_STR_GLOB, { "*/python*" } },
+    { LINX_RULE_OP_LIST_PMATCH, { "/" } },
+};
+
+typedef struct {
+    const char *value;
+    bool ne;                    /* ne "/bin/sh" */
+    bool endswith;              /* endswith ".sh" */
+    bool pmatch;                /* pmatch (/etc, /usr/lib/, /var/log) */
+} pred_case_t;
+
+static const pred_case_t s_cases[] = {
+    { "/bin/sh", false, false, false },
+    { "/bin/sh/", true, false, false },
+    { "/bin/s", true, false, false },
+    { "", true, false, false },
+    { ".sh", true, true, false },
+    { "sh", true, false, false },
+    { "/tmp/x.sh", true, true, false },
+    { "a.sh.sh", true, true, false },
+    { "/tmp/x.sh.bak", true, false, false },
+    { "/etc", true, false, true },
+    { "/etc/", true, false, true },
+    { "/etc/passwd", true, false, true },
+    { "/etcd/conf", true, false, false },
+    { "/usr/lib", true, false, false },
+    { "/usr/lib/", true, false, true },
+    { "/usr/lib/x.sh", true, true, true },
+    { "/usr/libexec", true, false, false },
+    { "/var/log", true, false, true },
+    { "/var/logs", true, false, false },
+    { "/var/log/messages.sh", true, true, true },
+    { "x/etc", true, false, false },
+    { "/usr/bin/python3", true, false, false },
+};
+
+static char s_value[PRED_VALUE_SIZE];
+static uint32_t s_ids[TEST_ARRAY_SIZE(s_preds)];
+
+static field_result_t pred_field(void)
+{
+    field_result_t field;
+
+    memset(&field, 0, sizeof(field));
+    field.found = true;
+    field.type = LINX_FIELD_TYPE_CHARBUF;
+    field.table_index = 0;
+    field.offset = 0;
+    field.arg_index = -1;
+
+    return field;
+}
+
+static int pred_load(size_t count)
+{
+    field_result_t field;
+    uint32_t nstrs;
+    int id;
+
+    for (size_t i = 0; i < count; i++) {
+        field = pred_field();
+        for (nstrs = 0; nstrs < TEST_ARRAY_SIZE(s_preds[i].strs) && s_preds[i].strs[nstrs]; nstrs++);
+
+        id = linx_rule_pred_intern(s_preds[i].op, &field, 0, (const char **)s_preds[i].strs, nstrs);
+        if (id < 0) {
+            return -1;
+        }
+
+        s_ids[i] = (uint32_t)id;
+    }
+
+    return linx_rule_pred_build();
+}
+
+static void memo_reset(linx_rule_memo_t *memo)
+{
+    memset(memo->known, 0, memo->words * sizeof(uint64_t));
+    memset(memo->value, 0, memo->words * sizeof(uint64_t));
+}
+
+/**
+ * count 个谓词加载到同一字段上，字面量少于阈值时不分组，结果应当相同
+*/
+static void test_pred_cases(size_t count)
+{
+    linx_field_ctx_t fields;
+    linx_rule_memo_t memo;
+    uint32_t id;
+    bool grouped, single;
+
+    memset(&fields, 0, sizeof(fields));
+    fields.bases[0] = s_value;
+
+    if (pred_load(count)) {
+        TEST_CHECK(false, "failed to load %zu predicates", count);
+        linx_rule_pred_deinit();
+        return;
+    }
+
+    memo.words = (linx_rule_pred_count() + 63) / 64;
+    memo.known = calloc(memo.words, sizeof(uint64_t));
+    memo.value = calloc(memo.words, sizeof(uint64_t));
+
+    for (size_t c = 0; c < TEST_ARRAY_SIZE(s_cases); c++) {
+        snprintf(s_value, sizeof(s_value), "%s", s_cases[c].value);
+        memo_reset(&memo);
+
+        TEST_CHECK(linx_rule_pred_test(s_ids[0], &fields, &memo) == s_cases[c].ne,
+                   "%zu preds: ne on \"%s\"", count, s_cases[c].value);
+        TEST_CHECK(linx_rule_pred_test(s_ids[1], &fields, &memo) == s_cases[c].endswith,
+                   "%zu preds: endswith on \"%s\"", count, s_cases[c].value);
+        TEST_CHECK(linx_rule_pred_test(s_ids[2], &fields, &memo) == s_cases[c].pmatch,
+                   "%zu preds: pmatch on \"%s\"", count, s_cases[c].value);
+
+        /* 结果已经缓存，再次查询不会重新计算，也要得到同样的结果 */
+        for (size_t i = 0; i < count; i++) {
+            id = s_ids[i];
+            grouped = linx_rule_pred_test(id, &fields, &memo);
+            single = linx_rule_pred_eval(id, &fields);
+            TEST_CHECK(grouped == single, "%zu preds: predicate %zu on \"%s\": memo %d, eval %d",
+                       count, i, s_cases[c].value, grouped, single);
+            TEST_CHECK(linx_rule_pred_test(id, &fields, &memo) == grouped,
+                       "%zu preds: predicate %zu on \"%s\" changed after memo", count, i, s_cases[c].value);
+        }
+    }
+
+    free(memo.known);
+    free(memo.value);
+    linx_rule_pred_deinit();
+}
+
+/**
+ * 相同的谓词只保存一份
+*/
+static void test_pred_intern(void)
+{
+    field_result_t field = pred_field();
+    const char *strs[] = { "/bin/sh" };
+    int a, b, c;
+
+    a = linx_rule_pred_intern(LINX_RULE_OP_STR_NE, &field, 0, strs, 1);
+    field = pred_field();
+    b = linx_rule_pred_intern(LINX_RULE_OP_STR_NE, &field, 0, strs, 1);
+    field = pred_field();
+    c = linx_rule_pred_intern(LINX_RULE_OP_STR_EQ, &field, 0, strs, 1);
+
+    TEST_CHECK(a >= 0 && a == b, "same predicate must share an id: %d %d", a, b);
+    TEST_CHECK(c >= 0 && c != a, "different operator must get its own id: %d %d", a, c);
+    TEST_CHECK(linx_rule_pred_count() == 2, "count %u", linx_rule_pred_count());
+
+    linx_rule_pred_deinit();
+}
+
+int main(void)
+{
+    linx_log_init("stderr", "ERROR");
+
+    test_pred_intern();
+
+    /* 只有前三个谓词时逐个计算，全部加载后在一个自动机中分组计算 */
+    test_pred_cases(3);
+    test_pred_cases(TEST_ARRAY_SIZE(s_preds));
+
+    linx_log_deinit();
+
+    return TEST_REPORT();
+}
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "linx_test.h"
+#include "rule_match_str.h"
+
+/**
+ * 子串查找自测
+ * 按当前 CPU 选中的实现运行，和逐字节的参考实现比较结果
+ * 值紧贴在不可访问的保护页前后，向量实现读到值以外的字节时会直接崩溃
+*/
+
+#define STR_MAX_NEEDLE  40
+#define STR_MAX_VALUE   100
+
+/* 'A'-'Z' 以外的字节和对应的小写字母只差 0x20，只按位或 0x20 的实现会把它们当成同一个字母 */
+static const char s_value_bytes[] = "aAbB@`[{\xc1\xe1";
+static const char s_needle_bytes[] = "ab`{\xe1";
+
+static char *s_pages = NULL;
+static size_t s_page_size = 0;
+
+static char str_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static const char *str_ref_find(const char *value, size_t value_len, const char *needle, size_t needle_len, bool fold)
+{
+    size_t i;
+
+    for (size_t pos = 0; pos + needle_len <= value_len; pos++) {
+        for (i = 0; i < needle_len; i++) {
+            if ((fold ? str_lower(value[pos + i]) : value[pos + i]) != needle[i]) {
+                break;
+            }
+        }
+
+        if (i == needle_len) {
+            return value + pos;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * 三个页，第一页和第三页不可访问，值放在第二页的开头或结尾
+*/
+static int str_pages_init(void)
+{
+    s_page_size = (size_t)sysconf(_SC_PAGESIZE);
+    s_pages = mmap(NULL, s_page_size * 3, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (s_pages == MAP_FAILED) {
+        return -1;
+    }
+
+    if (mprotect(s_pages, s_page_size, PROT_NONE) ||
+        mprotect(s_pages + s_page_size * 2, s_page_size, PROT_NONE))
+    {
+        munmap(s_pages, s_page_size * 3);
+        return -1;
+    }
+
+    return 0;
+}
+
+static char *str_place(const char *value, size_t value_len, bool at_end)
+{
+    char *dst = at_end ? s_pages + s_page_size * 2 - value_len : s_pages + s_page_size;
+
+    memcpy(dst, value, value_len);
+
+    return dst;
+}
+
+static void str_check(const char *value, size_t value_len, const char *needle, size_t needle_len, bool fold)
+{
+    const char *expected, *got;
+    char *placed;
+
+    for (int at_end = 0; at_end < 2; at_end++) {
+        placed = str_place(value, value_len, at_end);
+        expected = str_ref_find(placed, value_len, needle, needle_len, fold);
+        got = fold ? linx_rule_str_ifind(placed, value_len, needle, needle_len) :
+                     linx_rule_str_find(placed, value_len, needle, needle_len);
+
+        TEST_CHECK(got == expected, "%s: value_len %zu needle_len %zu %s: got %td, expected %td",
+                   fold ? "ifind" : "find", value_len, needle_len, at_end ? "at page end" : "at page start",
+                   got ? got - placed : -1, expected ? expected - placed : -1);
+    }
+}
+
+/**
+ * 每种长度的 needle 放在每一个位置上，忽略大小写时 needle 的字母随机改成大写，
+ * 背景中的字节与 needle 相近，前面可能出现只差最后几个字节的部分匹配
+*/
+static void test_str_tails(bool fold)
+{
+    char value[STR_MAX_VALUE], needle[STR_MAX_NEEDLE];
+    unsigned int seed = 1;
+    char c;
+
+    for (size_t needle_len = 1; needle_len <= STR_MAX_NEEDLE; needle_len++) {
+        for (size_t i = 0; i < needle_len; i++) {
+            needle[i] = s_needle_bytes[rand_r(&seed) % (sizeof(s_needle_bytes) - 1)];
+        }
+
+        for (size_t value_len = 0; value_len <= STR_MAX_VALUE; value_len++) {
+            for (size_t i = 0; i < value_len; i++) {
+                value[i] = s_value_bytes[rand_r(&seed) % (sizeof(s_value_bytes) - 1)];
+            }
+
+            /* 没有放入 needle 的情况 */
+            str_check(value, value_len, needle, needle_len, fold);
+
+            for (size_t pos = 0; pos + needle_len <= value_len; pos++) {
+                for (size_t i = 0; i < needle_len; i++) {
+                    c = needle[i];
+                    value[pos + i] = (fold && c >= 'a' && c <= 'z' && (rand_r(&seed) & 1)) ? c - ('a' - 'A') : c;
+                }
+
+                str_check(value, value_len, needle, needle_len, fold);
+
+                /* 最后一个字节不同，只剩部分匹配 */
+                value[pos + needle_len - 1] = '#';
+                str_check(value, value_len, needle, needle_len, fold);
+            }
+        }
+    }
+}
+
+/**
+ * 与折叠相关的单个字节，只有 'A'-'Z' 会折叠成小写
+*/
+static void test_str_ifind_bytes(void)
+{
+    char value[1], needle[1], longer[64];
+    bool expected;
+
+    for (int v = 0; v < 256; v++) {
+        for (int n = 0; n < 256; n++) {
+            if (str_lower((char)n) != (char)n) {
+                continue;
+            }
+
+            value[0] = (char)v;
+            needle[0] = (char)n;
+            expected = str_lower((char)v) == (char)n;
+
+            /* 放在长一些的值的末尾，走到向量实现的主循环，前面填充的 '#' 本身也会命中 */
+            memset(longer, '#', sizeof(longer));
+            longer[sizeof(longer) - 1] = value[0];
+
+            TEST_CHECK((linx_rule_str_ifind(value, 1, needle, 1) != NULL) == expected,
+                       "ifind byte 0x%02x in 0x%02x", n, v);
+            TEST_CHECK((linx_rule_str_ifind(longer, sizeof(longer), needle, 1) != NULL) == (expected || n == '#'),
+                       "ifind byte 0x%02x in 0x%02x (long)", n, v);
+        }
+    }
+}
+
+static void test_str_edges(void)
+{
+    const char *value = "Hello";
+
+    TEST_CHECK(linx_rule_str_find(value, 5, "", 0) == value, "empty needle matches at start");
+    TEST_CHECK(linx_rule_str_find(value, 5, "Hello!", 6) == NULL, "needle longer than value");
+    TEST_CHECK(linx_rule_str_find(value, 4, "Hello", 5) == NULL, "value_len limits the search");
+    TEST_CHECK(linx_rule_str_find(value, 5, "hello", 5) == NULL, "find is case sensitive");
+    TEST_CHECK(linx_rule_str_find(value, 5, "l", 1) == value + 2, "first occurrence");
+
+    TEST_CHECK(linx_rule_str_ifind(value, 5, "", 0) == value, "empty needle matches at start");
+    TEST_CHECK(linx_rule_str_ifind(value, 0, "", 0) == value, "empty needle in empty value");
+    TEST_CHECK(linx_rule_str_ifind(value, 5, "hello!", 6) == NULL, "needle longer than value");
+    TEST_CHECK(linx_rule_str_ifind(value, 4, "hello", 5) == NULL, "value_len limits the search");
+    TEST_CHECK(linx_rule_str_ifind(value, 5, "hello", 5) == value, "whole value");
+    TEST_CHECK(linx_rule_str_ifind(value, 5, "lo", 2) == value + 3, "suffix");
+}
+
+int main(void)
+{
+    if (str_pages_init()) {
+        fprintf(stderr, "mmap failed\n");
+        return 1;
+    }
+
+    test_str_edges();
+    test_str_ifind_bytes();
+    test_str_tails(false);
+    test_str_tails(true);
+
+    munmap(s_pages, s_page_size * 3);
+
+    return TEST_REPORT();
+}
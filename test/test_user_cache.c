@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <grp.h>
+
+#include "linx_test.h"
+#include "linx_user_cache.h"
+#include "linx_log.h"
+
+/**
+ * uid/gid 缓存自测
+ * 程序中定义的 getpwuid_r/getgrgid_r 替换 libc 的实现，返回带版本号的名称并统计解析次数，
+ * 检查命中时不重新解析、没有的用户也被缓存、有效期到达或 generation 变化后重新解析
+*/
+
+#define UC_UID          4242
+#define UC_BIG_UID      4243            /* 缓冲区小于 UC_BIG_SIZE 时返回 ERANGE */
+#define UC_BIG_SIZE     (16 * 1024)
+#define UC_GID          4242
+
+static int s_version = 1;
+static int s_resolves = 0;
+static char s_name[32];
+
+int getpwuid_r(uid_t uid, struct passwd *pw, char *buffer, size_t size, struct passwd **result)
+{
+    int len;
+
+    s_resolves++;
+    *result = NULL;
+
+    if (uid != UC_UID && uid != UC_BIG_UID) {
+        return 0;
+    }
+
+    if (uid == UC_BIG_UID && size < UC_BIG_SIZE) {
+        return ERANGE;
+    }
+
+    len = snprintf(buffer, size, "user%u-v%d%c/home/u%c/bin/sh", uid, s_version, '\0', '\0');
+    if (len < 0 || (size_t)len + 1 > size) {
+        return ERANGE;
+    }
+
+    memset(pw, 0, sizeof(*pw));
+    pw->pw_uid = uid;
+    pw->pw_name = buffer;
+    pw->pw_dir = buffer + strlen(buffer) + 1;
+    pw->pw_shell = pw->pw_dir + strlen(pw->pw_dir) + 1;
+    *result = pw;
+
+    return 0;
+}
+
+int getgrgid_r(gid_t gid, struct group *gr, char *buffer, size_t size, struct group **result)
+{
+    s_resolves++;
+    *result = NULL;
+
+    if (gid != UC_GID) {
+        return 0;
+    }
+
+    snprintf(buffer, size, "group%u-v%d", gid, s_version);
+
+    memset(gr, 0, sizeof(*gr));
+    gr->gr_gid = gid;
+    gr->gr_name = buffer;
+    *result = gr;
+
+    return 0;
+}
+
+static const char *uc_name(const char *prefix, unsigned int id, int version)
+{
+    snprintf(s_name, sizeof(s_name), "%s%u-v%d", prefix, id, version);
+    return s_name;
+}
+
+/**
+ * 命中、没有该用户和缓冲区扩大
+*/
+static void test_uc_lookup(void)
+{
+    time_t expire, expire2;
+    char name[8];
+    group_t group;
+    user_t user;
+    int resolves;
+
+    s_resolves = 0;
+
+    TEST_CHECK(linx_user_cache_get_user(UC_UID, &user, &expire) == 0, "get user");
+    TEST_CHECK(strcmp(user.name, uc_name("user", UC_UID, 1)) == 0, "name %s", user.name);
+    TEST_CHECK(strcmp(user.homedir, "/home/u") == 0 && strcmp(user.shell, "/bin/sh") == 0,
+               "homedir %s shell %s", user.homedir, user.shell);
+    TEST_CHECK(user.uid == UC_UID && user.loginuid == -1 && user.loginname[0] == '\0', "uid and login");
+    TEST_CHECK(s_resolves == 1, "resolves %d", s_resolves);
+
+    /* 命中时返回缓存的副本，不再解析 */
+    s_version = 2;
+    TEST_CHECK(linx_user_cache_get_user(UC_UID, &user, &expire2) == 0, "get user again");
+    TEST_CHECK(strcmp(user.name, uc_name("user", UC_UID, 1)) == 0, "cached name %s", user.name);
+    TEST_CHECK(expire2 == expire, "expire changed on hit");
+    TEST_CHECK(linx_user_cache_get_name(UC_UID, name, sizeof(name)) == 0 && strcmp(name, "user424") == 0,
+               "name truncated to buffer: %s", name);
+    TEST_CHECK(s_resolves == 1, "resolves %d after hits", s_resolves);
+
+    /* 没有的用户也缓存，只保留 uid */
+    resolves = s_resolves;
+    memset(&user, 0x5a, sizeof(user));
+    TEST_CHECK(linx_user_cache_get_user(777, &user, NULL) == -1, "missing user");
+    TEST_CHECK(user.uid == 777 && user.name[0] == '\0', "missing user uid %u name %s", user.uid, user.name);
+    TEST_CHECK(linx_user_cache_get_name(777, name, sizeof(name)) == -1, "missing name");
+    TEST_CHECK(s_resolves == resolves + 1, "missing user resolved %d times", s_resolves - resolves);
+
+    /* 缓冲区不够时扩大后重试 */
+    TEST_CHECK(linx_user_cache_get_user(UC_BIG_UID, &user, NULL) == 0, "big user");
+    TEST_CHECK(strcmp(user.name, uc_name("user", UC_BIG_UID, 2)) == 0, "big user name %s", user.name);
+
+    TEST_CHECK(linx_user_cache_get_group(UC_GID, &group, NULL) == 0, "get group");
+    TEST_CHECK(group.gid == UC_GID && strcmp(group.name, uc_name("group", UC_GID, 2)) == 0,
+               "group name %s", group.name);
+    TEST_CHECK(linx_user_cache_get_group(778, &group, NULL) == -1 && group.gid == 778, "missing group");
+}
+
+/**
+ * 有效期到达之后重新解析
+*/
+static void test_uc_ttl(void)
+{
+    time_t expire, expire2;
+    user_t user;
+    int resolves;
+
+    linx_user_cache_get_user(UC_UID, &user, &expire);
+
+    while (time(NULL) < expire) {
+        usleep(100000);
+    }
+
+    s_version = 3;
+    resolves = s_resolves;
+    TEST_CHECK(linx_user_cache_get_user(UC_UID, &user, &expire2) == 0, "get user after ttl");
+    TEST_CHECK(strcmp(user.name, uc_name("user", UC_UID, 3)) == 0, "name after ttl %s", user.name);
+    TEST_CHECK(expire2 > expire, "expire %ld not extended from %ld", (long)expire2, (long)expire);
+    TEST_CHECK(s_resolves == resolves + 1, "resolved %d times after ttl", s_resolves - resolves);
+}
+
+/**
+ * 不过期时只在 /etc/passwd 变化后重新解析
+ * 以追加方式打开再关闭 /etc/passwd，内容不变，但会产生 IN_CLOSE_WRITE
+*/
+static void test_uc_generation(void)
+{
+    uint32_t generation;
+    time_t expire;
+    user_t user;
+    int fd;
+
+    linx_user_cache_deinit();
+    linx_user_cache_init(0);
+
+    s_version = 4;
+    linx_user_cache_get_user(UC_UID, &user, &expire);
+    TEST_CHECK(strcmp(user.name, uc_name("user", UC_UID, 4)) == 0, "name after reinit %s", user.name);
+
+    fd = open("/etc/passwd", O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        printf("skip generation check: /etc/passwd is not writable\n");
+        return;
+    }
+
+    TEST_CHECK(expire == (time_t)INT64_MAX, "ttl 0 must not expire, got %ld", (long)expire);
+
+    generation = linx_user_cache_generation();
+    close(fd);
+
+    for (int i = 0; i < 50 && linx_user_cache_generation() == generation; i++) {
+        usleep(100000);
+    }
+
+    TEST_CHECK(linx_user_cache_generation() != generation, "generation not bumped");
+
+    s_version = 5;
+    linx_user_cache_get_user(UC_UID, &user, NULL);
+    TEST_CHECK(strcmp(user.name, uc_name("user", UC_UID, 5)) == 0, "name after generation %s", user.name);
+}
+
+int main(void)
+{
+    linx_log_init("stderr", "ERROR");
+    linx_user_cache_init(1);
+
+    test_uc_lookup();
+    test_uc_ttl();
+    test_uc_generation();
+
+    linx_user_cache_deinit();
+    linx_log_deinit();
+
+    return TEST_REPORT();
+}
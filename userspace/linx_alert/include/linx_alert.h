@@ -67,11 +67,11 @@ int linx_alert_set_config_enable(linx_alert_type_t type, bool enable);
 int linx_alert_update_config(linx_alert_config_t config);
 
 /* 核心输出函数 */
-int linx_alert_send_async(linx_output_match_t *output, const char *rule_name, int priority);
-int linx_alert_send_sync(linx_output_match_t *output, const char *rule_name, int priority);
+int linx_alert_send_async(linx_output_match_t *output, linx_field_ctx_t *fields, const char *rule_name, int priority);
+int linx_alert_send_sync(linx_output_match_t *output, linx_field_ctx_t *fields, const char *rule_name, int priority);
 
 /* 格式化和发送函数 */
-int linx_alert_format_and_send(linx_output_match_t *output, const char *rule_name, int priority);
+int linx_alert_format_and_send(linx_output_match_t *output, linx_field_ctx_t *fields, const char *rule_name, int priority);
 
 /* 统计信息函数 */
 void linx_alert_get_stats(long *total_send, long *total_fail);
@@ -188,7 +188,7 @@ int linx_alert_update_config(linx_alert_config_t config)
  * @param priority 告警优先级
  * @return 成功返回0，失败返回-1
  */
-int linx_alert_send_async(linx_output_match_t *output, const char *rule_name, int priority)
+int linx_alert_send_async(linx_output_match_t *output, linx_field_ctx_t *fields, const char *rule_name, int priority)
 {
     char buffer[4096];
     int ret;
@@ -200,8 +200,8 @@ int linx_alert_send_async(linx_output_match_t *output, const char *rule_name, in
         return -1;
     }
 
-    // 格式化输出匹配信息到缓冲区
-    ret = linx_output_match_format(output, buffer, sizeof(buffer));
+    // 格式化输出匹配信息到缓冲区，事件上下文只在匹配线程中有效，必须在这里格式化
+    ret = linx_output_match_format(output, fields, buffer, sizeof(buffer));
     if (ret < 0) {
         return -1;
     }
@@ -237,7 +237,7 @@ int linx_alert_send_async(linx_output_match_t *output, const char *rule_name, in
     return 0;
 }
 
-int linx_alert_send_sync(linx_output_match_t *output, const char *rule_name, int priority)
+int linx_alert_send_sync(linx_output_match_t *output, linx_field_ctx_t *fields, const char *rule_name, int priority)
 {
     int ret;
     char buffer[4096];
@@ -247,7 +247,7 @@ int linx_alert_send_sync(linx_output_match_t *output, const char *rule_name, int
         return -1;
     }
 
-    ret = linx_output_match_format(output, buffer, sizeof(buffer));
+    ret = linx_output_match_format(output, fields, buffer, sizeof(buffer));
     if (ret) {
         return -1;
     }
@@ -269,9 +269,9 @@ int linx_alert_send_sync(linx_output_match_t *output, const char *rule_name, int
 }
 
 /* 格式化和发送函数 */
-int linx_alert_format_and_send(linx_output_match_t *output, const char *rule_name, int priority)
+int linx_alert_format_and_send(linx_output_match_t *output, linx_field_ctx_t *fields, const char *rule_name, int priority)
 {
-    return linx_alert_send_sync(output, rule_name, priority);
+    return linx_alert_send_sync(output, fields, rule_name, priority);
 }
 
 /* 统计信息函数 */
@@ -9,11 +9,11 @@ typedef enum {
     LINX_RESOURCE_CLEANUP_HASH_MAP,
     LINX_RESOURCE_CLEANUP_PROCESS_CACHE,
     LINX_RESOURCE_CLEANUP_MACHINE_STATUS,
-    LINX_RESOURCE_CLEANUP_EVENT_QUEUE,
     LINX_RESOURCE_CLEANUP_EVENT_RICH,
     LINX_RESOURCE_CLEANUP_ALERT,
     LINX_RESOURCE_CLEANUP_RULE_ENGINE,
     LINX_RESOURCE_CLEANUP_ENGINE,
+    LINX_RESOURCE_CLEANUP_EVENT_PROCESSOR,
     LINX_RESOURCE_CLEANUP_MAX
 } linx_resource_cleanup_type_t;
 
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <signal.h>
+#include <unistd.h>
 
 #include "linx_log.h"
 #include "linx_alert.h"
@@ -14,45 +15,23 @@
 #include "linx_rule_engine_load.h"
 #include "linx_rule_engine_match.h"
 #include "linx_rule_engine_set.h"
+#include "linx_rule_engine_pushdown.h"
 #include "linx_resource_cleanup.h"
-#include "linx_event_queue.h"
+#include "linx_event_processor.h"
 #include "linx_event.h"
 #include "linx_process_cache.h"
 #include "linx_machine_status.h"
 
-static int linx_event_loop(void)
+static int linx_apd_event_processor_init(linx_global_config_t *config)
 {
-    int ret = 0;
-    linx_event_t *event = NULL;
-
-    ret = linx_engine_start();
-    if (ret) {
-
-    }
-
-    while (1) {
-        ret = linx_engine_next(&event);
-        if (ret <= 0) {
-            continue;
-        }
-
-        ret = linx_event_rich(event);
-        if (ret) {
-
-        }
-
-        ret = linx_event_queue_push();
-        if (ret) {
-
-        }
-
-        ret = linx_rule_set_match_rule();
-        if (ret) {
-
-        }
-    }
-
-    return ret;
+    linx_event_processor_config_t processor_config = {
+        .queue_capacity = config->event_queue.capacity,
+        .queue_policy = config->event_queue.policy,
+        .fetcher_pool_config = config->event_processor.fetcher,
+        .matcher_pool_config = config->event_processor.matcher,
+    };
+
+    return linx_event_processor_init(&processor_config);
 }
 
 int main(int argc, char *argv[])
@@ -147,13 +126,6 @@ int main(int argc, char *argv[])
         *type = LINX_RESOURCE_CLEANUP_MACHINE_STATUS;
    }
 
-    ret = linx_event_queue_init(2);
-    if (ret) {
-        LINX_LOG_ERROR("linx_event_queue_init failed\n");
-    } else {
-        *type = LINX_RESOURCE_CLEANUP_EVENT_QUEUE;
-    }
-
     ret = linx_event_rich_init();
     if (ret) {
 
@@ -182,6 +154,13 @@ int main(int argc, char *argv[])
         *type = LINX_RESOURCE_CLEANUP_RULE_ENGINE;
     }
 
+    /* 根据规则生成内核要采集的系统调用和过滤表，需要在采集模块初始化之前 */
+    ret = linx_rule_pushdown_apply(linx_global_config);
+    if (ret) {
+        LINX_LOG_ERROR("linx_rule_pushdown_apply failed");
+        goto out;
+    }
+
     /* 根据配置初始化采集模块 */
     ret = linx_engine_init(linx_global_config);
     if (ret) {
@@ -191,10 +170,31 @@ int main(int argc, char *argv[])
         *type = LINX_RESOURCE_CLEANUP_ENGINE;
     }
 
-    /* 启动事件循环，采集数据 */
-    ret = linx_event_loop();
+    /* 事件处理流水线初始化，线程在此时创建 */
+    ret = linx_apd_event_processor_init(linx_global_config);
+    if (ret) {
+        LINX_LOG_ERROR("linx_event_processor_init failed");
+        goto out;
+    } else {
+        *type = LINX_RESOURCE_CLEANUP_EVENT_PROCESSOR;
+    }
+
+    ret = linx_engine_start();
+    if (ret) {
+        LINX_LOG_ERROR("linx_engine_start failed");
+        goto out;
+    }
+
+    /* 启动采集和匹配线程 */
+    ret = linx_event_processor_start();
     if (ret) {
-        LINX_LOG_ERROR("linx_event_loop failed");
+        LINX_LOG_ERROR("linx_event_processor_start failed");
+        goto out;
+    }
+
+    /* 事件都由流水线线程处理，主线程只等待退出信号 */
+    while (1) {
+        pause();
     }
 
 out:
@@ -8,10 +8,11 @@
 #include "linx_hash_map.h"
 #include "linx_event_rich.h"
 #include "linx_arg_parser.h"
-#include "linx_event_queue.h"
+#include "linx_event_processor.h"
 #include "linx_rule_engine_load.h"
 #include "linx_rule_engine_match.h"
 #include "linx_rule_engine_set.h"
+#include "linx_rule_engine_pushdown.h"
 #include "linx_resource_cleanup.h"
 #include "linx_process_cache.h"
 #include "linx_machine_status.h"
@@ -26,16 +27,22 @@ linx_resource_cleanup_type_t *linx_resource_cleanup_get(void)
 void linx_resource_cleanup(void)
 {
     switch (linx_resource_cleanup_type) {
+    case LINX_RESOURCE_CLEANUP_EVENT_PROCESSOR:
+        /* 先等待流水线线程退出，后面的资源都可能被它们使用 */
+        linx_event_processor_deinit();
+        /* fall through */
     case LINX_RESOURCE_CLEANUP_ENGINE:
+        /* 采集线程已经退出，关闭采集模块并输出采集统计 */
+        linx_engine_close();
+        /* fall through */
     case LINX_RESOURCE_CLEANUP_RULE_ENGINE:
         linx_rule_set_deinit();
+        linx_rule_pushdown_deinit();
         /* fall through */
     case LINX_RESOURCE_CLEANUP_ALERT:
         linx_alert_deinit();
         /* fall through */
     case LINX_RESOURCE_CLEANUP_EVENT_RICH:
-    case LINX_RESOURCE_CLEANUP_EVENT_QUEUE:
-        linx_event_queue_free();
         /* fall through */
     case LINX_RESOURCE_CLEANUP_MACHINE_STATUS:
         linx_machine_status_deinit();
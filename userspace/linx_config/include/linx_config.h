@@ -6,6 +6,36 @@
 
 #include "linx_size_define.h"
 #include "linx_syscall_id.h"
+#include "linx_type.h"
+
+/**
+ * 采集模块没有数据时的等待策略
+*/
+typedef enum {
+    LINX_WAIT_MODE_SPIN,        /* 一直忙等，延迟最低 */
+    LINX_WAIT_MODE_EPOLL,       /* 直接阻塞在 epoll 上 */
+    LINX_WAIT_MODE_ADAPTIVE,    /* 先忙等 spin_count 次，再阻塞在 epoll 上 */
+    LINX_WAIT_MODE_MAX,
+} linx_wait_mode_t;
+
+/**
+ * 事件队列满时的处理策略
+*/
+typedef enum {
+    LINX_QUEUE_POLICY_BLOCK,        /* 生产者等待，压力传导到内核 ringbuf */
+    LINX_QUEUE_POLICY_DROP_OLDEST,  /* 丢弃队列中最旧的事件 */
+    LINX_QUEUE_POLICY_DROP_NEWEST,  /* 丢弃正要入队的事件 */
+    LINX_QUEUE_POLICY_MAX,
+} linx_queue_policy_t;
+
+/**
+ * 事件处理流水线中一组线程的配置
+*/
+typedef struct {
+    uint32_t thread_count;
+    bool cpu_affinity;          /* 每个线程绑定到一个CPU */
+    int priority;               /* 线程的 nice 值，0 表示不修改 */
+} linx_thread_pool_config_t;
 
 typedef struct {
     struct {
@@ -13,6 +43,24 @@ typedef struct {
         char *log_level;
     } log_config;
 
+    struct {
+        uint32_t capacity;              /* 向上取整为2的幂 */
+        linx_queue_policy_t policy;
+    } event_queue;
+
+    struct {
+        linx_thread_pool_config_t fetcher;
+        linx_thread_pool_config_t matcher;  /* thread_count 为0时使用 CPU 数 */
+    } event_processor;
+
+    struct {
+        uint32_t reconcile_interval;    /* 对照 /proc 校正进程缓存的间隔秒数，0 表示只在启动时扫描 */
+    } process_cache;
+
+    struct {
+        uint32_t ttl;                   /* uid/gid 到名称的缓存有效期秒数，0 表示只在文件变化后刷新 */
+    } user_cache;
+
     struct {
         char *kind;
 
@@ -24,9 +72,24 @@ typedef struct {
             struct {
                 bool drop_mode;
                 bool drop_failed;
+                uint8_t filter_pid_mode;        /* linx_filter_mode_t */
+                uint8_t filter_comm_mode;       /* linx_filter_mode_t */
+                uint8_t filter_uid_mode;        /* linx_filter_mode_t */
+                bool rule_pushdown;             /* 根据规则生成要采集的系统调用和过滤表 */
                 uint32_t filter_pids[LINX_BPF_FILTER_PID_MAX_SIZE];
                 uint8_t filter_comms[LINX_BPF_FILTER_COMM_MAX_SIZE][LINX_COMM_MAX_SIZE];
+                uint32_t filter_uids[LINX_BPF_FILTER_UID_MAX_SIZE];
+                uint32_t filter_uid_count;      /* uid 可以为0，不能以0作为列表结束 */
                 uint8_t interest_syscall_table[LINX_SYSCALL_ID_MAX];
+                uint32_t ringbuf_size;          /* 每个CPU的ringbuf大小，字节 */
+                uint32_t event_context_mask;    /* 进程快照附带的上下文段，linx_event_context_type_t 的组合 */
+
+                struct {
+                    linx_wait_mode_t mode;
+                    uint32_t spin_count;
+                    int timeout_ms;
+                    uint32_t wakeup_threshold;  /* ringbuf 中未读数据达到该字节数才唤醒用户态 */
+                } wait;
             } ebpf;
         } data;
     } engine;
@@ -11,6 +11,7 @@
 #include "linx_config.h"
 #include "linx_yaml.h"
 #include "linx_event_table.h"
+#include "linx_event.h"
 
 linx_global_config_t *linx_global_config = NULL;
 
@@ -20,7 +21,14 @@ static int linx_config_fill_interest_syscall_table(char *file_path)
     char *jsonstr;
     struct stat file_stat;
     off_t byte_read;
-    int fd = open(file_path, O_RDONLY);
+    int fd;
+
+    /* 开启 rule_pushdown 时可以不配置，由规则生成 */
+    if (!file_path) {
+        return 0;
+    }
+
+    fd = open(file_path, O_RDONLY);
     if (fd < 0) {
         LINX_LOG_ERROR("open %s failed", file_path);
         return -1;
@@ -78,6 +86,103 @@ static int linx_config_fill_interest_syscall_table(char *file_path)
     return 0;
 }
 
+static linx_wait_mode_t linx_config_parse_wait_mode(const char *mode)
+{
+    if (strcmp(mode, "spin") == 0) {
+        return LINX_WAIT_MODE_SPIN;
+    } else if (strcmp(mode, "epoll") == 0) {
+        return LINX_WAIT_MODE_EPOLL;
+    } else if (strcmp(mode, "adaptive") == 0) {
+        return LINX_WAIT_MODE_ADAPTIVE;
+    }
+
+    LINX_LOG_WARNING("unknown engine.ebpf.wait.mode '%s', use adaptive", mode);
+    return LINX_WAIT_MODE_ADAPTIVE;
+}
+
+static linx_queue_policy_t linx_config_parse_queue_policy(const char *policy)
+{
+    if (strcmp(policy, "block") == 0) {
+        return LINX_QUEUE_POLICY_BLOCK;
+    } else if (strcmp(policy, "drop_oldest") == 0) {
+        return LINX_QUEUE_POLICY_DROP_OLDEST;
+    } else if (strcmp(policy, "drop_newest") == 0) {
+        return LINX_QUEUE_POLICY_DROP_NEWEST;
+    }
+
+    LINX_LOG_WARNING("unknown event_queue.policy '%s', use block", policy);
+    return LINX_QUEUE_POLICY_BLOCK;
+}
+
+static void linx_config_fill_thread_pool(linx_yaml_node_t *root, const char *prefix,
+                                         linx_thread_pool_config_t *pool, int default_count)
+{
+    char path[128];
+
+    snprintf(path, sizeof(path), "%s.threads", prefix);
+    pool->thread_count = linx_yaml_get_int(root, path, default_count);
+
+    snprintf(path, sizeof(path), "%s.cpu_affinity", prefix);
+    pool->cpu_affinity = linx_yaml_get_bool(root, path, false);
+
+    snprintf(path, sizeof(path), "%s.priority", prefix);
+    pool->priority = linx_yaml_get_int(root, path, 0);
+}
+
+static uint8_t linx_config_parse_filter_mode(const char *mode)
+{
+    if (strcmp(mode, "exclude") == 0) {
+        return LINX_FILTER_MODE_EXCLUDE;
+    } else if (strcmp(mode, "include") == 0) {
+        return LINX_FILTER_MODE_INCLUDE;
+    }
+
+    LINX_LOG_WARNING("unknown filter mode '%s', use exclude", mode);
+    return LINX_FILTER_MODE_EXCLUDE;
+}
+
+static uint32_t linx_config_parse_event_context(linx_yaml_node_t *root)
+{
+    static const struct {
+        const char *name;
+        uint32_t type;
+    } contexts[] = {
+        {"cmdline",     LINX_EVENT_CONTEXT_CMDLINE},
+        {"fullpath",    LINX_EVENT_CONTEXT_FULLPATH},
+        {"p_fullpath",  LINX_EVENT_CONTEXT_P_FULLPATH},
+        {"fds",         LINX_EVENT_CONTEXT_FDS},
+    };
+    char node_path[256];
+    const char *name;
+    uint32_t mask = 0;
+    int count;
+
+    /* 未配置时只附带命令行 */
+    if (!linx_yaml_get_node_by_path(root, "engine.ebpf.event_context")) {
+        return LINX_EVENT_CONTEXT_CMDLINE;
+    }
+
+    count = linx_yaml_get_sequence_length(root, "engine.ebpf.event_context");
+    for (int i = 0; i < count; i++) {
+        snprintf(node_path, sizeof(node_path), "engine.ebpf.event_context.%d", i);
+        name = linx_yaml_get_string(root, node_path, "");
+
+        size_t j;
+        for (j = 0; j < sizeof(contexts) / sizeof(contexts[0]); j++) {
+            if (strcmp(name, contexts[j].name) == 0) {
+                mask |= contexts[j].type;
+                break;
+            }
+        }
+
+        if (j == sizeof(contexts) / sizeof(contexts[0])) {
+            LINX_LOG_WARNING("unknown engine.ebpf.event_context '%s'", name);
+        }
+    }
+
+    return mask;
+}
+
 static int linx_config_fill_engine(linx_yaml_node_t *root)
 {
     char node_path[256];
@@ -95,7 +200,24 @@ static int linx_config_fill_engine(linx_yaml_node_t *root)
         linx_global_config->engine.data.ebpf.drop_failed = 
             linx_yaml_get_bool(root, "engine.ebpf.drop_failed", 0);
         
+        linx_global_config->engine.data.ebpf.filter_pid_mode = 
+            linx_config_parse_filter_mode(linx_yaml_get_string(root, "engine.ebpf.filter_pids_mode", "exclude"));
+
+        linx_global_config->engine.data.ebpf.filter_comm_mode = 
+            linx_config_parse_filter_mode(linx_yaml_get_string(root, "engine.ebpf.filter_comms_mode", "exclude"));
+
+        linx_global_config->engine.data.ebpf.filter_uid_mode = 
+            linx_config_parse_filter_mode(linx_yaml_get_string(root, "engine.ebpf.filter_uids_mode", "exclude"));
+
+        linx_global_config->engine.data.ebpf.rule_pushdown = 
+            linx_yaml_get_bool(root, "engine.ebpf.rule_pushdown", 1);
+
         count = linx_yaml_get_sequence_length(root, "engine.ebpf.filter_pids");
+        if (count > LINX_BPF_FILTER_PID_MAX_SIZE) {
+            LINX_LOG_WARNING("only the first %d of engine.ebpf.filter_pids are used",
+                             LINX_BPF_FILTER_PID_MAX_SIZE);
+            count = LINX_BPF_FILTER_PID_MAX_SIZE;
+        }
         for (int i = 0; i < count; i++) {
             snprintf(node_path, sizeof(node_path), "engine.ebpf.filter_pids.%d", i);
             linx_global_config->engine.data.ebpf.filter_pids[i] = 
@@ -103,14 +225,50 @@ static int linx_config_fill_engine(linx_yaml_node_t *root)
         }
 
         count = linx_yaml_get_sequence_length(root, "engine.ebpf.filter_comms");
+        if (count > LINX_BPF_FILTER_COMM_MAX_SIZE) {
+            LINX_LOG_WARNING("only the first %d of engine.ebpf.filter_comms are used",
+                             LINX_BPF_FILTER_COMM_MAX_SIZE);
+            count = LINX_BPF_FILTER_COMM_MAX_SIZE;
+        }
         for (int i = 0; i < count; i++) {
             snprintf(node_path, sizeof(node_path), "engine.ebpf.filter_comms.%d", i);
             snprintf((char *)linx_global_config->engine.data.ebpf.filter_comms[i], 
                      LINX_COMM_MAX_SIZE, "%s", linx_yaml_get_string(root, node_path, ""));
         }
 
+        count = linx_yaml_get_sequence_length(root, "engine.ebpf.filter_uids");
+        if (count > LINX_BPF_FILTER_UID_MAX_SIZE) {
+            LINX_LOG_WARNING("only the first %d of engine.ebpf.filter_uids are used",
+                             LINX_BPF_FILTER_UID_MAX_SIZE);
+            count = LINX_BPF_FILTER_UID_MAX_SIZE;
+        }
+        for (int i = 0; i < count; i++) {
+            snprintf(node_path, sizeof(node_path), "engine.ebpf.filter_uids.%d", i);
+            linx_global_config->engine.data.ebpf.filter_uids[i] = 
+                linx_yaml_get_int(root, node_path, 0);
+        }
+        linx_global_config->engine.data.ebpf.filter_uid_count = count;
+
         linx_config_fill_interest_syscall_table((char *)linx_yaml_get_string(root, "engine.ebpf.interest_syscall_file", NULL));
 
+        linx_global_config->engine.data.ebpf.ringbuf_size = 
+            linx_yaml_get_int(root, "engine.ebpf.ringbuf_size", 1024 * 1024);
+
+        linx_global_config->engine.data.ebpf.event_context_mask = 
+            linx_config_parse_event_context(root);
+
+        linx_global_config->engine.data.ebpf.wait.mode = 
+            linx_config_parse_wait_mode(linx_yaml_get_string(root, "engine.ebpf.wait.mode", "adaptive"));
+
+        linx_global_config->engine.data.ebpf.wait.spin_count = 
+            linx_yaml_get_int(root, "engine.ebpf.wait.spin_count", 1000);
+
+        linx_global_config->engine.data.ebpf.wait.timeout_ms = 
+            linx_yaml_get_int(root, "engine.ebpf.wait.timeout_ms", 100);
+
+        linx_global_config->engine.data.ebpf.wait.wakeup_threshold = 
+            linx_yaml_get_int(root, "engine.ebpf.wait.wakeup_threshold", 0);
+
     } else if (strcmp(linx_global_config->engine.kind, "kmod") == 0) {
 
     } else {
@@ -184,6 +342,22 @@ int linx_config_load(const char *config_file)
     }
 
     
+    linx_global_config->event_queue.capacity = 
+        linx_yaml_get_int(root, "event_queue.capacity", 65536);
+    linx_global_config->event_queue.policy = 
+        linx_config_parse_queue_policy(linx_yaml_get_string(root, "event_queue.policy", "block"));
+
+    linx_config_fill_thread_pool(root, "event_processor.fetcher",
+                                 &linx_global_config->event_processor.fetcher, 1);
+    linx_config_fill_thread_pool(root, "event_processor.matcher",
+                                 &linx_global_config->event_processor.matcher, 0);
+
+    linx_global_config->process_cache.reconcile_interval =
+        linx_yaml_get_int(root, "process_cache.reconcile_interval", 60);
+
+    linx_global_config->user_cache.ttl =
+        linx_yaml_get_int(root, "user_cache.ttl", 300);
+
     linx_global_config->log_config.output = strdup(linx_yaml_get_string(root, "log.output", "stderr"));
     linx_global_config->log_config.log_level = strdup(linx_yaml_get_string(root, "log.level", "ERROR"));
 
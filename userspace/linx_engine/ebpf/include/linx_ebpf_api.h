@@ -2,13 +2,43 @@
 #define __LINX_EBPF_API_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include "linx_event.h"
+#include "linx_config.h"
+#include "linx_engine_vtable.h"
+
+/**
+ * 用户态直接 mmap 的 BPF ringbuf，每个CPU一个
+ * 事件以指针的形式借出，匹配结束后才推进消费位置
+*/
+typedef struct {
+    int map_fd;
+    uint64_t mask;              /* ringbuf 数据区大小 - 1 */
+    unsigned long *consumer_pos;
+    unsigned long *producer_pos;
+    uint8_t *data;              /* 数据区被连续映射两次，跨越尾部的记录也是连续的 */
+    uint64_t read_pos;          /* 已借出记录之后的位置，release 时写回 consumer_pos */
+
+    linx_event_t *head;         /* 已查看但还没有借出的第一条记录 */
+    uint64_t head_next_pos;
+} linx_ebpf_ringbuf_t;
 
 typedef struct {
     struct linx_bpf *skel;
-    struct ring_buffer *rb;
-    uint8_t ringbuf_data[LINX_EVENT_MAX_SIZE];
+
+    uint32_t nringbufs;
+    uint32_t ringbuf_size;
+    linx_ebpf_ringbuf_t *ringbufs;
+    int inner_map_fd;           /* 内层 ringbuf 的模板，加载后关闭 */
+
+    int epoll_fd;
+    linx_wait_mode_t wait_mode;
+    uint32_t spin_count;
+    uint32_t idle_spins;        /* 连续没有取到数据的次数 */
+    int timeout_ms;
+
+    linx_engine_stats_t stats;
 } linx_ebpf_t;
 
 int linx_ebpf_init(linx_ebpf_t *bpf_manager);
@@ -23,18 +53,47 @@ int linx_ebpf_load(linx_ebpf_t *bpf_manager);
 
 int linx_ebpf_ringbuf_init(linx_ebpf_t *bpf_manager);
 
+void linx_ebpf_ringbuf_deinit(linx_ebpf_t *bpf_manager);
+
 int linx_ebpf_load_tail_call_map(struct linx_bpf *skel);
 
 int linx_ebpf_probe_load(struct linx_bpf *skel);
 
 int linx_ebpf_get_ringbuf_msg(linx_ebpf_t *bpf_manager, linx_event_t **event);
 
+int linx_ebpf_get_ringbuf_msg_batch(linx_ebpf_t *bpf_manager, linx_event_t **events,
+                                    size_t max, size_t *n);
+
+int linx_ebpf_release_ringbuf_msg(linx_ebpf_t *bpf_manager);
+
+int linx_ebpf_ringbuf_wait(linx_ebpf_t *bpf_manager);
+
+int linx_ebpf_get_drop_counts(linx_ebpf_t *bpf_manager, uint64_t *drops);
+
+void linx_ebpf_set_wakeup_threshold(struct linx_bpf *skel, uint64_t value);
+
+void linx_ebpf_set_event_context_mask(struct linx_bpf *skel, uint32_t value);
+
 void linx_ebpf_set_boot_time(struct linx_bpf *skel, uint64_t boot_time);
 
 void linx_ebpf_set_filter_pids(struct linx_bpf *skel);
 
 void linx_ebpf_set_filter_comms(struct linx_bpf *skel);
 
+void linx_ebpf_set_filter_uids(struct linx_bpf *skel);
+
+int linx_ebpf_filter_pid_add(struct linx_bpf *skel, uint32_t pid);
+
+int linx_ebpf_filter_pid_del(struct linx_bpf *skel, uint32_t pid);
+
+int linx_ebpf_filter_comm_add(struct linx_bpf *skel, const char *comm);
+
+int linx_ebpf_filter_comm_del(struct linx_bpf *skel, const char *comm);
+
+int linx_ebpf_filter_uid_add(struct linx_bpf *skel, uint32_t uid);
+
+int linx_ebpf_filter_uid_del(struct linx_bpf *skel, uint32_t uid);
+
 void linx_ebpf_set_drop_mode(struct linx_bpf *skel, uint8_t value);
 
 void linx_ebpf_set_drop_failed(struct linx_bpf *skel, uint8_t value);
@@ -1,3 +1,5 @@
+#include <unistd.h>
+
 #include "linx_log.h"
 #include "linx_ebpf_api.h"
 #include "linx_ebpf_common.h"
@@ -19,6 +21,8 @@ int linx_ebpf_set_print(void)
 
 int linx_ebpf_open(linx_ebpf_t *bpf_manager)
 {
+    bpf_manager->inner_map_fd = -1;
+
     bpf_manager->skel = linx_bpf__open();
     if (!bpf_manager->skel) {
         LINX_LOG_ERROR("Failed to open BPF skeleton!");
@@ -31,6 +35,7 @@ int linx_ebpf_open(linx_ebpf_t *bpf_manager)
 int linx_ebpf_load(linx_ebpf_t *bpf_manager)
 {
     linx_global_config_t *config = linx_config_get();
+    int ret;
 
     for (int i = 0; i < LINX_SYSCALL_ID_MAX; ++i) {
         if (config->engine.data.ebpf.interest_syscall_table[i]) {
@@ -66,7 +71,15 @@ int linx_ebpf_load(linx_ebpf_t *bpf_manager)
         }
     }
 
-    if (linx_bpf__load(bpf_manager->skel)) {
+    ret = linx_bpf__load(bpf_manager->skel);
+
+    /* 内核已经按模板创建了每个CPU的 ringbuf，模板不再需要，否则一直占用 ringbuf_size 的内存 */
+    if (bpf_manager->inner_map_fd >= 0) {
+        close(bpf_manager->inner_map_fd);
+        bpf_manager->inner_map_fd = -1;
+    }
+
+    if (ret) {
         LINX_LOG_ERROR("Failed to load BPF skeleton!\n");
         linx_bpf__destroy(bpf_manager->skel);
         return -1;
@@ -87,6 +100,11 @@ int linx_ebpf_probe_load(struct linx_bpf *skel)
         return -1;
     }
 
+    if (!bpf_program__attach(skel->progs.sched_proc_exit)) {
+        LINX_LOG_ERROR("Failed to attach sched_proc_exit\n");
+        return -1;
+    }
+
     // skel->links.xdp_pass = bpf_program__attach_xdp(skel->progs.xdp_pass, if_nametoindex("ens3"));
     // if (!skel->links.xdp_pass) {
     //     LINX_LOG_ERROR("Failed to attach xdp_pass\n");
@@ -11,10 +11,25 @@ static const char *syscall_exit_extra_names[LINX_EXIT_EXTRA_ID_MAX] = {
     [T1_EXECV_X] = "t1_execve_x",
 };
 
+static uint32_t linx_ebpf_ringbuf_size_align(uint32_t size)
+{
+    uint32_t page_size = (uint32_t)sysconf(_SC_PAGESIZE);
+    uint32_t aligned = page_size;
+
+    /* ringbuf 的大小必须是页大小的整数倍并且是2的幂 */
+    while (aligned < size && aligned < (1U << 31)) {
+        aligned <<= 1;
+    }
+
+    return aligned;
+}
+
 int linx_ebpf_maps_before_load(linx_ebpf_t *bpf_manager)
 {
-    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
-    if (ncpu == -1) {
+    linx_global_config_t *config = linx_config_get();
+    int inner_fd;
+    int ncpu = libbpf_num_possible_cpus();
+    if (ncpu <= 0) {
         LINX_LOG_ERROR("Failed to get the number of system cores!");
         return -1;
     }
@@ -25,6 +40,36 @@ int linx_ebpf_maps_before_load(linx_ebpf_t *bpf_manager)
 		return -1;
 	}
 
+    bpf_manager->nringbufs = ncpu;
+    bpf_manager->ringbuf_size = 
+        linx_ebpf_ringbuf_size_align(config->engine.data.ebpf.ringbuf_size);
+
+    /* 内层 ringbuf 的模板，实际的 ringbuf 在加载后创建 */
+    inner_fd = bpf_map_create(BPF_MAP_TYPE_RINGBUF, "linx_rb_inner", 0, 0,
+                              bpf_manager->ringbuf_size, NULL);
+    if (inner_fd < 0) {
+        LINX_LOG_ERROR("unable to create inner ringbuf of %u bytes!",
+                       bpf_manager->ringbuf_size);
+        return -1;
+    }
+
+    if (bpf_map__set_inner_map_fd(bpf_manager->skel->maps.ringbuf_maps, inner_fd)) {
+        LINX_LOG_ERROR("unable to set inner map for 'ringbuf_maps'!");
+        close(inner_fd);
+        return -1;
+    }
+
+    /* 加载时还要用到模板，在 linx_ebpf_load 中关闭 */
+    bpf_manager->inner_map_fd = inner_fd;
+
+	if(bpf_map__set_max_entries(bpf_manager->skel->maps.ringbuf_maps, ncpu)) {
+		LINX_LOG_ERROR("unable to set max entries(%d) for 'ringbuf_maps'!",
+                       ncpu);
+		close(inner_fd);
+		bpf_manager->inner_map_fd = -1;
+		return -1;
+	}
+
     return 0;
 }
 
@@ -33,38 +78,172 @@ void linx_ebpf_set_boot_time(struct linx_bpf *skel, uint64_t boot_time)
     skel->bss->g_boot_time = boot_time;
 }
 
+/**
+ * 过滤表为空时，exclude 模式不需要在内核中查表
+*/
+static int linx_ebpf_map_is_empty(int map_fd)
+{
+    uint8_t key[LINX_COMM_MAX_SIZE];   /* 足够容纳 pid 和 comm 两种键 */
+
+    return bpf_map_get_next_key(map_fd, NULL, key) != 0;
+}
+
+static void linx_ebpf_update_filter_mode(uint8_t *bss_mode, uint8_t mode, int empty)
+{
+    if (empty && mode == LINX_FILTER_MODE_EXCLUDE) {
+        *bss_mode = LINX_FILTER_MODE_NONE;
+    } else {
+        *bss_mode = mode;
+    }
+}
+
+int linx_ebpf_filter_pid_add(struct linx_bpf *skel, uint32_t pid)
+{
+    uint8_t value = 1;
+    linx_global_config_t *config = linx_config_get();
+
+    if (bpf_map_update_elem(bpf_map__fd(skel->maps.filter_pid_map), &pid, &value, BPF_ANY)) {
+        LINX_LOG_ERROR("Failed to add pid %u to filter_pid_map!", pid);
+        return -1;
+    }
+
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_pid_mode,
+                                 config->engine.data.ebpf.filter_pid_mode, 0);
+
+    return 0;
+}
+
+int linx_ebpf_filter_pid_del(struct linx_bpf *skel, uint32_t pid)
+{
+    int map_fd = bpf_map__fd(skel->maps.filter_pid_map);
+    linx_global_config_t *config = linx_config_get();
+
+    if (bpf_map_delete_elem(map_fd, &pid)) {
+        LINX_LOG_WARNING("Failed to delete pid %u from filter_pid_map!", pid);
+        return -1;
+    }
+
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_pid_mode,
+                                 config->engine.data.ebpf.filter_pid_mode,
+                                 linx_ebpf_map_is_empty(map_fd));
+
+    return 0;
+}
+
+int linx_ebpf_filter_comm_add(struct linx_bpf *skel, const char *comm)
+{
+    uint8_t value = 1;
+    char key[LINX_COMM_MAX_SIZE] = {0};
+    linx_global_config_t *config = linx_config_get();
+
+    /* 内核中的 comm 以0填充，键也必须以0填充 */
+    snprintf(key, sizeof(key), "%s", comm);
+
+    if (bpf_map_update_elem(bpf_map__fd(skel->maps.filter_comm_map), key, &value, BPF_ANY)) {
+        LINX_LOG_ERROR("Failed to add comm '%s' to filter_comm_map!", comm);
+        return -1;
+    }
+
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_comm_mode,
+                                 config->engine.data.ebpf.filter_comm_mode, 0);
+
+    return 0;
+}
+
+int linx_ebpf_filter_comm_del(struct linx_bpf *skel, const char *comm)
+{
+    char key[LINX_COMM_MAX_SIZE] = {0};
+    int map_fd = bpf_map__fd(skel->maps.filter_comm_map);
+    linx_global_config_t *config = linx_config_get();
+
+    snprintf(key, sizeof(key), "%s", comm);
+
+    if (bpf_map_delete_elem(map_fd, key)) {
+        LINX_LOG_WARNING("Failed to delete comm '%s' from filter_comm_map!", comm);
+        return -1;
+    }
+
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_comm_mode,
+                                 config->engine.data.ebpf.filter_comm_mode,
+                                 linx_ebpf_map_is_empty(map_fd));
+
+    return 0;
+}
+
+int linx_ebpf_filter_uid_add(struct linx_bpf *skel, uint32_t uid)
+{
+    uint8_t value = 1;
+    linx_global_config_t *config = linx_config_get();
+
+    if (bpf_map_update_elem(bpf_map__fd(skel->maps.filter_uid_map), &uid, &value, BPF_ANY)) {
+        LINX_LOG_ERROR("Failed to add uid %u to filter_uid_map!", uid);
+        return -1;
+    }
+
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_uid_mode,
+                                 config->engine.data.ebpf.filter_uid_mode, 0);
+
+    return 0;
+}
+
+int linx_ebpf_filter_uid_del(struct linx_bpf *skel, uint32_t uid)
+{
+    int map_fd = bpf_map__fd(skel->maps.filter_uid_map);
+    linx_global_config_t *config = linx_config_get();
+
+    if (bpf_map_delete_elem(map_fd, &uid)) {
+        LINX_LOG_WARNING("Failed to delete uid %u from filter_uid_map!", uid);
+        return -1;
+    }
+
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_uid_mode,
+                                 config->engine.data.ebpf.filter_uid_mode,
+                                 linx_ebpf_map_is_empty(map_fd));
+
+    return 0;
+}
+
 void linx_ebpf_set_filter_pids(struct linx_bpf *skel)
 {
     linx_global_config_t *config = linx_config_get();
 
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_pid_mode,
+                                 config->engine.data.ebpf.filter_pid_mode, 1);
+
     for (int i = 0; 
          i < LINX_BPF_FILTER_PID_MAX_SIZE &&
          config->engine.data.ebpf.filter_pids[i]; 
          ++i)
     {
-        skel->bss->g_filter_pids[i] = config->engine.data.ebpf.filter_pids[i];
+        linx_ebpf_filter_pid_add(skel, config->engine.data.ebpf.filter_pids[i]);
     }
 }
 
 void linx_ebpf_set_filter_comms(struct linx_bpf *skel)
 {
-    int byte_write, buf_size = LINX_COMM_MAX_SIZE;
     linx_global_config_t *config = linx_config_get();
 
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_comm_mode,
+                                 config->engine.data.ebpf.filter_comm_mode, 1);
+
     for (int i = 0;
          i < LINX_BPF_FILTER_COMM_MAX_SIZE &&
          config->engine.data.ebpf.filter_comms[i][0] != 0;
          ++i)
     {
-        byte_write = snprintf((char *)skel->bss->g_filter_comms[i], buf_size, "%s", 
-                              (char *)config->engine.data.ebpf.filter_comms[i]);
-        if (byte_write < 0) {
-            LINX_LOG_WARNING("Failed when copy %d bytes '%s' str to %lu bytes buf for %d time!", 
-                             strlen((char *)config->engine.data.ebpf.filter_comms[i]), 
-                             (char *)config->engine.data.ebpf.filter_comms[i], 
-                             buf_size, 
-                             i);
-        }
+        linx_ebpf_filter_comm_add(skel, (char *)config->engine.data.ebpf.filter_comms[i]);
+    }
+}
+
+void linx_ebpf_set_filter_uids(struct linx_bpf *skel)
+{
+    linx_global_config_t *config = linx_config_get();
+
+    linx_ebpf_update_filter_mode(&skel->bss->g_filter_uid_mode,
+                                 config->engine.data.ebpf.filter_uid_mode, 1);
+
+    for (uint32_t i = 0; i < config->engine.data.ebpf.filter_uid_count; ++i) {
+        linx_ebpf_filter_uid_add(skel, config->engine.data.ebpf.filter_uids[i]);
     }
 }
 
@@ -78,6 +257,16 @@ void linx_ebpf_set_drop_failed(struct linx_bpf *skel, uint8_t value)
     skel->bss->g_drop_failed = value;
 }
 
+void linx_ebpf_set_event_context_mask(struct linx_bpf *skel, uint32_t value)
+{
+    skel->bss->g_event_context_mask = value;
+}
+
+void linx_ebpf_set_wakeup_threshold(struct linx_bpf *skel, uint64_t value)
+{
+    skel->bss->g_wakeup_threshold = value;
+}
+
 void linx_ebpf_set_interesting_syscalls_table(struct linx_bpf *skel)
 {
     linx_global_config_t *config = linx_config_get();
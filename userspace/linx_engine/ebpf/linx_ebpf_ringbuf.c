@@ -1,57 +1,355 @@
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
 
 #include "linx_ebpf_common.h"
 #include "linx_log.h"
 #include "linx_ebpf_api.h"
 #include "linx_event.h"
 
-static uint8_t *g_ringbuf_data;
+#define LINX_RINGBUF_ROUNDUP(len) (((len) + 7) & ~7UL)
 
-static int linx_handle_event(void *ctx, void *data, size_t data_sz)
+#if defined(__x86_64__) || defined(__i386__)
+#define LINX_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define LINX_CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define LINX_CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+static int linx_ebpf_ringbuf_epoll_init(linx_ebpf_t *bpf_manager)
 {
-    (void)ctx;
+    linx_global_config_t *config = linx_config_get();
+    struct epoll_event ev = {
+        .events = EPOLLIN,
+    };
+
+    bpf_manager->wait_mode = config->engine.data.ebpf.wait.mode;
+    bpf_manager->spin_count = config->engine.data.ebpf.wait.spin_count;
+    bpf_manager->timeout_ms = config->engine.data.ebpf.wait.timeout_ms;
 
-    if (data_sz > LINX_EVENT_MAX_SIZE) {
-        LINX_LOG_WARNING("The data length of %lu get from ringbuf exceeds the limit of %lu!",
-                         data_sz, LINX_EVENT_MAX_SIZE);
+    bpf_manager->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (bpf_manager->epoll_fd < 0) {
+        LINX_LOG_ERROR("Failed to create epoll fd for ringbuf!");
         return -1;
     }
 
-    memset(g_ringbuf_data, 0, LINX_EVENT_MAX_SIZE);
-    memcpy(g_ringbuf_data, data, data_sz);
+    for (uint32_t i = 0; i < bpf_manager->nringbufs; ++i) {
+        ev.data.u32 = i;
+        if (epoll_ctl(bpf_manager->epoll_fd, EPOLL_CTL_ADD,
+                      bpf_manager->ringbufs[i].map_fd, &ev))
+        {
+            LINX_LOG_ERROR("Failed to add ringbuf(%u) fd to epoll!", i);
+            return -1;
+        }
+    }
 
     return 0;
 }
 
-int linx_ebpf_ringbuf_init(linx_ebpf_t *bpf_manager)
+static int linx_ebpf_ringbuf_mmap(linx_ebpf_ringbuf_t *ringbuf, uint32_t size)
 {
-    bpf_manager->rb = 
-        ring_buffer__new(bpf_map__fd(bpf_manager->skel->maps.ringbuf_map),
-                         linx_handle_event, NULL, NULL);
-    if (!bpf_manager->rb) {
-        LINX_LOG_ERROR("Failed to create ringbuf!");
-        ring_buffer__free(bpf_manager->rb);
-        linx_bpf__destroy(bpf_manager->skel);
+    long page_size = sysconf(_SC_PAGESIZE);
+    void *tmp;
+
+    ringbuf->mask = size - 1;
+
+    /* 第一页为可写的 consumer_pos */
+    tmp = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+               ringbuf->map_fd, 0);
+    if (tmp == MAP_FAILED) {
         return -1;
     }
+    ringbuf->consumer_pos = tmp;
+
+    /* 之后为只读的 producer_pos 页以及两倍大小的数据区 */
+    tmp = mmap(NULL, page_size + 2 * (size_t)size, PROT_READ, MAP_SHARED,
+               ringbuf->map_fd, page_size);
+    if (tmp == MAP_FAILED) {
+        munmap(ringbuf->consumer_pos, page_size);
+        ringbuf->consumer_pos = NULL;
+        return -1;
+    }
+    ringbuf->producer_pos = tmp;
+    ringbuf->data = (uint8_t *)tmp + page_size;
+
+    ringbuf->read_pos = __atomic_load_n(ringbuf->consumer_pos, __ATOMIC_ACQUIRE);
+
+    return 0;
+}
+
+/**
+ * 为每个CPU创建一个ringbuf，放入 ringbuf_maps 的对应位置并映射到用户态
+*/
+int linx_ebpf_ringbuf_init(linx_ebpf_t *bpf_manager)
+{
+    int outer_fd = bpf_map__fd(bpf_manager->skel->maps.ringbuf_maps);
+    linx_ebpf_ringbuf_t *ringbuf;
+    char name[BPF_OBJ_NAME_LEN];
+
+    bpf_manager->epoll_fd = -1;
+
+    bpf_manager->ringbufs = calloc(bpf_manager->nringbufs, sizeof(linx_ebpf_ringbuf_t));
+    if (!bpf_manager->ringbufs) {
+        LINX_LOG_ERROR("Failed to alloc %u ringbufs!", bpf_manager->nringbufs);
+        goto clean_ringbuf_init;
+    }
+
+    for (uint32_t i = 0; i < bpf_manager->nringbufs; ++i) {
+        bpf_manager->ringbufs[i].map_fd = -1;
+    }
+
+    for (uint32_t i = 0; i < bpf_manager->nringbufs; ++i) {
+        ringbuf = &bpf_manager->ringbufs[i];
+
+        snprintf(name, sizeof(name), "linx_rb_%u", i);
+        ringbuf->map_fd = bpf_map_create(BPF_MAP_TYPE_RINGBUF, name, 0, 0,
+                                         bpf_manager->ringbuf_size, NULL);
+        if (ringbuf->map_fd < 0) {
+            LINX_LOG_ERROR("Failed to create ringbuf(%u) of %u bytes!",
+                           i, bpf_manager->ringbuf_size);
+            goto clean_ringbuf_init;
+        }
+
+        if (bpf_map_update_elem(outer_fd, &i, &ringbuf->map_fd, BPF_ANY)) {
+            LINX_LOG_ERROR("Failed to add ringbuf(%u) to ringbuf_maps!", i);
+            goto clean_ringbuf_init;
+        }
+
+        if (linx_ebpf_ringbuf_mmap(ringbuf, bpf_manager->ringbuf_size)) {
+            LINX_LOG_ERROR("Failed to mmap ringbuf(%u)!", i);
+            goto clean_ringbuf_init;
+        }
+    }
 
-    g_ringbuf_data = &bpf_manager->ringbuf_data[0];
+    if (linx_ebpf_ringbuf_epoll_init(bpf_manager)) {
+        goto clean_ringbuf_init;
+    }
 
     return 0;
+
+clean_ringbuf_init:
+    linx_ebpf_ringbuf_deinit(bpf_manager);
+    linx_bpf__destroy(bpf_manager->skel);
+    return -1;
+}
+
+void linx_ebpf_ringbuf_deinit(linx_ebpf_t *bpf_manager)
+{
+    linx_ebpf_ringbuf_t *ringbuf;
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    if (bpf_manager->epoll_fd >= 0) {
+        close(bpf_manager->epoll_fd);
+        bpf_manager->epoll_fd = -1;
+    }
+
+    if (!bpf_manager->ringbufs) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < bpf_manager->nringbufs; ++i) {
+        ringbuf = &bpf_manager->ringbufs[i];
+
+        if (ringbuf->producer_pos) {
+            munmap(ringbuf->producer_pos, page_size + 2 * (ringbuf->mask + 1));
+        }
+
+        if (ringbuf->consumer_pos) {
+            munmap(ringbuf->consumer_pos, page_size);
+        }
+
+        if (ringbuf->map_fd >= 0) {
+            close(ringbuf->map_fd);
+        }
+    }
+
+    free(bpf_manager->ringbufs);
+    bpf_manager->ringbufs = NULL;
+}
+
+/**
+ * 查看 read_pos 处下一条已提交的记录，不推进 read_pos
+*/
+static linx_event_t *linx_ebpf_ringbuf_peek(linx_ebpf_ringbuf_t *ringbuf)
+{
+    unsigned long prod_pos;
+    uint32_t *hdr, len;
+    uint64_t next_pos;
+
+    if (ringbuf->head) {
+        return ringbuf->head;
+    }
+
+    prod_pos = __atomic_load_n(ringbuf->producer_pos, __ATOMIC_ACQUIRE);
+    while (ringbuf->read_pos < prod_pos) {
+        hdr = (uint32_t *)(ringbuf->data + (ringbuf->read_pos & ringbuf->mask));
+        len = __atomic_load_n(hdr, __ATOMIC_ACQUIRE);
+
+        /* 记录还在被内核写入 */
+        if (len & BPF_RINGBUF_BUSY_BIT) {
+            break;
+        }
+
+        next_pos = ringbuf->read_pos +
+                   LINX_RINGBUF_ROUNDUP((len & ~BPF_RINGBUF_DISCARD_BIT) + BPF_RINGBUF_HDR_SZ);
+
+        if (len & BPF_RINGBUF_DISCARD_BIT) {
+            ringbuf->read_pos = next_pos;
+            continue;
+        }
+
+        if (len > LINX_EVENT_MAX_SIZE) {
+            LINX_LOG_WARNING("The data length of %u get from ringbuf exceeds the limit of %lu!",
+                             len, LINX_EVENT_MAX_SIZE);
+            ringbuf->read_pos = next_pos;
+            continue;
+        }
+
+        ringbuf->head = (linx_event_t *)((uint8_t *)hdr + BPF_RINGBUF_HDR_SZ);
+        ringbuf->head_next_pos = next_pos;
+        return ringbuf->head;
+    }
+
+    return NULL;
 }
 
+/**
+ * 从所有CPU的ringbuf中取出时间最早的一条记录，不做任何拷贝
+ * 返回的指针指向 mmap 的数据区，在 release 之前一直有效
+*/
 int linx_ebpf_get_ringbuf_msg(linx_ebpf_t *bpf_manager, linx_event_t **event)
 {
-    int ret = ring_buffer__poll(bpf_manager->rb, 0);
-    if (ret < 0) {
-        /* 说明失败了 */
-        *event = NULL;
-    } else if (ret == 0) {
-        /* 说明没有数据 */
-        *event = NULL;
-    } else {
-        *event = (linx_event_t *)g_ringbuf_data;
+    linx_ebpf_ringbuf_t *min_ringbuf = NULL;
+    linx_event_t *tmp;
+
+    *event = NULL;
+
+    for (uint32_t i = 0; i < bpf_manager->nringbufs; ++i) {
+        tmp = linx_ebpf_ringbuf_peek(&bpf_manager->ringbufs[i]);
+        if (tmp && (!*event || tmp->time < (*event)->time)) {
+            *event = tmp;
+            min_ringbuf = &bpf_manager->ringbufs[i];
+        }
+    }
+
+    if (!min_ringbuf) {
+        return 0;
+    }
+
+    min_ringbuf->read_pos = min_ringbuf->head_next_pos;
+    min_ringbuf->head = NULL;
+
+    return 1;
+}
+
+/**
+ * 一次性取出当前已提交的至多 max 条记录
+ * 所有记录都是借出的，处理完整批后统一 release
+*/
+int linx_ebpf_get_ringbuf_msg_batch(linx_ebpf_t *bpf_manager, linx_event_t **events,
+                                    size_t max, size_t *n)
+{
+    size_t count = 0;
+
+    while (count < max &&
+           linx_ebpf_get_ringbuf_msg(bpf_manager, &events[count]) > 0)
+    {
+        count++;
+    }
+
+    *n = count;
+
+    if (count) {
+        bpf_manager->idle_spins = 0;
+        bpf_manager->stats.n_evts += count;
+    }
+
+    return (int)count;
+}
+
+/**
+ * 归还所有已借出的记录，内核可以覆盖这部分空间
+*/
+int linx_ebpf_release_ringbuf_msg(linx_ebpf_t *bpf_manager)
+{
+    linx_ebpf_ringbuf_t *ringbuf;
+
+    for (uint32_t i = 0; i < bpf_manager->nringbufs; ++i) {
+        ringbuf = &bpf_manager->ringbufs[i];
+
+        if (*ringbuf->consumer_pos != ringbuf->read_pos) {
+            __atomic_store_n(ringbuf->consumer_pos, ringbuf->read_pos, __ATOMIC_RELEASE);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * ringbuf 中没有数据时调用
+ * adaptive 模式下先忙等 spin_count 次，之后阻塞在 epoll 上直到内核唤醒或超时
+ * 阻塞前所有记录都已 release，内核在提交新记录时才会唤醒 epoll
+*/
+int linx_ebpf_ringbuf_wait(linx_ebpf_t *bpf_manager)
+{
+    struct epoll_event ev;
+    struct timespec start, end;
+    int ret;
+
+    switch (bpf_manager->wait_mode) {
+    case LINX_WAIT_MODE_SPIN:
+        bpf_manager->stats.n_spins++;
+        LINX_CPU_RELAX();
+        return 0;
+    case LINX_WAIT_MODE_ADAPTIVE:
+        if (bpf_manager->idle_spins < bpf_manager->spin_count) {
+            bpf_manager->idle_spins++;
+            bpf_manager->stats.n_spins++;
+            LINX_CPU_RELAX();
+            return 0;
+        }
+        /* fall through */
+    case LINX_WAIT_MODE_EPOLL:
+    default:
+        break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ret = epoll_wait(bpf_manager->epoll_fd, &ev, 1, bpf_manager->timeout_ms);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    bpf_manager->stats.n_waits++;
+    bpf_manager->stats.idle_ns += (end.tv_sec - start.tv_sec) * 1000000000UL +
+                                  end.tv_nsec - start.tv_nsec;
+
+    if (ret == 0) {
+        bpf_manager->stats.n_timeouts++;
+    } else if (ret < 0 && errno != EINTR) {
+        LINX_LOG_WARNING("epoll_wait on ringbuf failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * 读取每个CPU上丢弃的事件个数，drops 至少有 nringbufs 个元素
+*/
+int linx_ebpf_get_drop_counts(linx_ebpf_t *bpf_manager, uint64_t *drops)
+{
+    uint32_t key = 0;
+
+    if (bpf_map_lookup_elem(bpf_map__fd(bpf_manager->skel->maps.drop_counter_map),
+                            &key, drops))
+    {
+        LINX_LOG_WARNING("Failed to read drop_counter_map!");
+        return -1;
     }
 
-    return ret;
+    return 0;
 }
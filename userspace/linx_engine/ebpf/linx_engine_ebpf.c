@@ -1,6 +1,8 @@
 #include <time.h>
+#include <stdlib.h>
 
 #include "linx_log.h"
+#include "linx_ebpf_common.h"
 #include "linx_ebpf_api.h"
 #include "linx_engine_ebpf.h"
 
@@ -48,12 +50,20 @@ int ebpf_init(void)
 
     linx_ebpf_set_filter_comms(s_bpf_manager.skel);
 
+    linx_ebpf_set_filter_uids(s_bpf_manager.skel);
+
     linx_ebpf_set_drop_mode(s_bpf_manager.skel, 0);
 
     linx_ebpf_set_drop_failed(s_bpf_manager.skel, 0);
 
     linx_ebpf_set_interesting_syscalls_table(s_bpf_manager.skel);
 
+    linx_ebpf_set_wakeup_threshold(s_bpf_manager.skel,
+                                   linx_config_get()->engine.data.ebpf.wait.wakeup_threshold);
+
+    linx_ebpf_set_event_context_mask(s_bpf_manager.skel,
+                                     linx_config_get()->engine.data.ebpf.event_context_mask);
+
     return ret;
 }
 
@@ -72,8 +82,75 @@ int ebpf_next(linx_event_t **event)
     return linx_ebpf_get_ringbuf_msg(&s_bpf_manager, event);
 }
 
+int ebpf_next_batch(linx_event_t **events, size_t max, size_t *n)
+{
+    int ret = linx_ebpf_get_ringbuf_msg_batch(&s_bpf_manager, events, max, n);
+    if (ret) {
+        return ret;
+    }
+
+    /* 没有数据时按配置的策略等待，等待结束后再取一次 */
+    linx_ebpf_ringbuf_wait(&s_bpf_manager);
+
+    return linx_ebpf_get_ringbuf_msg_batch(&s_bpf_manager, events, max, n);
+}
+
+int ebpf_release(void)
+{
+    return linx_ebpf_release_ringbuf_msg(&s_bpf_manager);
+}
+
+int ebpf_get_stats(linx_engine_stats_t *stats)
+{
+    uint64_t *drops;
+
+    *stats = s_bpf_manager.stats;
+    stats->n_drops = 0;
+
+    drops = calloc(s_bpf_manager.nringbufs, sizeof(uint64_t));
+    if (!drops) {
+        return -1;
+    }
+
+    if (linx_ebpf_get_drop_counts(&s_bpf_manager, drops) == 0) {
+        for (uint32_t i = 0; i < s_bpf_manager.nringbufs; ++i) {
+            stats->n_drops += drops[i];
+        }
+    }
+
+    free(drops);
+
+    return 0;
+}
+
 int ebpf_close(void)
 {
+    linx_engine_stats_t stats;
+    uint64_t *drops;
+
+    ebpf_get_stats(&stats);
+
+    LINX_LOG_INFO("ebpf engine: %lu events, %lu drops, %lu spins, %lu waits(%lu timeouts), %lu ms idle",
+                  stats.n_evts, stats.n_drops, stats.n_spins, stats.n_waits, stats.n_timeouts,
+                  stats.idle_ns / 1000000);
+
+    drops = calloc(s_bpf_manager.nringbufs, sizeof(uint64_t));
+    if (drops && linx_ebpf_get_drop_counts(&s_bpf_manager, drops) == 0) {
+        for (uint32_t i = 0; i < s_bpf_manager.nringbufs; ++i) {
+            if (drops[i]) {
+                LINX_LOG_INFO("ebpf engine: cpu %u dropped %lu events", i, drops[i]);
+            }
+        }
+    }
+    free(drops);
+
+    linx_ebpf_ringbuf_deinit(&s_bpf_manager);
+
+    if (s_bpf_manager.skel) {
+        linx_bpf__destroy(s_bpf_manager.skel);
+        s_bpf_manager.skel = NULL;
+    }
+
     return 0;
 }
 
@@ -83,5 +160,8 @@ linx_engine_vtable_t ebpf_vtable = {
     .start = ebpf_start,
     .stop = ebpf_stop,
     .next = ebpf_next,
+    .next_batch = ebpf_next_batch,
+    .release = ebpf_release,
+    .get_stats = ebpf_get_stats,
     .close = ebpf_close
 };
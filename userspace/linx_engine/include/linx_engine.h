@@ -4,6 +4,9 @@
 #include "linx_config.h"
 #include "linx_engine_vtable.h"
 
+/* 一次唤醒最多取出的事件个数 */
+#define LINX_ENGINE_BATCH_MAX_SIZE 64
+
 typedef struct {
     linx_engine_vtable_t *vtable;
 } linx_engine_t;
@@ -14,6 +17,12 @@ int linx_engine_close(void);
 
 int linx_engine_next(linx_event_t **event);
 
+int linx_engine_next_batch(linx_event_t **events, size_t max, size_t *n);
+
+int linx_engine_release(void);
+
+int linx_engine_get_stats(linx_engine_stats_t *stats);
+
 int linx_engine_start(void);
 
 int linx_engine_stop(void);
@@ -2,9 +2,22 @@
 #define __LINX_ENGINE_STRUCT_H__ 
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include "linx_event.h"
 
+/**
+ * 采集模块的运行统计
+*/
+typedef struct {
+    uint64_t n_evts;        /* 取出的事件个数 */
+    uint64_t n_drops;       /* 内核中丢弃的事件个数 */
+    uint64_t n_spins;       /* 没有数据时忙等的次数 */
+    uint64_t n_waits;       /* 阻塞等待的次数 */
+    uint64_t n_timeouts;    /* 阻塞等待超时的次数 */
+    uint64_t idle_ns;       /* 阻塞等待的总时间，即节省下来的 CPU 时间 */
+} linx_engine_stats_t;
+
 /**
  * 该结构体是所有引擎需要提供的
  * 这样可以使用回调函数更方便的调用不同引擎
@@ -15,6 +28,9 @@ typedef struct {
     int (*init)(void);
     int (*close)(void);
     int (*next)(linx_event_t **event);
+    int (*next_batch)(linx_event_t **events, size_t max, size_t *n);
+    int (*release)(void);    /* 归还 next 借出的事件 */
+    int (*get_stats)(linx_engine_stats_t *stats);
     int (*start)(void);
     int (*stop)(void);
 } linx_engine_vtable_t;
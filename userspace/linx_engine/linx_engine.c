@@ -16,10 +16,21 @@ int linx_engine_init(linx_global_config_t *config)
     return linx_engine.vtable->init();
 }
 
+/**
+ * 采集线程退出后调用，采集模块在关闭前输出统计信息
+*/
 int linx_engine_close(void)
 {
-    // return linx_engine.vtable->close();
-    return 0;
+    int ret;
+
+    if (!linx_engine.vtable) {
+        return 0;
+    }
+
+    ret = linx_engine.vtable->close();
+    linx_engine.vtable = NULL;
+
+    return ret;
 }
 
 int linx_engine_next(linx_event_t **event)
@@ -27,6 +38,29 @@ int linx_engine_next(linx_event_t **event)
     return linx_engine.vtable->next(event);
 }
 
+/**
+ * 一次取出至多 max 个事件，实际个数由 n 返回
+ * 事件同样是借出的，需要在处理完整批后 release
+*/
+int linx_engine_next_batch(linx_event_t **events, size_t max, size_t *n)
+{
+    return linx_engine.vtable->next_batch(events, max, n);
+}
+
+/**
+ * next 返回的事件直接指向采集模块的缓冲区
+ * 事件处理结束后必须调用该函数归还
+*/
+int linx_engine_release(void)
+{
+    return linx_engine.vtable->release();
+}
+
+int linx_engine_get_stats(linx_engine_stats_t *stats)
+{
+    return linx_engine.vtable->get_stats(stats);
+}
+
 int linx_engine_start(void)
 {
     // return linx_engine.vtable->start();
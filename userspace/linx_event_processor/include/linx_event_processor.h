@@ -5,9 +5,33 @@
 #include <stdbool.h>
 
 #include "linx_thread_pool.h"
+#include "linx_event_queue.h"
 #include "linx_event_processor_config.h"
 #include "linx_event_processor_define.h"
 
+typedef struct {
+    uint64_t n_fetched;         /* 从采集模块取出的事件数 */
+    uint64_t n_queued;          /* 所有匹配线程队列中还未处理的事件数 */
+    uint64_t n_drops;           /* 队列满或内存不足丢弃的事件数 */
+    uint64_t n_mallocs;         /* 事件缓冲区满时单独分配的事件数 */
+    uint64_t n_engine_drops;    /* 采集模块(如内核 ringbuf 满)丢弃的事件数，定期更新 */
+} linx_event_processor_stats_t;
+
+/**
+ * 采集线程拷贝事件用的环形缓冲区，每个匹配线程队列一个
+ * 事件按入队顺序分配，匹配线程用完后只做标记，由采集线程在下次分配时按顺序回收
+*/
+typedef struct {
+    uint8_t *buffer;
+    uint64_t size;
+    uint64_t head;              /* 下一次分配的位置，只由采集线程修改 */
+    uint64_t tail;              /* 最早的未回收事件的位置，只由采集线程修改 */
+} linx_event_processor_arena_t;
+
+/**
+ * 采集线程 -> 每个匹配线程一个队列 -> 匹配线程(丰富+匹配) -> 告警线程池
+ * 事件按 pid 分发，同一进程的快照和后续事件由同一个匹配线程按顺序处理
+*/
 typedef struct {
     /* 配置 */
     linx_event_processor_config_t config;
@@ -15,6 +39,13 @@ typedef struct {
     /* 线程池 */
     linx_thread_pool_t *fetcher_pool;
     linx_thread_pool_t *matcher_pool;
+
+    /* 匹配线程的输入队列和队列中事件的缓冲区 */
+    linx_event_queue_t **queues;
+    linx_event_processor_arena_t *arenas;
+
+    int running;
+    linx_event_processor_stats_t stats;
 } linx_event_processor_t;
 
 int linx_event_processor_init(linx_event_processor_config_t *config);
@@ -25,4 +56,6 @@ int linx_event_processor_start(void);
 
 int linx_event_processor_stop(void);
 
+void linx_event_processor_get_stats(linx_event_processor_stats_t *stats);
+
 #endif /* __LINX_EVENT_PROCESSOR_H__ */
@@ -3,16 +3,12 @@
 
 #include <stdbool.h>
 
-typedef struct {
-    uint32_t thread_cound;
-    bool cpu_affinity;
-    int priority;
-} linx_thread_pool_config_t;
+#include "linx_config.h"
 
 typedef struct {
     /* 核心配置 */
-    uint32_t fetcher_thread_count;
-    uint32_t matcher_thread_count;
+    uint32_t queue_capacity;            /* 每个匹配线程的队列大小 */
+    linx_queue_policy_t queue_policy;
 
     /* 子模块配置 */
     linx_thread_pool_config_t fetcher_pool_config;
@@ -4,4 +4,16 @@
 #define LINX_EVENT_PROCESSOR_MIN_THREADS    1
 #define LINX_EVENT_PROCESSOR_MAX_THREADS    64
 
+/* 采集模块按时间戳合并所有CPU的ringbuf，只能有一个消费者 */
+#define LINX_EVENT_PROCESSOR_MAX_FETCHERS   1
+
+/* 每个匹配线程队列的事件缓冲区大小，必须是2的幂，缓冲区满时退化为 malloc */
+#define LINX_EVENT_PROCESSOR_ARENA_SIZE     (2 * 1024 * 1024)
+
+/* 采集线程检查采集模块丢弃事件数的间隔秒数 */
+#define LINX_EVENT_PROCESSOR_STATS_INTERVAL 10
+
+/* 匹配线程队列为空时的等待时间，超时后检查是否需要退出 */
+#define LINX_EVENT_PROCESSOR_POP_TIMEOUT_MS 100
+
 #endif /* __LINX_EVENT_PROCESSOR_DEFINE_H__ */
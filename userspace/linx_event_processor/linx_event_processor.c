@@ -1,11 +1,22 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
 
 #include "linx_event_processor_task.h"
 #include "linx_log.h"
 #include "linx_event.h"
+#include "linx_engine.h"
+#include "linx_event_rich.h"
 #include "linx_rule_engine_set.h"
+#include "linx_process_cache.h"
 
 static linx_event_processor_t *g_event_processor = NULL;
 
@@ -20,14 +31,14 @@ static int linx_event_processor_validate_config(linx_event_processor_config_t *c
         return -1;
     }
 
-    if (config->fetcher_thread_count < LINX_EVENT_PROCESSOR_MIN_THREADS ||
-        config->fetcher_thread_count > LINX_EVENT_PROCESSOR_MAX_THREADS)
+    if (config->fetcher_pool_config.thread_count < LINX_EVENT_PROCESSOR_MIN_THREADS ||
+        config->fetcher_pool_config.thread_count > LINX_EVENT_PROCESSOR_MAX_THREADS)
     {
         return -1;
     }
 
-    if (config->matcher_thread_count < LINX_EVENT_PROCESSOR_MIN_THREADS ||)
-        config->matcher_thread_count > LINX_EVENT_PROCESSOR_MAX_THREADS)
+    if (config->matcher_pool_config.thread_count < LINX_EVENT_PROCESSOR_MIN_THREADS ||
+        config->matcher_pool_config.thread_count > LINX_EVENT_PROCESSOR_MAX_THREADS)
     {
         return -1;
     }
@@ -46,60 +57,336 @@ static void linx_event_processor_get_default_config(linx_event_processor_config_
     memset(config, 0, sizeof(linx_event_processor_config_t));
 
     cpu_count = get_cpu_count();
+    if (cpu_count > LINX_EVENT_PROCESSOR_MAX_THREADS) {
+        cpu_count = LINX_EVENT_PROCESSOR_MAX_THREADS;
+    }
+
+    config->queue_capacity = 65536;
+    config->queue_policy = LINX_QUEUE_POLICY_BLOCK;
+    config->fetcher_pool_config.thread_count = LINX_EVENT_PROCESSOR_MAX_FETCHERS;
+    config->matcher_pool_config.thread_count = cpu_count;
+}
+
+/**
+ * 按配置设置当前线程的 CPU 亲和性和 nice 值，失败只打印警告
+*/
+static void linx_event_processor_setup_thread(const linx_thread_pool_config_t *pool_config, uint32_t cpu)
+{
+    cpu_set_t cpuset;
+    int ret;
+
+    if (pool_config->cpu_affinity) {
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu % get_cpu_count(), &cpuset);
+
+        ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        if (ret) {
+            LINX_LOG_WARNING("Failed to bind thread to cpu %u: %s", cpu % get_cpu_count(), strerror(ret));
+        }
+    }
+
+    if (pool_config->priority) {
+        /* nice 值在 Linux 上是线程级别的 */
+        ret = setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), pool_config->priority);
+        if (ret) {
+            LINX_LOG_WARNING("Failed to set thread priority %d", pool_config->priority);
+        }
+    }
+}
+
+/**
+ * 流水线线程屏蔽退出信号，信号只由主线程处理，
+ * 否则在流水线线程中回收资源会等待自己退出
+*/
+static linx_thread_pool_t *linx_event_processor_create_pool(uint32_t thread_count)
+{
+    linx_thread_pool_t *pool;
+    sigset_t set, old;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGUSR1);
+
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    pool = linx_thread_pool_create((int)thread_count);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
 
-    config->fetcher_thread_count = cpu_count;
-    config->matcher_thread_count = cpu_count * 2;
+    return pool;
+}
+
+/**
+ * 缓冲区中每个事件前面的记录头，len 包括记录头和对齐的填充
+*/
+typedef struct {
+    uint32_t len;
+    uint32_t state;
+} linx_event_processor_record_t;
+
+enum {
+    LINX_EVENT_RECORD_USED = 1,
+    LINX_EVENT_RECORD_FREED,
+    LINX_EVENT_RECORD_MALLOC,       /* 缓冲区满时单独分配，用完直接释放 */
+};
+
+static int linx_event_processor_arena_init(linx_event_processor_arena_t *arena, uint64_t size)
+{
+    arena->buffer = aligned_alloc(64, size);
+    if (!arena->buffer) {
+        return -1;
+    }
+
+    arena->size = size;
+    arena->head = 0;
+    arena->tail = 0;
+
+    return 0;
+}
+
+/**
+ * 匹配线程按入队顺序使用事件，从 tail 开始回收已经标记释放的连续记录
+*/
+static void linx_event_processor_arena_reclaim(linx_event_processor_arena_t *arena)
+{
+    linx_event_processor_record_t *record;
+
+    while (arena->tail != arena->head) {
+        record = (linx_event_processor_record_t *)(arena->buffer + (arena->tail & (arena->size - 1)));
+        if (__atomic_load_n(&record->state, __ATOMIC_ACQUIRE) != LINX_EVENT_RECORD_FREED) {
+            break;
+        }
+
+        arena->tail += record->len;
+    }
+}
+
+/**
+ * 只由采集线程调用，记录不跨越缓冲区末尾，剩余空间不够时用一个已释放的记录填充
+*/
+static linx_event_t *linx_event_processor_arena_alloc(linx_event_processor_arena_t *arena, uint32_t size)
+{
+    linx_event_processor_record_t *record;
+    uint64_t len = (sizeof(linx_event_processor_record_t) + size + 7) & ~7ULL;
+    uint64_t offset, pad;
+
+    linx_event_processor_arena_reclaim(arena);
+
+    offset = arena->head & (arena->size - 1);
+    pad = (offset + len > arena->size) ? arena->size - offset : 0;
+
+    if (arena->head + pad + len - arena->tail > arena->size) {
+        record = malloc(sizeof(linx_event_processor_record_t) + size);
+        if (!record) {
+            return NULL;
+        }
+
+        record->len = 0;
+        record->state = LINX_EVENT_RECORD_MALLOC;
+        return (linx_event_t *)(record + 1);
+    }
+
+    if (pad) {
+        record = (linx_event_processor_record_t *)(arena->buffer + offset);
+        record->len = (uint32_t)pad;
+        record->state = LINX_EVENT_RECORD_FREED;
+        arena->head += pad;
+    }
+
+    record = (linx_event_processor_record_t *)(arena->buffer + (arena->head & (arena->size - 1)));
+    record->len = (uint32_t)len;
+    record->state = LINX_EVENT_RECORD_USED;
+    arena->head += len;
+
+    return (linx_event_t *)(record + 1);
+}
+
+/**
+ * 匹配线程处理完事件，或者队列丢弃事件时调用
+*/
+static void linx_event_processor_arena_free(void *item)
+{
+    linx_event_processor_record_t *record = (linx_event_processor_record_t *)item - 1;
+
+    if (record->state == LINX_EVENT_RECORD_MALLOC) {
+        free(record);
+        return;
+    }
+
+    __atomic_store_n(&record->state, LINX_EVENT_RECORD_FREED, __ATOMIC_RELEASE);
 }
 
 static void *event_match_worker(void *arg, int *should_stop)
 {
     linx_event_processor_task_t *task = (linx_event_processor_task_t *)arg;
     linx_event_processor_t *processor = task->processor;
-    
-    linx_rule_set_match_rule();
+    linx_event_queue_t *queue = processor->queues[task->worker_id];
+    linx_event_ctx_t *ctx;
+    linx_rule_memo_t *memo;
+    linx_event_t *event;
+    void *item;
+    int ret;
+
+    linx_event_processor_setup_thread(&processor->config.matcher_pool_config,
+                                      processor->config.fetcher_pool_config.thread_count + task->worker_id);
+
+    /* 每个匹配线程一个事件上下文，线程之间不共享任何事件状态 */
+    ctx = calloc(1, sizeof(linx_event_ctx_t));
+    if (!ctx) {
+        LINX_LOG_ERROR("Failed to allocate event context for matcher %d", task->worker_id);
+        free(task);
+        return NULL;
+    }
 
+    /* 规则已在启动前加载完成，谓词缓存按最终的谓词数创建 */
+    memo = linx_rule_memo_create();
+    if (!memo) {
+        LINX_LOG_ERROR("Failed to allocate rule memo for matcher %d", task->worker_id);
+        free(ctx);
+        free(task);
+        return NULL;
+    }
+
+    /* 停止后把队列中剩余的事件处理完再退出，只在队列为空时检查是否需要退出 */
+    while (1) {
+        ret = linx_event_queue_pop_wait(queue, &item, LINX_EVENT_PROCESSOR_POP_TIMEOUT_MS);
+        if (ret) {
+            if (*should_stop || !__atomic_load_n(&processor->running, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+
+            continue;
+        }
+
+        event = (linx_event_t *)item;
+
+        /* 上下文中的进程信息直接指向进程缓存，匹配完成之前不能被回收 */
+        linx_process_cache_read_begin();
+
+        ret = linx_event_rich(ctx, event);
+        if (!ret) {
+            linx_rule_set_match_rule(&ctx->fields, memo);
+        }
+
+        linx_process_cache_read_end();
+
+        linx_event_processor_arena_free(event);
+    }
+
+    linx_rule_memo_destroy(memo);
+    linx_event_ctx_clean(ctx);
+    free(ctx);
     free(task);
     return NULL;
 }
 
+/**
+ * 内核中丢弃的事件只有采集模块知道，定期取出，有新的丢弃时告警
+*/
+static void linx_event_processor_check_engine(linx_event_processor_t *processor, time_t interval)
+{
+    linx_engine_stats_t stats;
+    uint64_t last;
+
+    if (linx_engine_get_stats(&stats)) {
+        return;
+    }
+
+    last = __atomic_exchange_n(&processor->stats.n_engine_drops, stats.n_drops, __ATOMIC_RELAXED);
+    if (stats.n_drops > last) {
+        LINX_LOG_WARNING("engine dropped %lu events in the last %ld seconds, %lu in total",
+                         stats.n_drops - last, (long)interval, stats.n_drops);
+    }
+}
+
 static void *event_fetch_worker(void *arg, int *should_stop)
 {
-    linx_event_processor_task_t *match_task;
     linx_event_processor_task_t *task = (linx_event_processor_task_t *)arg;
     linx_event_processor_t *processor = task->processor;
+    uint32_t nqueues = processor->config.matcher_pool_config.thread_count;
+    linx_event_t *events[LINX_ENGINE_BATCH_MAX_SIZE];
     linx_event_t *event;
+    time_t last_check = time(NULL), now;
+    uint32_t index;
+    size_t n = 0;
     int ret;
 
-    while (!*should_stop) {
-        ret = linx_engine_next(&event);
+    linx_event_processor_setup_thread(&processor->config.fetcher_pool_config, task->worker_id);
+
+    while (!*should_stop && __atomic_load_n(&processor->running, __ATOMIC_ACQUIRE)) {
+        /* 没有事件时等待也会超时返回，这里同样能执行到 */
+        now = time(NULL);
+        if (now - last_check >= LINX_EVENT_PROCESSOR_STATS_INTERVAL) {
+            linx_event_processor_check_engine(processor, now - last_check);
+            last_check = now;
+        }
+
+        ret = linx_engine_next_batch(events, LINX_ENGINE_BATCH_MAX_SIZE, &n);
         if (ret <= 0) {
-            usleep(1000);
             continue;
         }
 
-        match_task = malloc(sizeof(linx_event_processor_task_t));
-        if (!match_task) {
-            LINX_LOG_WARNING("Failed to allocate memory for match task");
-            continue;
+        for (size_t i = 0; i < n; ++i) {
+            /**
+             * 归还后 ringbuf 中的记录会被内核覆盖，交给匹配线程前需要拷贝，
+             * 这样整批事件分发后就可以立即归还，不用等待匹配结束
+             * 拷贝到目标队列的缓冲区中，不需要为每个事件分配内存
+            */
+            index = events[i]->pid % nqueues;
+            event = linx_event_processor_arena_alloc(&processor->arenas[index], events[i]->size);
+            if (!event) {
+                __atomic_add_fetch(&processor->stats.n_drops, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+
+            if (((linx_event_processor_record_t *)event - 1)->state == LINX_EVENT_RECORD_MALLOC) {
+                __atomic_add_fetch(&processor->stats.n_mallocs, 1, __ATOMIC_RELAXED);
+            }
+
+            memcpy(event, events[i], events[i]->size);
+
+            /* 同一进程的事件进入同一个队列，保证快照先于该进程的其他事件被处理 */
+            ret = linx_event_queue_push(processor->queues[index], event);
+            if (ret < 0) {
+                linx_event_processor_arena_free(event);
+            }
         }
 
-        match_task->type = LINX_TASK_TYPE_MATCH_EVENT;
-        match_task->processor = processor;
-        match_task->worker_id = task->worker_id;
+        __atomic_add_fetch(&processor->stats.n_fetched, n, __ATOMIC_RELAXED);
 
-        ret = linx_thread_pool_add_task(processor->matcher_pool, event_mathc_worker, match_task);
-        if (ret) {
-            LINX_LOG_WARNING("Failed to add task to matcher pool");
-            free(match_task);
-            continue;
-        }
+        linx_engine_release();
     }
-    
+
+    free(task);
     return NULL;
 }
 
+/**
+ * 先销毁队列，队列中剩余的事件释放后才能释放缓冲区
+*/
+static void linx_event_processor_free(linx_event_processor_t *processor)
+{
+    if (processor->queues) {
+        for (uint32_t i = 0; i < processor->config.matcher_pool_config.thread_count; i++) {
+            linx_event_queue_destroy(processor->queues[i]);
+        }
+
+        free(processor->queues);
+    }
+
+    if (processor->arenas) {
+        for (uint32_t i = 0; i < processor->config.matcher_pool_config.thread_count; i++) {
+            free(processor->arenas[i].buffer);
+        }
+
+        free(processor->arenas);
+    }
+
+    free(processor);
+}
+
 int linx_event_processor_init(linx_event_processor_config_t *config)
 {
+    linx_event_processor_config_t *processor_config;
+
     if (g_event_processor) {
         return 0;
     }
@@ -109,64 +396,138 @@ int linx_event_processor_init(linx_event_processor_config_t *config)
         return -1;
     }
 
+    processor_config = &g_event_processor->config;
+
     if (config) {
-        if (linx_event_processor_validate_config(config)) {
+        *processor_config = *config;
+
+        if (processor_config->matcher_pool_config.thread_count == 0) {
+            processor_config->matcher_pool_config.thread_count = get_cpu_count();
+            if (processor_config->matcher_pool_config.thread_count > LINX_EVENT_PROCESSOR_MAX_THREADS) {
+                processor_config->matcher_pool_config.thread_count = LINX_EVENT_PROCESSOR_MAX_THREADS;
+            }
+        }
+
+        if (linx_event_processor_validate_config(processor_config)) {
+            LINX_LOG_ERROR("Invalid event processor thread count");
             free(g_event_processor);
+            g_event_processor = NULL;
             return -1;
         }
 
-        g_event_processor->config = *config;
+        if (processor_config->fetcher_pool_config.thread_count > LINX_EVENT_PROCESSOR_MAX_FETCHERS) {
+            LINX_LOG_WARNING("Only %d fetcher thread is supported, ignore the other %u",
+                             LINX_EVENT_PROCESSOR_MAX_FETCHERS,
+                             processor_config->fetcher_pool_config.thread_count - LINX_EVENT_PROCESSOR_MAX_FETCHERS);
+            processor_config->fetcher_pool_config.thread_count = LINX_EVENT_PROCESSOR_MAX_FETCHERS;
+        }
     } else {
-        linx_event_processor_get_default_config(&g_event_processor->config);
+        linx_event_processor_get_default_config(processor_config);
     }
 
-    g_event_processor->fetcher_pool = linx_thread_pool_create(g_event_processor->config.fetcher_thread_count);
+    g_event_processor->queues = calloc(processor_config->matcher_pool_config.thread_count,
+                                       sizeof(linx_event_queue_t *));
+    g_event_processor->arenas = calloc(processor_config->matcher_pool_config.thread_count,
+                                       sizeof(linx_event_processor_arena_t));
+    if (!g_event_processor->queues || !g_event_processor->arenas) {
+        goto clean_processor;
+    }
+
+    for (uint32_t i = 0; i < processor_config->matcher_pool_config.thread_count; i++) {
+        if (linx_event_processor_arena_init(&g_event_processor->arenas[i], LINX_EVENT_PROCESSOR_ARENA_SIZE)) {
+            LINX_LOG_ERROR("Failed to allocate event buffer for matcher %u", i);
+            goto clean_processor;
+        }
+
+        g_event_processor->queues[i] = linx_event_queue_create(processor_config->queue_capacity,
+                                                               processor_config->queue_policy,
+                                                               linx_event_processor_arena_free);
+        if (!g_event_processor->queues[i]) {
+            LINX_LOG_ERROR("Failed to create event queue for matcher %u", i);
+            goto clean_processor;
+        }
+    }
+
+    g_event_processor->fetcher_pool = linx_event_processor_create_pool(processor_config->fetcher_pool_config.thread_count);
     if (!g_event_processor->fetcher_pool) {
-        free(g_event_processor);
-        return -1;
+        goto clean_processor;
     }
 
-    g_event_processor->matcher_pool = linx_thread_pool_create(g_event_processor->config.matcher_thread_count);
+    g_event_processor->matcher_pool = linx_event_processor_create_pool(processor_config->matcher_pool_config.thread_count);
     if (!g_event_processor->matcher_pool) {
-        linx_thread_pool_destroy(g_event_processor->fetcher_pool, 0);
-        free(g_event_processor);
-        return -1;
+        goto clean_fetcher_pool;
     }
 
+    LINX_LOG_INFO("event processor: %u fetcher, %u matcher threads",
+                  processor_config->fetcher_pool_config.thread_count,
+                  processor_config->matcher_pool_config.thread_count);
+
     return 0;
+
+clean_fetcher_pool:
+    linx_thread_pool_destroy(g_event_processor->fetcher_pool, 0);
+clean_processor:
+    linx_event_processor_free(g_event_processor);
+    g_event_processor = NULL;
+    return -1;
 }
 
 void linx_event_processor_deinit(void)
 {
+    linx_event_processor_stats_t stats;
+
     if (!g_event_processor) {
         return;
     }
 
-    if (g_event_processor->fetcher_pool) {
-        linx_thread_pool_destroy(g_event_processor->fetcher_pool, 1);
-    }
+    linx_event_processor_stop();
 
-    if (g_event_processor->matcher_pool) {
-        linx_thread_pool_destroy(g_event_processor->matcher_pool, 1);
-    }
+    linx_event_processor_get_stats(&stats);
+    LINX_LOG_INFO("event processor: %lu fetched, %lu queued, %lu drops, %lu mallocs, %lu engine drops",
+                  stats.n_fetched, stats.n_queued, stats.n_drops, stats.n_mallocs, stats.n_engine_drops);
 
-    free(g_event_processor);
+    linx_event_processor_free(g_event_processor);
     g_event_processor = NULL;
 }
 
+/**
+ * 启动失败时停止已经启动的线程，之后只能调用 linx_event_processor_deinit
+*/
 int linx_event_processor_start(void)
 {
     linx_event_processor_task_t *task_arg;
+    linx_event_processor_config_t *config;
     int ret;
 
     if (!g_event_processor) {
         return -1;
     }
 
-    for (uint32_t i = 0; i < g_event_processor->config.fetcher_thread_count; i++) {
+    config = &g_event_processor->config;
+    __atomic_store_n(&g_event_processor->running, 1, __ATOMIC_RELEASE);
+
+    /* 先启动匹配线程，采集线程开始分发时队列已经有消费者 */
+    for (uint32_t i = 0; i < config->matcher_pool_config.thread_count; i++) {
         task_arg = malloc(sizeof(linx_event_processor_task_t));
         if (!task_arg) {
-            return -1;
+            goto clean_threads;
+        }
+
+        task_arg->type = LINX_TASK_TYPE_MATCH_EVENT;
+        task_arg->processor = g_event_processor;
+        task_arg->worker_id = i;
+
+        ret = linx_thread_pool_add_task(g_event_processor->matcher_pool, event_match_worker, task_arg);
+        if (ret) {
+            free(task_arg);
+            goto clean_threads;
+        }
+    }
+
+    for (uint32_t i = 0; i < config->fetcher_pool_config.thread_count; i++) {
+        task_arg = malloc(sizeof(linx_event_processor_task_t));
+        if (!task_arg) {
+            goto clean_threads;
         }
 
         task_arg->type = LINX_TASK_TYPE_FETCH_EVENT;
@@ -176,26 +537,64 @@ int linx_event_processor_start(void)
         ret = linx_thread_pool_add_task(g_event_processor->fetcher_pool, event_fetch_worker, task_arg);
         if (ret) {
             free(task_arg);
-            return -1;
+            goto clean_threads;
         }
     }
 
     return 0;
+
+clean_threads:
+    LINX_LOG_ERROR("Failed to start event processor threads");
+    linx_event_processor_stop();
+    return -1;
 }
 
+/**
+ * 先停止采集线程，再关闭队列，匹配线程处理完队列中剩余的事件后退出
+*/
 int linx_event_processor_stop(void)
 {
     if (!g_event_processor) {
         return -1;
     }
 
+    __atomic_store_n(&g_event_processor->running, 0, __ATOMIC_RELEASE);
+
     if (g_event_processor->fetcher_pool) {
         linx_thread_pool_destroy(g_event_processor->fetcher_pool, 1);
+        g_event_processor->fetcher_pool = NULL;
+    }
+
+    for (uint32_t i = 0; i < g_event_processor->config.matcher_pool_config.thread_count; i++) {
+        linx_event_queue_close(g_event_processor->queues[i]);
     }
 
     if (g_event_processor->matcher_pool) {
         linx_thread_pool_destroy(g_event_processor->matcher_pool, 1);
+        g_event_processor->matcher_pool = NULL;
     }
 
     return 0;
 }
+
+void linx_event_processor_get_stats(linx_event_processor_stats_t *stats)
+{
+    linx_event_queue_stats_t queue_stats;
+
+    memset(stats, 0, sizeof(linx_event_processor_stats_t));
+
+    if (!g_event_processor) {
+        return;
+    }
+
+    stats->n_fetched = __atomic_load_n(&g_event_processor->stats.n_fetched, __ATOMIC_RELAXED);
+    stats->n_drops = __atomic_load_n(&g_event_processor->stats.n_drops, __ATOMIC_RELAXED);
+    stats->n_mallocs = __atomic_load_n(&g_event_processor->stats.n_mallocs, __ATOMIC_RELAXED);
+    stats->n_engine_drops = __atomic_load_n(&g_event_processor->stats.n_engine_drops, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < g_event_processor->config.matcher_pool_config.thread_count; i++) {
+        linx_event_queue_get_stats(g_event_processor->queues[i], &queue_stats);
+        stats->n_queued += queue_stats.size;
+        stats->n_drops += queue_stats.n_drops;
+    }
+}
@@ -1,19 +1,69 @@
 #ifndef __LINX_EVENT_QUEUE_H__
-#define __LINX_EVENT_QUEUE_H__ 
+#define __LINX_EVENT_QUEUE_H__
 
 #include <stdint.h>
 
+#include "linx_config.h"
+
+#define LINX_EVENT_QUEUE_CACHELINE_SIZE     64
+
+/**
+ * 队列中的一个槽位，seq 标识该槽位当前可以被哪一轮的生产者或消费者使用
+*/
+typedef struct {
+    uint64_t seq;
+    void *data;
+} linx_event_queue_cell_t;
+
+typedef struct {
+    uint32_t capacity;
+    uint64_t size;              /* 当前队列中的事件数 */
+    uint64_t n_pushed;
+    uint64_t n_popped;
+    uint64_t n_drops;           /* 按 drop_oldest/drop_newest 丢弃的事件数 */
+    uint64_t n_blocks;          /* block 策略下生产者等待的次数 */
+} linx_event_queue_stats_t;
+
+typedef void (*linx_event_queue_drop_t)(void *item);
+
+/**
+ * 有界无锁多生产者多消费者队列，队列中只保存事件的指针
+ * 生产者和消费者的位置分别独占一个缓存行，避免伪共享
+*/
 typedef struct {
-    int capacity;
-    int head;
-    int tail;
-    int count;
+    linx_event_queue_cell_t *cells;
+    uint64_t mask;
+    uint32_t capacity;
+    linx_queue_policy_t policy;
+    linx_event_queue_drop_t drop;   /* 事件被丢弃时调用，由创建者释放事件 */
+
+    uint64_t enqueue_pos __attribute__((aligned(LINX_EVENT_QUEUE_CACHELINE_SIZE)));
+    uint64_t dequeue_pos __attribute__((aligned(LINX_EVENT_QUEUE_CACHELINE_SIZE)));
+
+    /* 以下成员只在队列空/满需要等待时使用，作为 futex */
+    uint32_t push_seq __attribute__((aligned(LINX_EVENT_QUEUE_CACHELINE_SIZE)));
+    uint32_t pop_seq;
+    uint32_t push_waiters;      /* 等待队列非满的生产者数 */
+    uint32_t pop_waiters;       /* 等待队列非空的消费者数 */
+    uint32_t closed;
+
+    uint64_t n_drops;
+    uint64_t n_blocks;
 } linx_event_queue_t;
 
-int linx_event_queue_init(uint64_t capacity);
+linx_event_queue_t *linx_event_queue_create(uint32_t capacity, linx_queue_policy_t policy,
+                                            linx_event_queue_drop_t drop);
+
+void linx_event_queue_destroy(linx_event_queue_t *queue);
+
+int linx_event_queue_push(linx_event_queue_t *queue, void *item);
+
+int linx_event_queue_pop(linx_event_queue_t *queue, void **item);
+
+int linx_event_queue_pop_wait(linx_event_queue_t *queue, void **item, int timeout_ms);
 
-int linx_event_queue_push(void);
+void linx_event_queue_close(linx_event_queue_t *queue);
 
-void linx_event_queue_free(void);
+void linx_event_queue_get_stats(linx_event_queue_t *queue, linx_event_queue_stats_t *stats);
 
 #endif /* __LINX_EVENT_QUEUE_H__ */
@@ -1,23 +1,284 @@
-#include "event.h"
-#include "linx_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
 #include "linx_event_queue.h"
-#include "linx_hash_map.h"
 
-#include "linx_event.h"
-#include "linx_ebpf_api.h"
-int linx_event_queue_init(uint64_t capacity)
+static void linx_event_queue_futex_wait(uint32_t *addr, uint32_t val, int timeout_ms)
+{
+    struct timespec ts, *tsp = NULL;
+
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+        tsp = &ts;
+    }
+
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, tsp, NULL, 0);
+}
+
+static void linx_event_queue_futex_wake(uint32_t *addr, int n)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+static int linx_event_queue_try_push(linx_event_queue_t *queue, void *item)
+{
+    linx_event_queue_cell_t *cell;
+    uint64_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+    uint64_t seq;
+    int64_t diff;
+
+    while (1) {
+        cell = &queue->cells[pos & queue->mask];
+        seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (int64_t)seq - (int64_t)pos;
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        } else if (diff < 0) {
+            /* 该槽位上一轮的事件还没有被取走，队列已满 */
+            return -1;
+        } else {
+            pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->data = item;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static int linx_event_queue_try_pop(linx_event_queue_t *queue, void **item)
 {
-    (void)capacity;
+    linx_event_queue_cell_t *cell;
+    uint64_t pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+    uint64_t seq;
+    int64_t diff;
+
+    while (1) {
+        cell = &queue->cells[pos & queue->mask];
+        seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (int64_t)seq - (int64_t)(pos + 1);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        } else if (diff < 0) {
+            /* 该槽位本轮的事件还没有写入，队列为空 */
+            return -1;
+        } else {
+            pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    *item = cell->data;
+    __atomic_store_n(&cell->seq, pos + queue->mask + 1, __ATOMIC_RELEASE);
 
     return 0;
 }
 
-int linx_event_queue_push(void)
+/**
+ * 只有存在等待者时才进入内核唤醒，队列不空不满时没有系统调用
+*/
+static void linx_event_queue_notify(uint32_t *seq, uint32_t *waiters)
+{
+    __atomic_add_fetch(seq, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(waiters, __ATOMIC_SEQ_CST)) {
+        linx_event_queue_futex_wake(seq, 1);
+    }
+}
+
+static void linx_event_queue_drop(linx_event_queue_t *queue, void *item)
+{
+    __atomic_add_fetch(&queue->n_drops, 1, __ATOMIC_RELAXED);
+
+    if (queue->drop) {
+        queue->drop(item);
+    }
+}
+
+linx_event_queue_t *linx_event_queue_create(uint32_t capacity, linx_queue_policy_t policy,
+                                            linx_event_queue_drop_t drop)
+{
+    linx_event_queue_t *queue;
+    uint32_t size = 2;
+
+    /* 槽位数必须是2的幂 */
+    while (size < capacity && size < (1U << 31)) {
+        size <<= 1;
+    }
+
+    queue = aligned_alloc(LINX_EVENT_QUEUE_CACHELINE_SIZE, sizeof(linx_event_queue_t));
+    if (!queue) {
+        return NULL;
+    }
+
+    memset(queue, 0, sizeof(linx_event_queue_t));
+
+    queue->cells = calloc(size, sizeof(linx_event_queue_cell_t));
+    if (!queue->cells) {
+        free(queue);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < size; ++i) {
+        queue->cells[i].seq = i;
+    }
+
+    queue->capacity = size;
+    queue->mask = size - 1;
+    queue->policy = policy;
+    queue->drop = drop;
+
+    return queue;
+}
+
+void linx_event_queue_destroy(linx_event_queue_t *queue)
+{
+    void *item;
+
+    if (!queue) {
+        return;
+    }
+
+    linx_event_queue_close(queue);
+
+    while (linx_event_queue_try_pop(queue, &item) == 0) {
+        if (queue->drop) {
+            queue->drop(item);
+        }
+    }
+
+    free(queue->cells);
+    free(queue);
+}
+
+/**
+ * 返回0表示事件已入队，1表示按策略丢弃了事件，-1表示队列已关闭，事件仍归调用者所有
+*/
+int linx_event_queue_push(linx_event_queue_t *queue, void *item)
+{
+    void *oldest;
+    uint32_t seq;
+    int ret = 0;
+
+    if (__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+
+    while (linx_event_queue_try_push(queue, item)) {
+        switch (queue->policy) {
+        case LINX_QUEUE_POLICY_DROP_NEWEST:
+            linx_event_queue_drop(queue, item);
+            return 1;
+        case LINX_QUEUE_POLICY_DROP_OLDEST:
+            if (linx_event_queue_try_pop(queue, &oldest) == 0) {
+                linx_event_queue_drop(queue, oldest);
+                ret = 1;
+            }
+            break;
+        case LINX_QUEUE_POLICY_BLOCK:
+        default:
+            __atomic_add_fetch(&queue->n_blocks, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&queue->push_waiters, 1, __ATOMIC_SEQ_CST);
+            seq = __atomic_load_n(&queue->pop_seq, __ATOMIC_SEQ_CST);
+
+            if (linx_event_queue_try_push(queue, item) == 0) {
+                __atomic_sub_fetch(&queue->push_waiters, 1, __ATOMIC_SEQ_CST);
+                goto pushed;
+            }
+
+            if (__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE)) {
+                __atomic_sub_fetch(&queue->push_waiters, 1, __ATOMIC_SEQ_CST);
+                return -1;
+            }
+
+            linx_event_queue_futex_wait(&queue->pop_seq, seq, -1);
+            __atomic_sub_fetch(&queue->push_waiters, 1, __ATOMIC_SEQ_CST);
+            break;
+        }
+    }
+
+pushed:
+    linx_event_queue_notify(&queue->push_seq, &queue->pop_waiters);
+
+    return ret;
+}
+
+int linx_event_queue_pop(linx_event_queue_t *queue, void **item)
 {
+    if (linx_event_queue_try_pop(queue, item)) {
+        return -1;
+    }
+
+    if (queue->policy == LINX_QUEUE_POLICY_BLOCK) {
+        linx_event_queue_notify(&queue->pop_seq, &queue->push_waiters);
+    }
+
     return 0;
 }
 
-void linx_event_queue_free(void)
+/**
+ * 队列为空时最多等待 timeout_ms 毫秒，小于0表示一直等待
+ * 超时或队列已关闭并且为空时返回-1
+*/
+int linx_event_queue_pop_wait(linx_event_queue_t *queue, void **item, int timeout_ms)
 {
+    uint32_t seq;
+    int ret;
+
+    if (linx_event_queue_pop(queue, item) == 0) {
+        return 0;
+    }
+
+    __atomic_add_fetch(&queue->pop_waiters, 1, __ATOMIC_SEQ_CST);
+    seq = __atomic_load_n(&queue->push_seq, __ATOMIC_SEQ_CST);
+
+    ret = linx_event_queue_pop(queue, item);
+    if (ret && !__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE)) {
+        linx_event_queue_futex_wait(&queue->push_seq, seq, timeout_ms);
+        ret = linx_event_queue_pop(queue, item);
+    }
 
+    __atomic_sub_fetch(&queue->pop_waiters, 1, __ATOMIC_SEQ_CST);
+
+    return ret;
+}
+
+/**
+ * 关闭后不再接收新的事件，唤醒所有等待的生产者和消费者
+*/
+void linx_event_queue_close(linx_event_queue_t *queue)
+{
+    __atomic_store_n(&queue->closed, 1, __ATOMIC_RELEASE);
+
+    __atomic_add_fetch(&queue->push_seq, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&queue->pop_seq, 1, __ATOMIC_SEQ_CST);
+    linx_event_queue_futex_wake(&queue->push_seq, INT_MAX);
+    linx_event_queue_futex_wake(&queue->pop_seq, INT_MAX);
+}
+
+void linx_event_queue_get_stats(linx_event_queue_t *queue, linx_event_queue_stats_t *stats)
+{
+    /* 先读出队位置，保证 size 不会为负 */
+    stats->n_popped = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_ACQUIRE);
+    stats->n_pushed = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_ACQUIRE);
+    stats->size = stats->n_pushed - stats->n_popped;
+    stats->capacity = queue->capacity;
+    stats->n_drops = __atomic_load_n(&queue->n_drops, __ATOMIC_RELAXED);
+    stats->n_blocks = __atomic_load_n(&queue->n_blocks, __ATOMIC_RELAXED);
 }
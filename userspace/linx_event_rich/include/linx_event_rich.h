@@ -4,14 +4,48 @@
 #include <stdint.h>
 
 #include "linx_event.h"
+#include "linx_hash_map.h"
+#include "linx_user_cache.h"
 #include "event.h"
 
+/**
+ * 丰富时需要绑定基地址的字段表
+*/
+typedef enum {
+    LINX_EVENT_RICH_TABLE_EVT,
+    LINX_EVENT_RICH_TABLE_FD,
+    LINX_EVENT_RICH_TABLE_PROC,
+    LINX_EVENT_RICH_TABLE_USER,
+    LINX_EVENT_RICH_TABLE_GROUP,
+    LINX_EVENT_RICH_TABLE_MAX
+} linx_event_rich_table_t;
+
+/**
+ * 事件上下文，每个匹配线程一个
+ * 丰富后的 evt 和各个表的基地址都保存在这里，传给规则匹配和告警格式化
+*/
+typedef struct {
+    event_t evt;
+    linx_field_ctx_t fields;
+
+    /**
+     * 事件 uid/gid 对应的 user、group 表，从用户缓存复制
+     * 相邻事件的 uid 通常相同，没有变化且仍有效时不再访问用户缓存
+    */
+    user_t user;
+    group_t group;
+    uint32_t user_generation;
+    uint32_t group_generation;
+    time_t user_expire;
+    time_t group_expire;
+} linx_event_ctx_t;
+
 int linx_event_rich_init(void);
 
 int linx_event_rich_deinit(void);
 
-int linx_event_rich(linx_event_t *event);
+int linx_event_rich(linx_event_ctx_t *ctx, linx_event_t *event);
 
-event_t *linx_event_rich_get(void);
+void linx_event_ctx_clean(linx_event_ctx_t *ctx);
 
 #endif /* __LINX_EVENT_RICH_H__ */
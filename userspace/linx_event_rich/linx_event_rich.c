@@ -1,6 +1,7 @@
+#define _GNU_SOURCE
 #include <time.h>
+#include <sched.h>
 #include <sys/types.h>
-#include <pwd.h>
 #include <stdio.h>
 
 #include "linx_event_rich.h"
@@ -9,21 +10,55 @@
 
 #include "linx_event_table.h"
 #include "linx_process_cache.h"
-#include "linx_machine_status.h"
+#include "linx_user_cache.h"
+
+/* 各个字段表在上下文中的下标，没有注册的表为 -1 */
+static int s_table_index[LINX_EVENT_RICH_TABLE_MAX];
+
+static const char *s_table_name[LINX_EVENT_RICH_TABLE_MAX] = {
+    [LINX_EVENT_RICH_TABLE_EVT] = "evt",
+    [LINX_EVENT_RICH_TABLE_FD] = "fd",
+    [LINX_EVENT_RICH_TABLE_PROC] = "proc",
+    [LINX_EVENT_RICH_TABLE_USER] = "user",
+    [LINX_EVENT_RICH_TABLE_GROUP] = "group",
+};
+
+/**
+ * user、group 表按事件的 uid/gid 取值，上下文中保存上一次复制的结果
+*/
+static void rich_user_group(linx_event_ctx_t *ctx, linx_event_t *event)
+{
+    uint32_t generation = linx_user_cache_generation();
+    time_t now = time(NULL);
 
-static event_t evt = {0};
+    if (ctx->user.uid != (uint32_t)event->uid || ctx->user_generation != generation || ctx->user_expire <= now) {
+        linx_user_cache_get_user((uid_t)event->uid, &ctx->user, &ctx->user_expire);
+        ctx->user_generation = generation;
+    }
 
-static int update_field_base(pid_t pid)
+    if (ctx->group.gid != (uint32_t)event->gid || ctx->group_generation != generation || ctx->group_expire <= now) {
+        linx_user_cache_get_group((gid_t)event->gid, &ctx->group, &ctx->group_expire);
+        ctx->group_generation = generation;
+    }
+}
+
+static void update_field_base(linx_event_ctx_t *ctx, pid_t pid)
 {
-    field_update_table_t tables[] = {
-        {"evt", &evt},
-        {"fd", &evt.fd},
-        {"proc", (void *)linx_process_cache_get(pid)},
-        {"user", (void *)linx_machine_status_get_user()},
-        {"group", (void *)linx_machine_status_get_group()},
+    void *bases[LINX_EVENT_RICH_TABLE_MAX] = {
+        [LINX_EVENT_RICH_TABLE_EVT] = &ctx->evt,
+        [LINX_EVENT_RICH_TABLE_FD] = &ctx->evt.fd,
+        [LINX_EVENT_RICH_TABLE_PROC] = (void *)linx_process_cache_get(pid),
+        [LINX_EVENT_RICH_TABLE_USER] = &ctx->user,
+        [LINX_EVENT_RICH_TABLE_GROUP] = &ctx->group,
     };
 
-    return linx_hash_map_update_tables_base(tables, sizeof(tables) / sizeof(tables[0]));
+    for (int i = 0; i < LINX_EVENT_RICH_TABLE_MAX; i++) {
+        if (s_table_index[i] >= 0) {
+            ctx->fields.bases[s_table_index[i]] = bases[i];
+        }
+    }
+
+    ctx->fields.event_type = ctx->evt.num;
 }
 
 static int bind_field_evt(void)
@@ -86,91 +121,177 @@ static int linx_event_rich_bind_field(void)
     return ret;
 }
 
-static void rich_event_clean(linx_event_t *event)
-{
-    for (uint32_t i = 0; i < g_linx_event_table[event->type].nparams; ++i) {
-        switch (g_linx_event_table[event->type].params[i].type) {
-        case LINX_FIELD_TYPE_UID:
-        case LINX_FIELD_TYPE_PID:
-            free(evt.arg.data[i]);
-            evt.arg.data[i] = evt.rawarg.data[i] = NULL;
-            break;
-        default:
-            break;
-        }
-    }
-}
-
-static void rich_event_args(linx_event_t *event)
+static void rich_event_args(event_t *evt, linx_event_t *event)
 {
     uint64_t size = 0;
-    void *base = (void *)event + LINX_EVENT_HEADER_SIZE;
+    void *base = linx_event_params(event);
 
-    evt.args = (char *)base;
+    evt->args = (char *)base;
 
     for (uint32_t i = 0; i < g_linx_event_table[event->type].nparams; ++i) {
         switch (g_linx_event_table[event->type].params[i].type) {
-        case LINX_FIELD_TYPE_UID:
-            struct passwd *pw = getpwuid((uid_t)(*(uint32_t *)(base + size)));
-            if (pw) {
-                evt.arg.data[i] = evt.rawarg.data[i] = 
-                    strdup(pw->pw_name);
-            } else {
-                evt.arg.data[i] = evt.rawarg.data[i] = 
-                    strdup("unknown");
+        case LINX_FIELD_TYPE_UID: {
+            /* 用户名复制到事件自己的缓冲区，不需要在下一个事件中释放 */
+            if (linx_user_cache_get_name((uid_t)(*(uint32_t *)(base + size)),
+                                         evt->uid_name[i], sizeof(evt->uid_name[i])))
+            {
+                snprintf(evt->uid_name[i], sizeof(evt->uid_name[i]), "unknown");
             }
+            evt->arg.data[i] = evt->rawarg.data[i] = evt->uid_name[i];
+            evt->arg.len[i] = strlen(evt->uid_name[i]);
             break;
-        case LINX_FIELD_TYPE_PID:
+        }
+        case LINX_FIELD_TYPE_PID: {
+            /* 进程名同样复制到事件自己的缓冲区，告警输出时进程缓存中的字符串可能已经被回收 */
             linx_process_info_t *info = linx_process_cache_get((pid_t)(*(int64_t *)(base + size)));
-            if (info) {
-                evt.arg.data[i] = evt.rawarg.data[i] = 
-                    strdup(info->comm);
-            } else {
-                evt.arg.data[i] = evt.rawarg.data[i] = 
-                    strdup("unknown");
+
+            snprintf(evt->pid_name[i], sizeof(evt->pid_name[i]), "%s",
+                     (info && info->comm) ? info->comm : "unknown");
+            evt->arg.data[i] = evt->rawarg.data[i] = evt->pid_name[i];
+            evt->arg.len[i] = strlen(evt->pid_name[i]);
+            break;
+        }
+        case LINX_FIELD_TYPE_CHARBUF:
+            /* 内核读取的字符串长度包含结尾的 '\0' */
+            evt->arg.data[i] = evt->rawarg.data[i] = base + size;
+            evt->arg.len[i] = event->params_size[i];
+            if (evt->arg.len[i] && ((char *)base)[size + evt->arg.len[i] - 1] == '\0') {
+                evt->arg.len[i]--;
             }
             break;
         default:
-            evt.arg.data[i] = evt.rawarg.data[i] = base + size;
+            evt->arg.data[i] = evt->rawarg.data[i] = base + size;
+            evt->arg.len[i] = event->params_size[i];
             break;
         }
 
+        evt->rawarg.len[i] = evt->arg.len[i];
         size += event->params_size[i];
     }
 }
 
-static void rich_execve_exit(linx_event_t *event)
+/**
+ * 进程快照在进程第一次被采集或 exec 之后由内核发送一次
+ * 之后该进程的事件都从进程缓存中获取上下文
+*/
+static void rich_proc_snapshot(linx_event_t *event)
 {
-    linx_process_info_t *info = malloc(sizeof(linx_process_info_t));
-    if (!info) {
-        return;
+    uint16_t len = 0;
+    linx_process_snapshot_t snapshot = {
+        .pid = (pid_t)event->pid,
+        .ppid = (pid_t)event->ppid,
+        .uid = (uid_t)event->uid,
+        .gid = (gid_t)event->gid,
+        .comm = event->comm,
+        .comm_len = LINX_COMM_MAX_SIZE,
+    };
+
+    /* 字符串直接引用事件中的内容，由进程缓存驻留 */
+    snapshot.cmdline = linx_event_context(event, LINX_EVENT_CONTEXT_CMDLINE, &len);
+    snapshot.cmdline_len = len;
+
+    snapshot.exe = linx_event_context(event, LINX_EVENT_CONTEXT_FULLPATH, &len);
+    snapshot.exe_len = len;
+
+    linx_process_cache_snapshot(&snapshot);
+}
+
+/**
+ * 获取事件第 index 个参数的位置和长度
+*/
+static const char *rich_event_param(linx_event_t *event, uint32_t index, uint32_t *len)
+{
+    const char *pos = linx_event_params(event);
+
+    for (uint32_t i = 0; i < index; ++i) {
+        pos += event->params_size[i];
     }
 
-    memset(info, 0, sizeof(linx_process_info_t));
+    if (len) {
+        *len = event->params_size[index];
+    }
 
-    info->pid = (pid_t)event->pid;
-    info->ppid = (pid_t)event->ppid;
-    info->create_time = time(NULL);
-    info->update_time = info->create_time;
-    info->is_alive = true;
-    info->is_rich = true;
-    info->state = LINX_PROCESS_STATE_RUNNING;
+    return pos;
+}
 
-    memcpy(info->name, event->comm, strlen(event->comm));
-    memcpy(info->comm, event->comm, strlen(event->comm));
-    memcpy(info->cmdline, event->cmdline, strlen(event->cmdline));
+/**
+ * 根据 clone、execve、chdir 等事件增量维护进程缓存，只处理成功的系统调用
+*/
+static void rich_proc_event(linx_event_t *event)
+{
+    int64_t res = (int64_t)event->res;
+    const char *param;
+    uint32_t len = 0;
+
+    switch (event->type) {
+    case LINX_EVENT_TYPE_CLONE_X:
+    case LINX_EVENT_TYPE_CLONE3_X:
+    case LINX_EVENT_TYPE_FORK_X:
+    case LINX_EVENT_TYPE_VFORK_X:
+        if (res == 0) {
+            /* 子进程中返回0，新线程的 tid 和 pid 不同 */
+            if (event->tid == event->pid) {
+                linx_process_cache_fork((pid_t)event->ppid, (pid_t)event->pid);
+            }
+        } else if (res > 0) {
+            /* 父进程中返回子进程的 tid，clone3 的标志不在参数中，只能等子进程的事件 */
+            if (event->type == LINX_EVENT_TYPE_CLONE3_X) {
+                break;
+            }
+
+            param = rich_event_param(event, 0, &len);
+            if (event->type == LINX_EVENT_TYPE_CLONE_X &&
+                (len != sizeof(uint64_t) || (*(uint64_t *)param & CLONE_THREAD)))
+            {
+                break;
+            }
 
-    linx_process_cache_update(info);
+            linx_process_cache_fork((pid_t)event->pid, (pid_t)res);
+        }
+        break;
+    case LINX_EVENT_TYPE_EXECVE_X:
+        if (res == 0) {
+            /* env 参数实际是 '\0' 分隔的参数列表 */
+            param = rich_event_param(event, 5, &len);
+            linx_process_cache_exec((pid_t)event->pid, event->comm, len ? param : NULL, len);
+        }
+        break;
+    case LINX_EVENT_TYPE_EXECVEAT_X:
+        if (res == 0) {
+            linx_process_cache_exec((pid_t)event->pid, event->comm, NULL, 0);
+        }
+        break;
+    case LINX_EVENT_TYPE_CHDIR_X:
+        if (res == 0) {
+            param = rich_event_param(event, 0, &len);
+            linx_process_cache_chdir((pid_t)event->pid, len ? param : NULL);
+        }
+        break;
+    case LINX_EVENT_TYPE_FCHDIR_X:
+        if (res == 0) {
+            linx_process_cache_chdir((pid_t)event->pid, NULL);
+        }
+        break;
+    case LINX_EVENT_TYPE_PROC_EXIT:
+        linx_process_cache_exit((pid_t)event->pid);
+        break;
+    default:
+        break;
+    }
 }
 
 int linx_event_rich_init(void)
 {
     int ret = linx_event_rich_bind_field();
 
+    for (int i = 0; i < LINX_EVENT_RICH_TABLE_MAX; i++) {
+        s_table_index[i] = linx_hash_map_get_table_index(s_table_name[i]);
+    }
+
     return ret;
 }
 
-int linx_event_rich(linx_event_t *event)
+int linx_event_rich(linx_event_ctx_t *ctx, linx_event_t *event)
 {
     /**
      * 根据event事件类型
@@ -182,48 +303,47 @@ int linx_event_rich(linx_event_t *event)
     uint64_t ns = event->time;
     uint64_t remaining_ns = ns % 1000000000;
     time_t seconds = ns / 1000000000;
-    struct tm *timeinfo = localtime(&seconds);
-    size_t len = strftime(evt.time, sizeof(evt.time), "%Y-%m-%d %H:%M:%S", timeinfo);
-    int ret;
-
-    rich_event_clean(event);
+    struct tm timeinfo;
+    size_t len = strftime(ctx->evt.time, sizeof(ctx->evt.time), "%Y-%m-%d %H:%M:%S",
+                          localtime_r(&seconds, &timeinfo));
 
     /**
      * 更新事件参数相关内容
     */
-    rich_event_args(event);
+    rich_event_args(&ctx->evt, event);
 
     /**
      * 根据不同的事件，进行不同的上下文丰富
     */
     switch (event->type) {
-        case LINX_EVENT_TYPE_EXECVE_X:
-            if (strcmp(event->comm, "find") == 0)
-                rich_execve_exit(event);
+        case LINX_EVENT_TYPE_PROC_SNAPSHOT:
+            rich_proc_snapshot(event);
             break;
         default:
+            rich_proc_event(event);
             break;
     }
 
-    snprintf(evt.time + len, sizeof(evt.time) - len, ".%09lu", remaining_ns);
+    snprintf(ctx->evt.time + len, sizeof(ctx->evt.time) - len, ".%09lu", remaining_ns);
 
-    evt.num = event->type;
+    ctx->evt.num = event->type;
     event->type % 2 ? 
-        strcpy(evt.dir, "<") : 
-        strcpy(evt.dir, ">");
-    evt.type = (char *)g_linx_event_table[event->type].name;
-    evt.rawres = (int64_t)event->res;
-    if (evt.rawres == 0) {
-        evt.failed = false;
-        strcpy(evt.res, "SUCCESS");
+        strcpy(ctx->evt.dir, "<") : 
+        strcpy(ctx->evt.dir, ">");
+    ctx->evt.type = (char *)g_linx_event_table[event->type].name;
+    ctx->evt.rawres = (int64_t)event->res;
+    if (ctx->evt.rawres == 0) {
+        ctx->evt.failed = false;
+        strcpy(ctx->evt.res, "SUCCESS");
     } else {
-        evt.failed = true;
-        strcpy(evt.res, "ERRNO");
+        ctx->evt.failed = true;
+        strcpy(ctx->evt.res, "ERRNO");
     }
 
-    ret = update_field_base(event->pid);
+    rich_user_group(ctx, event);
+    update_field_base(ctx, (pid_t)event->pid);
 
-    return ret;
+    return 0;
 }
 
 int linx_event_rich_deinit(void)
@@ -231,7 +351,11 @@ int linx_event_rich_deinit(void)
     return 0;
 }
 
-event_t *linx_event_rich_get(void)
+/**
+ * 事件参数都指向事件本身或上下文中的缓冲区，没有需要释放的内存，只清空参数
+*/
+void linx_event_ctx_clean(linx_event_ctx_t *ctx)
 {
-    return &evt;
+    memset(&ctx->evt.arg, 0, sizeof(ctx->evt.arg));
+    memset(&ctx->evt.rawarg, 0, sizeof(ctx->evt.rawarg));
 }
@@ -4238,4 +4238,12 @@ const linx_event_table_t g_linx_event_table[LINX_EVENT_TYPE_MAX] = {
 			{"flags", LINX_FIELD_TYPE_UINT32},
 		},
 	},
+	[LINX_EVENT_TYPE_PROC_SNAPSHOT] = {
+		"proc_snapshot", 0,
+		{}
+	},
+	[LINX_EVENT_TYPE_PROC_EXIT] = {
+		"proc_exit", 0,
+		{}
+	},
 };
@@ -10,6 +10,7 @@ typedef struct {
     char *table_name;
     field_info_t *fields;
     void *base_addr;        /* 结构体的基地址 */
+    int index;              /* 在字段上下文基地址数组中的下标 */
     UT_hash_handle hh;
 } field_table_t;
 
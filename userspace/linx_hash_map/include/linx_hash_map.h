@@ -7,6 +7,9 @@
 #include "field_table.h"
 #include "linx_field_type.h"
 
+#define LINX_HASH_MAP_TABLE_MAX_SIZE    16
+#define LINX_HASH_MAP_LEN_UNKNOWN       ((size_t)-1)
+
 /**
  * 汇总
 */
@@ -27,9 +30,20 @@ typedef struct {
     char *table_name;
     char *field_name;
     char *arg;
-    uint64_t *event_type;       /* 默认指向一个全局的事件类型地址，标识每次事件的类型 */
+    int table_index;            /* 直接索引上下文中的基地址，匹配时不再按表名查找 */
+    int arg_index;              /* evt.arg.N 形式的参数下标或数组字段的下标，按名称引用时为 -1 */
+    int8_t *arg_indexes;        /* evt.arg.<name> 在每种事件中的参数下标，-1 表示该事件没有此参数 */
 } field_result_t;
 
+/**
+ * 一个事件的字段上下文，保存该事件各个表的基地址
+ * 每个匹配线程持有自己的上下文，多个事件可以同时匹配
+*/
+typedef struct {
+    void *bases[LINX_HASH_MAP_TABLE_MAX_SIZE];  /* 下标为表的 index */
+    uint64_t event_type;                        /* evt.arg.xxx 按事件类型查找参数 */
+} linx_field_ctx_t;
+
 /**
  * 批量添加字段映射
 */
@@ -102,7 +116,14 @@ field_result_t linx_hash_map_get_field(const char *table_name, const char *field
 
 field_result_t linx_hash_map_get_field_by_path(char *path);
 
-void *linx_hash_map_get_value_ptr(const field_result_t *field, linx_field_type_t *type);
+void linx_hash_map_release_field(field_result_t *field);
+
+void *linx_hash_map_get_value_ptr(const linx_field_ctx_t *ctx, const field_result_t *field, linx_field_type_t *type);
+
+void *linx_hash_map_get_value(const linx_field_ctx_t *ctx, const field_result_t *field,
+                              linx_field_type_t *type, size_t *len);
+
+int linx_hash_map_get_table_index(const char *table_name);
 
 int linx_hash_map_update_table_base(const char *table_name, void *base_addr);
 
@@ -1,8 +1,8 @@
 #include <stddef.h>
 
 #include "linx_hash_map.h"
-#include "linx_event_rich.h"
 #include "linx_event_table.h"
+#include "linx_size_define.h"
 
 static linx_hash_map_t *s_linx_hash_map = NULL;
 
@@ -43,6 +43,8 @@ int linx_hash_map_init(void)
     }
 
     s_linx_hash_map->tables = NULL;
+    s_linx_hash_map->size = 0;
+    s_linx_hash_map->capacity = LINX_HASH_MAP_TABLE_MAX_SIZE;
 
     return 0;
 }
@@ -77,6 +79,10 @@ int linx_hash_map_create_table(const char *table_name, void *base_addr)
         return -1;
     }
 
+    if (s_linx_hash_map->size >= s_linx_hash_map->capacity) {
+        return -1;
+    }
+
     new_table = malloc(sizeof(field_table_t));
     if (new_table == NULL) {
         return -1;
@@ -85,6 +91,7 @@ int linx_hash_map_create_table(const char *table_name, void *base_addr)
     new_table->table_name = strdup(table_name);
     new_table->base_addr = base_addr;   /* 可以为NULL,表示延迟绑定 */
     new_table->fields = NULL;
+    new_table->index = s_linx_hash_map->size++;
 
     HASH_ADD_STR(s_linx_hash_map->tables, table_name, new_table);
 
@@ -104,8 +111,9 @@ int linx_hash_map_remove_table(const char *table_name)
         return -1;
     }
 
+    /* 下标不回收，其他表的下标保持不变 */
     HASH_DEL(s_linx_hash_map->tables, table);
-    s_linx_hash_map->size--;
+    destroy_field_table(table);
 
     return 0;
 }
@@ -195,10 +203,55 @@ field_result_t linx_hash_map_get_field(const char *table_name, const char *field
     result.found = true;
     result.table_name = table->table_name;
     result.field_name = field->key;
+    result.table_index = table->index;
 
     return result;
 }
 
+/**
+ * 规则编译时把参数名解析为每种事件中的参数下标，
+ * 匹配时取参数只需要一次数组索引，不再 strtol 和逐个比较参数名
+*/
+static int linx_hash_map_resolve_arg(field_result_t *result)
+{
+    char *endptr;
+    long index = strtol(result->arg, &endptr, 10);
+
+    result->arg_index = -1;
+    result->arg_indexes = NULL;
+
+    if (*endptr == '\0') {
+        if (index >= 0 && index < SYSCALL_PARAMS_MAX_COUNT) {
+            result->arg_index = (int)index;
+        }
+
+        return 0;
+    }
+
+    /* 只有事件参数可以按名称引用，数组字段只能使用下标 */
+    if (result->type != LINX_FIELD_TYPE_STRUCT) {
+        return -1;
+    }
+
+    result->arg_indexes = malloc(LINX_EVENT_TYPE_MAX * sizeof(int8_t));
+    if (!result->arg_indexes) {
+        return -1;
+    }
+
+    for (int type = 0; type < LINX_EVENT_TYPE_MAX; type++) {
+        result->arg_indexes[type] = -1;
+
+        for (uint32_t i = 0; i < g_linx_event_table[type].nparams; i++) {
+            if (strcmp(g_linx_event_table[type].params[i].name, result->arg) == 0) {
+                result->arg_indexes[type] = (int8_t)i;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
 field_result_t linx_hash_map_get_field_by_path(char *path)
 {
     char *table_name, *field_name, *arg;
@@ -226,51 +279,96 @@ field_result_t linx_hash_map_get_field_by_path(char *path)
         result.arg = NULL;
     } else {
         result.arg = strdup(arg);
+        if (!result.arg || linx_hash_map_resolve_arg(&result)) {
+            linx_hash_map_release_field(&result);
+            result.found = false;
+        }
     }
 
-    result.event_type = &(linx_event_rich_get()->num);
-
     return result;
 }
 
-void *linx_hash_map_get_value_ptr(const field_result_t *field, linx_field_type_t *type)
+void linx_hash_map_release_field(field_result_t *field)
 {
-    void *base_addr, *ptr;
+    if (!field) {
+        return;
+    }
+
+    free(field->arg);
+    field->arg = NULL;
+
+    free(field->arg_indexes);
+    field->arg_indexes = NULL;
+}
+
+/**
+ * 参数字段同时返回参数的长度，其他字段的长度未知，*len 为 LINX_HASH_MAP_LEN_UNKNOWN
+ * 带参数的字段是事件参数表(LINX_FIELD_TYPE_STRUCT)或者字符串数组
+*/
+void *linx_hash_map_get_value(const linx_field_ctx_t *ctx, const field_result_t *field,
+                              linx_field_type_t *type, size_t *len)
+{
+    const linx_event_table_t *table;
+    linx_field_args_t *args;
+    void *base_addr;
+    int index;
 
     if (!field->found) {
         return NULL;
     }
 
-    base_addr = linx_hash_map_get_table_base(field->table_name);
+    base_addr = ctx->bases[field->table_index];
     if (base_addr == NULL) {
         return NULL;
     }
 
-    if (field->arg) {
-        char *endptr;
-        long index = strtol(field->arg, &endptr, 10);
-
-        /* 如果不是纯数字，则通过名称查找下标 */
-        if (*endptr != '\0') {
-            for (index = 0; index < g_linx_event_table[*field->event_type].nparams; index++) {
-                if (strcmp(g_linx_event_table[*field->event_type].params[index].name, field->arg) == 0) {
-                    break;
-                }
-            }
+    if (!field->arg) {
+        *type = field->type;
+        if (len) {
+            *len = LINX_HASH_MAP_LEN_UNKNOWN;
         }
+        return (void *)((char *)base_addr + field->offset);
+    }
 
-        if (index >= g_linx_event_table[*field->event_type].nparams) {
+    /* 数组字段(如 proc.aname[N])按下标取元素，越界时没有值 */
+    if (field->type != LINX_FIELD_TYPE_STRUCT) {
+        if (field->type != LINX_FIELD_TYPE_CHARBUF_REF || field->arg_index < 0 ||
+            (size_t)field->arg_index >= field->size / sizeof(const char *))
+        {
             return NULL;
         }
 
-        ptr = (void *)((char *)base_addr + field->offset + index * sizeof(void *));
-        *type = g_linx_event_table[*field->event_type].params[index].type;
-    } else {
-        ptr = (void *)((char *)base_addr + field->offset);
         *type = field->type;
+        if (len) {
+            *len = LINX_HASH_MAP_LEN_UNKNOWN;
+        }
+        return (void *)((char *)base_addr + field->offset + field->arg_index * sizeof(const char *));
     }
 
-    return ptr;
+    if (ctx->event_type >= LINX_EVENT_TYPE_MAX) {
+        return NULL;
+    }
+
+    /* 参数下标已在规则编译时解析 */
+    table = &g_linx_event_table[ctx->event_type];
+    index = field->arg_indexes ? field->arg_indexes[ctx->event_type] : field->arg_index;
+    if (index < 0 || (uint32_t)index >= table->nparams || index >= LINX_FIELD_ARGS_MAX) {
+        return NULL;
+    }
+
+    *type = table->params[index].type;
+
+    args = (linx_field_args_t *)((char *)base_addr + field->offset);
+    if (len) {
+        *len = args->len[index];
+    }
+
+    return &args->data[index];
+}
+
+void *linx_hash_map_get_value_ptr(const linx_field_ctx_t *ctx, const field_result_t *field, linx_field_type_t *type)
+{
+    return linx_hash_map_get_value(ctx, field, type, NULL);
 }
 
 int linx_hash_map_update_table_base(const char *table_name, void *base_addr)
@@ -325,6 +423,22 @@ void *linx_hash_map_get_table_base(const char *table_name)
     return table->base_addr;
 }
 
+int linx_hash_map_get_table_index(const char *table_name)
+{
+    field_table_t *table;
+
+    if (!s_linx_hash_map || !table_name) {
+        return -1;
+    }
+
+    HASH_FIND_STR(s_linx_hash_map->tables, table_name, table);
+    if (!table) {
+        return -1;
+    }
+
+    return table->index;
+}
+
 int linx_hash_map_list_tables(char ***table_names, size_t *num_tables)
 {
     field_table_t *current, *tmp;
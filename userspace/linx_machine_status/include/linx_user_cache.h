@@ -0,0 +1,44 @@
+#ifndef __LINX_USER_CACHE_H__
+#define __LINX_USER_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "user_struct.h"
+#include "group_struct.h"
+
+/**
+ * 默认的有效期秒数，/etc/passwd 和 /etc/group 的变化由 inotify 通知
+ * 有效期用于补充 LDAP、sssd 等不经过这两个文件的用户来源
+*/
+#define LINX_USER_CACHE_TTL 300
+
+/**
+ * ttl 为0时不过期，只在 /etc/passwd 或 /etc/group 变化后重新解析
+*/
+int linx_user_cache_init(uint32_t ttl);
+
+void linx_user_cache_deinit(void);
+
+/**
+ * 复制 uid 对应的用户，没有该用户时只设置 uid，返回 -1
+ * expire 不为 NULL 时返回复制出的信息的过期时间，不分配内存
+*/
+int linx_user_cache_get_user(uid_t uid, user_t *user, time_t *expire);
+
+int linx_user_cache_get_group(gid_t gid, group_t *group, time_t *expire);
+
+/**
+ * 只复制用户名，用于 UID 类型的事件参数
+*/
+int linx_user_cache_get_name(uid_t uid, char *name, size_t size);
+
+/**
+ * /etc/passwd 或 /etc/group 每次变化加一
+ * 调用者保存的副本在 generation 变化或者过期之后需要重新获取
+*/
+uint32_t linx_user_cache_generation(void);
+
+#endif /* __LINX_USER_CACHE_H__ */
@@ -6,7 +6,9 @@
 #include <stdio.h>
 
 #include "linx_machine_status.h"
+#include "linx_user_cache.h"
 #include "linx_hash_map.h"
+#include "linx_config.h"
 #include "linx_log.h"
 
 static user_t s_user = {0};
@@ -129,6 +131,7 @@ static int linx_machine_status_bind_field(void)
 
 int linx_machine_status_init(void)
 {
+    linx_global_config_t *config;
     int ret = linx_machine_status_bind_field();
     if (ret) {
         return ret;
@@ -137,12 +140,15 @@ int linx_machine_status_init(void)
     get_current_user(&s_user);
     get_current_group(&s_group);
 
+    config = linx_config_get();
+    ret = linx_user_cache_init(config ? config->user_cache.ttl : LINX_USER_CACHE_TTL);
+
     return ret;
 }
 
 void linx_machine_status_deinit(void)
 {
-
+    linx_user_cache_deinit();
 }
 
 user_t *linx_machine_status_get_user(void)
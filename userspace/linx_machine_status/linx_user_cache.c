@@ -0,0 +1,362 @@
+#include <sys/types.h>
+#include <sys/inotify.h>
+#include <pwd.h>
+#include <grp.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "linx_user_cache.h"
+#include "linx_thread_pool.h"
+#include "linx_log.h"
+
+#define LINX_USER_CACHE_BUCKETS         256         /* 必须是2的幂 */
+#define LINX_USER_CACHE_BUFFER_SIZE     4096        /* getpwuid_r 的初始缓冲区，不够时按倍数增加 */
+#define LINX_USER_CACHE_BUFFER_MAX      (1 << 20)
+#define LINX_USER_CACHE_NEVER           ((time_t)INT64_MAX)
+
+typedef struct linx_user_cache_entry {
+    struct linx_user_cache_entry *next;
+    uint32_t id;
+    uint32_t generation;                /* 解析时的 generation */
+    time_t expire;
+    bool found;                         /* 没有该用户时也缓存，避免反复查询 NSS */
+    union {
+        user_t user;
+        group_t group;
+    };
+} linx_user_cache_entry_t;
+
+typedef int (*linx_user_cache_resolve_t)(uint32_t id, linx_user_cache_entry_t *entry, char *buffer, size_t size);
+
+/**
+ * 命中时只在锁内复制，查询 NSS 在锁外进行
+*/
+typedef struct {
+    pthread_mutex_t lock;
+    linx_user_cache_entry_t *buckets[LINX_USER_CACHE_BUCKETS];
+    linx_user_cache_resolve_t resolve;
+} linx_user_cache_table_t;
+
+static int resolve_user(uint32_t id, linx_user_cache_entry_t *entry, char *buffer, size_t size);
+static int resolve_group(uint32_t id, linx_user_cache_entry_t *entry, char *buffer, size_t size);
+
+static linx_user_cache_table_t s_users = { .lock = PTHREAD_MUTEX_INITIALIZER, .resolve = resolve_user };
+static linx_user_cache_table_t s_groups = { .lock = PTHREAD_MUTEX_INITIALIZER, .resolve = resolve_group };
+
+static uint32_t s_generation = 1;
+static uint32_t s_ttl = LINX_USER_CACHE_TTL;
+static int s_inotify_fd = -1;
+static int s_running = 0;
+static linx_thread_pool_t *s_thread_pool = NULL;
+
+static void copy_name(char *dst, size_t size, const char *src)
+{
+    snprintf(dst, size, "%s", src ? src : "");
+}
+
+/**
+ * 返回 errno 形式的错误码，没有该用户时返回 ENOENT
+*/
+static int resolve_user(uint32_t id, linx_user_cache_entry_t *entry, char *buffer, size_t size)
+{
+    struct passwd pw, *result = NULL;
+    int ret = getpwuid_r((uid_t)id, &pw, buffer, size, &result);
+
+    if (ret) {
+        return ret;
+    }
+
+    if (!result) {
+        return ENOENT;
+    }
+
+    copy_name(entry->user.name, sizeof(entry->user.name), pw.pw_name);
+    copy_name(entry->user.homedir, sizeof(entry->user.homedir), pw.pw_dir);
+    copy_name(entry->user.shell, sizeof(entry->user.shell), pw.pw_shell);
+
+    return 0;
+}
+
+static int resolve_group(uint32_t id, linx_user_cache_entry_t *entry, char *buffer, size_t size)
+{
+    struct group gr, *result = NULL;
+    int ret = getgrgid_r((gid_t)id, &gr, buffer, size, &result);
+
+    if (ret) {
+        return ret;
+    }
+
+    if (!result) {
+        return ENOENT;
+    }
+
+    copy_name(entry->group.name, sizeof(entry->group.name), gr.gr_name);
+
+    return 0;
+}
+
+/**
+ * 成员很多的组需要更大的缓冲区，只在没有命中时分配
+*/
+static bool user_cache_resolve(linx_user_cache_table_t *table, uint32_t id, linx_user_cache_entry_t *entry)
+{
+    char stack_buffer[LINX_USER_CACHE_BUFFER_SIZE];
+    char *buffer = stack_buffer, *new_buffer;
+    size_t size = sizeof(stack_buffer);
+    int ret;
+
+    while ((ret = table->resolve(id, entry, buffer, size)) == ERANGE && size < LINX_USER_CACHE_BUFFER_MAX) {
+        size *= 2;
+        new_buffer = (buffer == stack_buffer) ? malloc(size) : realloc(buffer, size);
+        if (!new_buffer) {
+            break;
+        }
+        buffer = new_buffer;
+    }
+
+    if (buffer != stack_buffer) {
+        free(buffer);
+    }
+
+    return ret == 0;
+}
+
+static inline linx_user_cache_entry_t **user_cache_bucket(linx_user_cache_table_t *table, uint32_t id)
+{
+    return &table->buckets[id & (LINX_USER_CACHE_BUCKETS - 1)];
+}
+
+static linx_user_cache_entry_t *user_cache_find(linx_user_cache_table_t *table, uint32_t id)
+{
+    linx_user_cache_entry_t *entry = *user_cache_bucket(table, id);
+
+    while (entry && entry->id != id) {
+        entry = entry->next;
+    }
+
+    return entry;
+}
+
+/**
+ * 复制 id 对应的项到 out，没有命中、过期或者文件变化后重新解析
+*/
+static bool user_cache_get(linx_user_cache_table_t *table, uint32_t id, linx_user_cache_entry_t *out)
+{
+    uint32_t generation = __atomic_load_n(&s_generation, __ATOMIC_ACQUIRE);
+    time_t now = time(NULL);
+    linx_user_cache_entry_t *entry, **bucket;
+
+    pthread_mutex_lock(&table->lock);
+
+    entry = user_cache_find(table, id);
+    if (entry && entry->generation == generation && entry->expire > now) {
+        memcpy(out, entry, sizeof(linx_user_cache_entry_t));
+        pthread_mutex_unlock(&table->lock);
+        return out->found;
+    }
+
+    pthread_mutex_unlock(&table->lock);
+
+    /* NSS 可能查询 sssd 或者 LDAP，耗时较长，不能持有锁 */
+    memset(out, 0, sizeof(linx_user_cache_entry_t));
+    out->id = id;
+    out->generation = generation;
+    out->expire = s_ttl ? now + s_ttl : LINX_USER_CACHE_NEVER;
+    out->found = user_cache_resolve(table, id, out);
+
+    pthread_mutex_lock(&table->lock);
+
+    entry = user_cache_find(table, id);
+    if (!entry) {
+        entry = malloc(sizeof(linx_user_cache_entry_t));
+        if (entry) {
+            bucket = user_cache_bucket(table, id);
+            out->next = *bucket;
+            *bucket = entry;
+        }
+    } else {
+        out->next = entry->next;
+    }
+
+    if (entry) {
+        memcpy(entry, out, sizeof(linx_user_cache_entry_t));
+    }
+
+    pthread_mutex_unlock(&table->lock);
+
+    return out->found;
+}
+
+static void user_cache_clear(linx_user_cache_table_t *table)
+{
+    linx_user_cache_entry_t *entry, *next;
+
+    pthread_mutex_lock(&table->lock);
+
+    for (int i = 0; i < LINX_USER_CACHE_BUCKETS; i++) {
+        for (entry = table->buckets[i]; entry; entry = next) {
+            next = entry->next;
+            free(entry);
+        }
+
+        table->buckets[i] = NULL;
+    }
+
+    pthread_mutex_unlock(&table->lock);
+}
+
+/**
+ * useradd、vipw 等工具先写临时文件再改名，所以监视 /etc 目录而不是文件本身
+*/
+static void *user_cache_watch_func(void *arg, int *should_stop)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd = { .fd = s_inotify_fd, .events = POLLIN };
+    const struct inotify_event *event;
+    bool changed;
+    ssize_t len;
+
+    (void)arg;
+
+    while (s_running && !*should_stop) {
+        if (poll(&pfd, 1, 1000) <= 0) {
+            continue;
+        }
+
+        len = read(s_inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            continue;
+        }
+
+        changed = false;
+        for (char *pos = buffer; pos < buffer + len; pos += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event *)pos;
+            if (event->len && (strcmp(event->name, "passwd") == 0 || strcmp(event->name, "group") == 0)) {
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            __atomic_add_fetch(&s_generation, 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    return NULL;
+}
+
+int linx_user_cache_init(uint32_t ttl)
+{
+    s_ttl = ttl;
+
+    s_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (s_inotify_fd < 0 ||
+        inotify_add_watch(s_inotify_fd, "/etc", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0)
+    {
+        /* 没有 inotify 时只靠有效期刷新 */
+        LINX_LOG_WARNING("inotify on /etc failed, user cache relies on ttl: %s", strerror(errno));
+        goto clean_inotify;
+    }
+
+    s_thread_pool = linx_thread_pool_create(1);
+    if (!s_thread_pool) {
+        goto clean_inotify;
+    }
+
+    s_running = 1;
+
+    if (linx_thread_pool_add_task(s_thread_pool, user_cache_watch_func, NULL) < 0) {
+        s_running = 0;
+        linx_thread_pool_destroy(s_thread_pool, 0);
+        s_thread_pool = NULL;
+        goto clean_inotify;
+    }
+
+    return 0;
+
+clean_inotify:
+    if (s_inotify_fd >= 0) {
+        close(s_inotify_fd);
+        s_inotify_fd = -1;
+    }
+
+    if (!s_ttl) {
+        s_ttl = LINX_USER_CACHE_TTL;
+    }
+
+    return 0;
+}
+
+void linx_user_cache_deinit(void)
+{
+    if (s_thread_pool) {
+        s_running = 0;
+        linx_thread_pool_destroy(s_thread_pool, 1);
+        s_thread_pool = NULL;
+    }
+
+    if (s_inotify_fd >= 0) {
+        close(s_inotify_fd);
+        s_inotify_fd = -1;
+    }
+
+    user_cache_clear(&s_users);
+    user_cache_clear(&s_groups);
+}
+
+int linx_user_cache_get_user(uid_t uid, user_t *user, time_t *expire)
+{
+    linx_user_cache_entry_t entry;
+    bool found = user_cache_get(&s_users, (uint32_t)uid, &entry);
+
+    *user = entry.user;
+    user->uid = (uint32_t)uid;
+
+    /* 登录用户属于进程，不能由 uid 得到 */
+    user->loginuid = -1;
+    user->loginname[0] = '\0';
+
+    if (expire) {
+        *expire = entry.expire;
+    }
+
+    return found ? 0 : -1;
+}
+
+int linx_user_cache_get_group(gid_t gid, group_t *group, time_t *expire)
+{
+    linx_user_cache_entry_t entry;
+    bool found = user_cache_get(&s_groups, (uint32_t)gid, &entry);
+
+    *group = entry.group;
+    group->gid = (uint32_t)gid;
+
+    if (expire) {
+        *expire = entry.expire;
+    }
+
+    return found ? 0 : -1;
+}
+
+int linx_user_cache_get_name(uid_t uid, char *name, size_t size)
+{
+    linx_user_cache_entry_t entry;
+
+    if (!user_cache_get(&s_users, (uint32_t)uid, &entry)) {
+        return -1;
+    }
+
+    copy_name(name, size, entry.user.name);
+
+    return 0;
+}
+
+uint32_t linx_user_cache_generation(void)
+{
+    return __atomic_load_n(&s_generation, __ATOMIC_ACQUIRE);
+}
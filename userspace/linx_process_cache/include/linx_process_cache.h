@@ -1,18 +1,60 @@
 #ifndef __LINX_PROCESS_CACHE_H__
 #define __LINX_PROCESS_CACHE_H__ 
 
+#include <stdint.h>
 #include <pthread.h>
 
 #include "linx_process_cache_info.h"
 #include "linx_thread_pool.h"
 
+/**
+ * 按 pid 分片，读者不加锁，写者只锁住所在的分片
+*/
 typedef struct {
-    linx_process_info_t *hash_table;
-    pthread_rwlock_t lock;
+    pthread_mutex_t lock;
+    linx_process_info_t *buckets[LINX_PROCESS_CACHE_SHARD_BUCKETS];
+    linx_process_info_t *retired;       /* 已经摘除、等待回收的进程 */
+    uint32_t count;
+    uint32_t retired_count;
+} __attribute__((aligned(64))) linx_process_cache_shard_t;
+
+/**
+ * 内核发送的进程快照，字符串带长度，不要求以 '\0' 结尾
+ * cmdline 和 exe 为 NULL 时保持缓存中原来的值
+*/
+typedef struct {
+    pid_t pid;
+    pid_t ppid;
+    uid_t uid;
+    gid_t gid;
+    const char *comm;
+    size_t comm_len;
+    const char *cmdline;
+    size_t cmdline_len;
+    const char *exe;
+    size_t exe_len;
+} linx_process_snapshot_t;
+
+/**
+ * 进程信息占用的内存，字符串由所有进程共享，按驻留后的实际大小统计
+*/
+typedef struct {
+    uint64_t entries;               /* 包括已经摘除、等待回收的进程 */
+    uint64_t entry_bytes;
+    uint64_t strings;
+    uint64_t string_bytes;
+    uint64_t string_refs;
+    uint64_t bytes_per_process;
+} linx_process_cache_mem_stats_t;
+
+typedef struct {
+    linx_process_cache_shard_t shards[LINX_PROCESS_CACHE_SHARD_NUM];
+
+    pid_t pending[LINX_PROCESS_CACHE_PENDING_SLOTS];   /* 已经提交补齐任务的 pid，0 表示空闲 */
 
     linx_thread_pool_t *thread_pool;
     int running;
-    pthread_t monitor_thread;
+    uint32_t reconcile_interval;        /* 对照 /proc 校正的间隔秒数，0 表示只在启动时扫描一次 */
     pthread_t cleaner_thread;
 } linx_process_cache_t;
 
@@ -20,20 +62,65 @@ int linx_process_cache_init(void);
 
 void linx_process_cache_deinit(void);
 
+/**
+ * 读区间，linx_process_cache_get 返回的指针在 linx_process_cache_read_end 之前有效
+ * 读区间内不会阻塞，可以嵌套
+*/
+void linx_process_cache_read_begin(void);
+
+void linx_process_cache_read_end(void);
+
+/**
+ * 必须在读区间内调用，不会阻塞
+ * 缓存中没有时返回 NULL，并提交一个从 /proc 读取的补齐任务，之后的事件可以命中
+*/
 linx_process_info_t *linx_process_cache_get(pid_t pid);
 
+/**
+ * 复制所有进程，复制出的进程持有字符串的引用，用完后调用 linx_process_cache_release_all 释放
+*/
 int linx_process_cache_get_all(linx_process_info_t **list, int *count);
 
+void linx_process_cache_release_all(linx_process_info_t *list, int count);
+
 int linx_process_cache_update_async(pid_t pid);
 
 int linx_process_cache_update_sync(pid_t pid);
 
 int linx_process_cache_update(linx_process_info_t *info);
 
+int linx_process_cache_exit(pid_t pid);
+
+/**
+ * 以下接口由事件丰富模块根据进程相关的事件调用，增量维护缓存
+*/
+
+/**
+ * 新进程继承父进程的信息，父进程不在缓存中时从 /proc 读取
+*/
+int linx_process_cache_fork(pid_t ppid, pid_t pid);
+
+/**
+ * exec 之后更新进程名和命令行，args 为 '\0' 分隔的参数列表，为 NULL 时和可执行文件路径一样从 /proc 读取
+*/
+int linx_process_cache_exec(pid_t pid, const char *comm, const char *args, size_t args_len);
+
+/**
+ * path 为切换后的目录，为 NULL 或相对路径时从 /proc 读取
+*/
+int linx_process_cache_chdir(pid_t pid, const char *path);
+
+/**
+ * 合并内核发送的进程快照，快照中没有的字段保持缓存中原来的值
+*/
+int linx_process_cache_snapshot(const linx_process_snapshot_t *snapshot);
+
 int linx_process_cache_delete(pid_t pid);
 
 int linx_process_cache_cleanup(void);
 
 void linx_process_cache_stats(int *total, int *alive, int *expired);
 
+void linx_process_cache_mem_stats(linx_process_cache_mem_stats_t *stats);
+
 #endif /* __LINX_PROCESS_CACHE_H__ */
@@ -2,15 +2,37 @@
 #define __LINX_PROCESS_CACHE_DEFINE_H__ 
 
 /**
- * 缓存更新间隔秒数
+ * 默认的校正间隔秒数，缓存由进程事件增量维护，校正只用于补齐遗漏的进程
 */
-#define LINX_PROCESS_CACHE_UPDATE_INTERVAL 1
+#define LINX_PROCESS_CACHE_RECONCILE_INTERVAL 60
 
 /**
  * 缓存过期时间秒数
 */
 #define LINX_PROCESS_CACHE_EXPIRE_TIME 20
 
+/**
+ * 分片数和每个分片的桶数，必须是2的幂
+*/
+#define LINX_PROCESS_CACHE_SHARD_NUM 64
+#define LINX_PROCESS_CACHE_SHARD_BUCKETS 1024
+
+/**
+ * 分片中等待回收的进程达到该数量时尝试回收
+*/
+#define LINX_PROCESS_CACHE_RECLAIM_THRESHOLD 64
+
+/**
+ * 每个进程保存的祖先层数，包括进程自己，proc.aname[N] 的 N 小于该值
+*/
+#define LINX_PROCESS_ANCESTOR_NUM 8
+
+/**
+ * 等待补齐的进程槽位数，必须是2的幂
+ * 读者没有命中时按 pid 占用一个槽位，同一 pid 同时只有一个补齐任务
+*/
+#define LINX_PROCESS_CACHE_PENDING_SLOTS 1024
+
 /**
  * 缓存线程数
 */
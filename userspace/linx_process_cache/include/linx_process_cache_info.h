@@ -2,10 +2,10 @@
 #define __LINX_PROCESS_CACHE_INFO_H__ 
 
 #include <sys/types.h>
+#include <time.h>
+#include <stdint.h>
 #include <stdbool.h>
 
-#include "uthash.h"
-
 #include "linx_process_cache_define.h"
 #include "linx_process_state.h"
 
@@ -22,7 +22,7 @@
  * pcmdline 
  * tty  进程的控制终端。对于没有终端的进程，该值为0
 */
-typedef struct {
+typedef struct linx_process_info {
     pid_t pid;                          /* 进程ID */
     pid_t ppid;                         /* 父进程ID */
     pid_t pgid;                         /* 进程组ID */
@@ -30,15 +30,12 @@ typedef struct {
     pid_t uid;                          /* 用户ID */
     pid_t gid;                          /* 组ID */
 
-    char name[PROC_COMM_MAX_LEN];       /* 进程名 */
-    char comm[PROC_COMM_MAX_LEN];       
-    char cmdline[PROC_CMDLINE_LEN];     /* 命令行 */
-    char exe[PROC_PATH_MAX_LEN];        /* 进程执行文件路径 */
-    char cwd[PROC_PATH_MAX_LEN];        /* 当前工作目录 */
-
     linx_process_state_t state;
     int nice;                           /* nice 值 */
     int priority;                       /* 优先级 */
+    bool is_alive;                      /* 进程是否存活 */
+    bool is_rich;                       /* 标识为事件丰富创建的缓存 */
+
     unsigned long vsize;                /* 虚拟内存大小 */
     unsigned long rss;                  /* 驻留内存大小 */
     unsigned long shared;               /* 共享内存大小 */
@@ -50,10 +47,30 @@ typedef struct {
     time_t create_time;                 /* 缓存创建时间 */
     time_t update_time;                 /* 最后更新时间 */
     time_t exit_time;                   /* 进程退出时间 */
-    bool is_alive;                      /* 进程是否存活 */
 
-    bool is_rich;                       /* 标识为事件丰富创建的缓存 */
-    UT_hash_handle hh;
+    /**
+     * 字符串由 linx_process_str 驻留，相同的内容在进程之间共享，不会为 NULL
+     * 每个进程持有各个字符串的一个引用，进程释放时减少
+    */
+    const char *name;                   /* 进程名 */
+    const char *comm;
+    const char *cmdline;                /* 命令行 */
+    const char *exe;                    /* 进程执行文件路径 */
+    const char *cwd;                    /* 当前工作目录 */
+
+    /**
+     * 祖先在进程加入缓存、fork 和 exec 时从父进程继承，匹配时不再按 ppid 逐级查找
+     * aname[0] 为进程自己的名称，aname[1] 为父进程的名称，依次类推，没有的祖先为空字符串
+    */
+    const char *pcmdline;               /* 父进程命令行 */
+    const char *aname[LINX_PROCESS_ANCESTOR_NUM];
+
+    /**
+     * 缓存中的进程只读，修改时复制一份替换，被替换的进程等读者离开之后再释放
+    */
+    struct linx_process_info *next;     /* 同一个桶中的下一个进程，读者无锁遍历 */
+    struct linx_process_info *retired_next;
+    uint64_t retired_epoch;             /* 从桶中摘除时的 epoch */
 } linx_process_info_t;
 
 #endif /* __LINX_PROCESS_CACHE_INFO_H__ */
@@ -0,0 +1,31 @@
+#ifndef __LINX_PROCESS_STR_H__
+#define __LINX_PROCESS_STR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 进程缓存中的字符串，相同内容只保存一份，按引用计数释放
+ * 返回的指针指向以 '\0' 结尾的内容，之前紧跟 uint32_t 长度，
+ * 可以直接作为 LINX_FIELD_TYPE_CHARBUF_REF 字段的值
+ *
+ * 空字符串是静态的，不计引用，分配失败时也返回空字符串，结果不会为 NULL
+*/
+const char *linx_process_str_intern(const char *str, size_t len);
+
+/**
+ * 增加引用，调用者必须已经持有 str 的一个引用
+*/
+const char *linx_process_str_ref(const char *str);
+
+/**
+ * 减少引用，最后一个引用释放时删除，str 为 NULL 时不做任何操作
+*/
+void linx_process_str_unref(const char *str);
+
+/**
+ * 驻留的字符串个数、占用的字节数和被引用的总次数
+*/
+void linx_process_str_stats(uint64_t *count, uint64_t *bytes, uint64_t *refs);
+
+#endif /* __LINX_PROCESS_STR_H__ */
@@ -9,13 +9,20 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <time.h>
-#include <signal.h>
+#include <pthread.h>
 
 #include "linx_process_cache.h"
+#include "linx_process_str.h"
 #include "linx_hash_map.h"
+#include "linx_config.h"
+#include "linx_log.h"
 
 static linx_process_cache_t *g_process_cache = NULL;
 
+static uint64_t s_info_count = 0;      /* 分配的进程结构体个数，包括等待回收的 */
+
+static void update_process_lineage(linx_process_info_t *info);
+
 static int linx_process_cache_bind_field(void)
 {
     BEGIN_FIELD_MAPPINGS(proc)
@@ -25,17 +32,25 @@ static int linx_process_cache_bind_field(void)
         FIELD_MAP(linx_process_info_t, sid, LINX_FIELD_TYPE_INT32)
         FIELD_MAP(linx_process_info_t, uid, LINX_FIELD_TYPE_INT32)
         FIELD_MAP(linx_process_info_t, gid, LINX_FIELD_TYPE_INT32)
-        FIELD_MAP(linx_process_info_t, name, LINX_FIELD_TYPE_CHARBUF)
-        FIELD_MAP(linx_process_info_t, comm, LINX_FIELD_TYPE_CHARBUF)
-        FIELD_MAP(linx_process_info_t, cmdline, LINX_FIELD_TYPE_CHARBUF)
-        FIELD_MAP(linx_process_info_t, exe, LINX_FIELD_TYPE_CHARBUF)
-        FIELD_MAP(linx_process_info_t, cwd, LINX_FIELD_TYPE_CHARBUF)
+        FIELD_MAP(linx_process_info_t, name, LINX_FIELD_TYPE_CHARBUF_REF)
+        FIELD_MAP(linx_process_info_t, comm, LINX_FIELD_TYPE_CHARBUF_REF)
+        FIELD_MAP(linx_process_info_t, cmdline, LINX_FIELD_TYPE_CHARBUF_REF)
+        FIELD_MAP(linx_process_info_t, exe, LINX_FIELD_TYPE_CHARBUF_REF)
+        FIELD_MAP(linx_process_info_t, cwd, LINX_FIELD_TYPE_CHARBUF_REF)
+        FIELD_MAP(linx_process_info_t, pcmdline, LINX_FIELD_TYPE_CHARBUF_REF)
+        FIELD_MAP(linx_process_info_t, aname, LINX_FIELD_TYPE_CHARBUF_REF)
     END_FIELD_MAPPINGS(proc)
 
-    return linx_hash_map_add_field_batch("proc", proc_mappings, proc_mappings_count);
+    if (linx_hash_map_add_field_batch("proc", proc_mappings, proc_mappings_count)) {
+        return -1;
+    }
+
+    /* proc.pname 即 proc.aname[1] */
+    return linx_hash_map_add_field("proc", "pname", offsetof(linx_process_info_t, aname[1]),
+                                   sizeof(const char *), LINX_FIELD_TYPE_CHARBUF_REF);
 }
 
-static int read_proc_stat(pid_t pid, linx_process_info_t *info)
+static int read_proc_stat(pid_t pid, linx_process_info_t *info, char *comm)
 {
     char path[PROC_PATH_MAX_LEN];
     char buffer[4096];
@@ -68,10 +83,8 @@ static int read_proc_stat(pid_t pid, linx_process_info_t *info)
         name_len = PROC_COMM_MAX_LEN - 1;
     }
 
-    strncpy(info->comm, start + 1, name_len);
-    info->comm[name_len] = '\0';
-
-    strncpy(info->name, info->comm, name_len + 1);
+    memcpy(comm, start + 1, name_len);
+    comm[name_len] = '\0';
 
     ret = sscanf(end + 2, " %c %d %d %d %*d %*d %*u %*u %*u %*u %*u %lu %lu "
                  "%*d %*d %d %d %*d %*d %lu %lu %ld",
@@ -142,7 +155,7 @@ static int read_proc_status(pid_t pid, linx_process_info_t *info)
     return 0;
 }
 
-static int read_proc_cmdline(pid_t pid, linx_process_info_t *info)
+static int read_proc_cmdline(pid_t pid, char *cmdline)
 {
     char path[PROC_PATH_MAX_LEN];
     int fd;
@@ -154,63 +167,156 @@ static int read_proc_cmdline(pid_t pid, linx_process_info_t *info)
         return -1;
     }
     
-    len = read(fd, info->cmdline, PROC_CMDLINE_LEN - 1);
+    len = read(fd, cmdline, PROC_CMDLINE_LEN - 1);
     if (len > 0) {
-        info->cmdline[len] = '\0';
+        cmdline[len] = '\0';
         /* 将NULL字符替换为空格 */
         for (ssize_t i = 0; i < len - 1; i++) {
-            if (info->cmdline[i] == '\0') {
-                info->cmdline[i] = ' ';
+            if (cmdline[i] == '\0') {
+                cmdline[i] = ' ';
             }
         }
     } else {
-        info->cmdline[0] = '\0';
+        cmdline[0] = '\0';
     }
     
     close(fd);
     return 0;
 }
 
-static int read_proc_exe(pid_t pid, linx_process_info_t *info)
+static int read_proc_link(pid_t pid, const char *name, char *buffer, size_t size)
 {
     char path[PROC_PATH_MAX_LEN];
     ssize_t len;
-    
-    snprintf(path, sizeof(path), "/proc/%d/exe", pid);
-    len = readlink(path, info->exe, PROC_PATH_MAX_LEN - 1);
-    if (len > 0) {
-        info->exe[len] = '\0';
-    } else {
-        info->exe[0] = '\0';
+
+    snprintf(path, sizeof(path), "/proc/%d/%s", pid, name);
+    len = readlink(path, buffer, size - 1);
+    if (len <= 0) {
+        buffer[0] = '\0';
+        return -1;
     }
-    
+
+    buffer[len] = '\0';
+
     return 0;
 }
 
-static int read_proc_cwd(pid_t pid, linx_process_info_t *info)
+static linx_process_info_t *alloc_process_info(void)
 {
-    char path[PROC_PATH_MAX_LEN];
-    ssize_t len;
-    
-    snprintf(path, sizeof(path), "/proc/%d/cwd", pid);
-    len = readlink(path, info->cwd, PROC_PATH_MAX_LEN - 1);
-    if (len > 0) {
-        info->cwd[len] = '\0';
-    } else {
-        info->cwd[0] = '\0';
+    linx_process_info_t *info = calloc(1, sizeof(linx_process_info_t));
+    if (info) {
+        __atomic_add_fetch(&s_info_count, 1, __ATOMIC_RELAXED);
+    }
+
+    return info;
+}
+
+static void ref_process_str(linx_process_info_t *info)
+{
+    linx_process_str_ref(info->name);
+    linx_process_str_ref(info->comm);
+    linx_process_str_ref(info->cmdline);
+    linx_process_str_ref(info->exe);
+    linx_process_str_ref(info->cwd);
+    linx_process_str_ref(info->pcmdline);
+
+    for (int i = 0; i < LINX_PROCESS_ANCESTOR_NUM; i++) {
+        linx_process_str_ref(info->aname[i]);
     }
-    
-    return 0;
 }
 
-static int is_process_alive(pid_t pid)
+static void unref_process_str(linx_process_info_t *info)
 {
-    return (kill(pid, 0) == 0 || errno == EPERM);
+    linx_process_str_unref(info->name);
+    linx_process_str_unref(info->comm);
+    linx_process_str_unref(info->cmdline);
+    linx_process_str_unref(info->exe);
+    linx_process_str_unref(info->cwd);
+    linx_process_str_unref(info->pcmdline);
+
+    for (int i = 0; i < LINX_PROCESS_ANCESTOR_NUM; i++) {
+        linx_process_str_unref(info->aname[i]);
+    }
+}
+
+static void free_process_info(linx_process_info_t *info)
+{
+    if (!info) {
+        return;
+    }
+
+    unref_process_str(info);
+
+    __atomic_sub_fetch(&s_info_count, 1, __ATOMIC_RELAXED);
+    free(info);
+}
+
+/**
+ * 替换进程中的一个字符串，只用于还没有发布到缓存中的进程
+ * str 已经驻留，这里增加一个引用
+*/
+static void replace_process_str(const char **field, const char *str)
+{
+    const char *old = *field;
+
+    *field = linx_process_str_ref(str);
+    linx_process_str_unref(old);
+}
+
+/**
+ * 驻留以 '\0' 结尾的 str 并替换
+*/
+static void set_process_str(const char **field, const char *str)
+{
+    const char *old = *field;
+
+    *field = linx_process_str_intern(str, strlen(str));
+    linx_process_str_unref(old);
+}
+
+/**
+ * 把还没有设置的字符串设为空字符串，加入缓存的进程中字符串都不为 NULL
+*/
+static void fill_process_str(linx_process_info_t *info)
+{
+    const char **fields[] = { &info->name, &info->comm, &info->cmdline, &info->exe, &info->cwd, &info->pcmdline };
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (!*fields[i]) {
+            *fields[i] = linx_process_str_intern(NULL, 0);
+        }
+    }
+
+    for (int i = 0; i < LINX_PROCESS_ANCESTOR_NUM; i++) {
+        if (!info->aname[i]) {
+            info->aname[i] = linx_process_str_intern(NULL, 0);
+        }
+    }
+}
+
+/**
+ * 从 parent 继承祖先，parent 为 NULL 时没有祖先，info 还没有发布
+ * 祖先只在这里确定，之后祖先 exec 不会更新已经存在的子孙进程
+*/
+static void inherit_process_lineage(linx_process_info_t *info, const linx_process_info_t *parent)
+{
+    const char *empty = linx_process_str_intern(NULL, 0);
+
+    replace_process_str(&info->aname[0], info->comm ? info->comm : empty);
+
+    for (int i = 1; i < LINX_PROCESS_ANCESTOR_NUM; i++) {
+        replace_process_str(&info->aname[i], parent ? parent->aname[i - 1] : empty);
+    }
+
+    replace_process_str(&info->pcmdline, parent ? parent->cmdline : empty);
 }
 
 static linx_process_info_t *create_process_info(pid_t pid)
 {
-    linx_process_info_t *info = calloc(1, sizeof(linx_process_info_t));
+    char comm[PROC_COMM_MAX_LEN];
+    char cmdline[PROC_CMDLINE_LEN] = "";
+    char path[PROC_PATH_MAX_LEN];
+    linx_process_info_t *info = alloc_process_info();
     if (!info) {
         return NULL;
     }
@@ -222,31 +328,364 @@ static linx_process_info_t *create_process_info(pid_t pid)
     info->is_rich = false;
     
     /* 读取进程信息 */
-    if (read_proc_stat(pid, info) < 0 ||
+    if (read_proc_stat(pid, info, comm) < 0 ||
         read_proc_status(pid, info) < 0) {
-        free(info);
+        free_process_info(info);
         return NULL;
     }
 
+    set_process_str(&info->comm, comm);
+    info->name = linx_process_str_ref(info->comm);
+
     /* 尝试读取其他信息，失败不影响创建 */
-    read_proc_cmdline(pid, info);
-    read_proc_exe(pid, info);
-    read_proc_cwd(pid, info);
-    
+    read_proc_cmdline(pid, cmdline);
+    set_process_str(&info->cmdline, cmdline);
+
+    read_proc_link(pid, "exe", path, sizeof(path));
+    set_process_str(&info->exe, path);
+
+    read_proc_link(pid, "cwd", path, sizeof(path));
+    set_process_str(&info->cwd, path);
+
+    update_process_lineage(info);
+
     return info;
 }
 
-static void free_process_info(linx_process_info_t *info)
+/**
+ * 把 '\0' 分隔的参数列表转换为以空格分隔的命令行
+*/
+static void copy_cmdline(char *cmdline, const char *args, size_t len)
 {
-    if (info) {
-        free(info);
+    if (len >= PROC_CMDLINE_LEN) {
+        len = PROC_CMDLINE_LEN - 1;
+    }
+
+    memcpy(cmdline, args, len);
+
+    while (len > 0 && args[len - 1] == '\0') {
+        len--;
+    }
+
+    cmdline[len] = '\0';
+
+    for (size_t i = 0; i < len; i++) {
+        if (cmdline[i] == '\0') {
+            cmdline[i] = ' ';
+        }
+    }
+}
+/**
+ * 读者登记，每个读线程一个，线程退出后可以被新的线程复用
+ * 按缓存行对齐，避免多个读线程更新 epoch 时互相影响
+*/
+typedef struct linx_process_cache_reader {
+    uint64_t epoch;                 /* 进入读区间时的全局 epoch，0 表示不在读区间中 */
+    uint32_t depth;                 /* 读区间的嵌套层数，只有所属线程访问 */
+    bool in_use;
+    struct linx_process_cache_reader *next;
+} __attribute__((aligned(64))) linx_process_cache_reader_t;
+
+static uint64_t s_epoch = 1;
+static linx_process_cache_reader_t *s_readers = NULL;      /* 只增加不删除 */
+static pthread_mutex_t s_reader_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t s_reader_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t s_reader_key;
+static __thread linx_process_cache_reader_t *s_reader = NULL;
+
+static void process_cache_reader_release(void *arg)
+{
+    linx_process_cache_reader_t *reader = (linx_process_cache_reader_t *)arg;
+
+    reader->depth = 0;
+    __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&s_reader_lock);
+    reader->in_use = false;
+    pthread_mutex_unlock(&s_reader_lock);
+}
+
+static void process_cache_reader_key_create(void)
+{
+    pthread_key_create(&s_reader_key, process_cache_reader_release);
+}
+
+static linx_process_cache_reader_t *process_cache_reader_register(void)
+{
+    linx_process_cache_reader_t *reader;
+
+    pthread_once(&s_reader_key_once, process_cache_reader_key_create);
+
+    pthread_mutex_lock(&s_reader_lock);
+
+    for (reader = s_readers; reader; reader = reader->next) {
+        if (!reader->in_use) {
+            break;
+        }
+    }
+
+    if (!reader) {
+        reader = aligned_alloc(64, sizeof(linx_process_cache_reader_t));
+        if (reader) {
+            memset(reader, 0, sizeof(linx_process_cache_reader_t));
+            reader->next = s_readers;
+            __atomic_store_n(&s_readers, reader, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (reader) {
+        reader->in_use = true;
+    }
+
+    pthread_mutex_unlock(&s_reader_lock);
+
+    if (reader) {
+        pthread_setspecific(s_reader_key, reader);
+        s_reader = reader;
+    }
+
+    return reader;
+}
+
+/**
+ * 推进全局 epoch，返回可以释放的界限，摘除时的 epoch 小于该值的进程已经没有读者引用
+ * 读者进入读区间时先记录 epoch 再访问缓存，记录之后摘除的进程 epoch 不会小于它
+*/
+static uint64_t process_cache_safe_epoch(void)
+{
+    linx_process_cache_reader_t *reader;
+    uint64_t safe, epoch;
+
+    safe = __atomic_add_fetch(&s_epoch, 1, __ATOMIC_SEQ_CST);
+
+    for (reader = __atomic_load_n(&s_readers, __ATOMIC_ACQUIRE); reader; reader = reader->next) {
+        epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+        if (epoch && epoch < safe) {
+            safe = epoch;
+        }
+    }
+
+    return safe;
+}
+
+void linx_process_cache_read_begin(void)
+{
+    linx_process_cache_reader_t *reader = s_reader;
+
+    if (!reader) {
+        reader = process_cache_reader_register();
+        if (!reader) {
+            LINX_LOG_ERROR("Failed to register process cache reader");
+            return;
+        }
+    }
+
+    if (reader->depth++ == 0) {
+        __atomic_store_n(&reader->epoch, __atomic_load_n(&s_epoch, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+    }
+}
+
+void linx_process_cache_read_end(void)
+{
+    linx_process_cache_reader_t *reader = s_reader;
+
+    if (reader && reader->depth && --reader->depth == 0) {
+        __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+static inline linx_process_cache_shard_t *process_shard(pid_t pid)
+{
+    return &g_process_cache->shards[(uint32_t)pid & (LINX_PROCESS_CACHE_SHARD_NUM - 1)];
+}
+
+static inline linx_process_info_t **process_bucket(linx_process_cache_shard_t *shard, pid_t pid)
+{
+    uint32_t index = ((uint32_t)pid / LINX_PROCESS_CACHE_SHARD_NUM) & (LINX_PROCESS_CACHE_SHARD_BUCKETS - 1);
+
+    return &shard->buckets[index];
+}
+
+/**
+ * 无锁查找，只能在读区间内使用
+*/
+static linx_process_info_t *process_cache_lookup(pid_t pid)
+{
+    linx_process_info_t *info;
+
+    info = __atomic_load_n(process_bucket(process_shard(pid), pid), __ATOMIC_ACQUIRE);
+    while (info && info->pid != pid) {
+        info = __atomic_load_n(&info->next, __ATOMIC_ACQUIRE);
+    }
+
+    return info;
+}
+
+/**
+ * 在缓存中查找父进程并继承祖先，父进程不在缓存中时没有祖先
+ * 父进程在读区间内不会被释放，可以直接引用它的字符串
+*/
+static void update_process_lineage(linx_process_info_t *info)
+{
+    linx_process_info_t *parent = NULL;
+
+    linx_process_cache_read_begin();
+
+    if (info->ppid > 0 && info->ppid != info->pid) {
+        parent = process_cache_lookup(info->ppid);
+    }
+
+    inherit_process_lineage(info, parent);
+
+    linx_process_cache_read_end();
+}
+
+/**
+ * 返回指向 pid 所在节点的链接，不存在时返回链表末尾的空链接，调用时需要持有分片的锁
+*/
+static linx_process_info_t **shard_find_link(linx_process_cache_shard_t *shard, pid_t pid)
+{
+    linx_process_info_t **link = process_bucket(shard, pid);
+
+    while (*link && (*link)->pid != pid) {
+        link = &(*link)->next;
     }
+
+    return link;
+}
+
+/**
+ * 释放摘除时的 epoch 小于 safe 的进程，调用时需要持有分片的锁
+*/
+static void shard_reclaim(linx_process_cache_shard_t *shard, uint64_t safe)
+{
+    linx_process_info_t **link = &shard->retired, *info;
+
+    while ((info = *link) != NULL) {
+        if (info->retired_epoch < safe) {
+            *link = info->retired_next;
+            shard->retired_count--;
+            free_process_info(info);
+        } else {
+            link = &info->retired_next;
+        }
+    }
+}
+
+/**
+ * 摘除的进程可能仍被读者引用，next 保持不变，让正在遍历的读者可以继续
+*/
+static void shard_retire(linx_process_cache_shard_t *shard, linx_process_info_t *info)
+{
+    info->retired_epoch = __atomic_load_n(&s_epoch, __ATOMIC_SEQ_CST);
+    info->retired_next = shard->retired;
+    shard->retired = info;
+
+    if (++shard->retired_count >= LINX_PROCESS_CACHE_RECLAIM_THRESHOLD) {
+        shard_reclaim(shard, process_cache_safe_epoch());
+    }
+}
+
+/**
+ * 用 info 替换 link 处的进程，link 为空链接时插入，调用时需要持有分片的锁
+*/
+static void shard_publish(linx_process_cache_shard_t *shard, linx_process_info_t **link,
+                          linx_process_info_t *info)
+{
+    linx_process_info_t *old_info = *link;
+
+    info->next = old_info ? old_info->next : NULL;
+    __atomic_store_n(link, info, __ATOMIC_RELEASE);
+
+    if (old_info) {
+        shard_retire(shard, old_info);
+    } else {
+        shard->count++;
+    }
+}
+
+static void shard_remove(linx_process_cache_shard_t *shard, linx_process_info_t **link)
+{
+    linx_process_info_t *old_info = *link;
+
+    __atomic_store_n(link, old_info->next, __ATOMIC_RELEASE);
+    shard->count--;
+    shard_retire(shard, old_info);
+}
+
+/**
+ * 复制缓存中的进程用于修改，修改后通过 shard_publish 替换
+*/
+static linx_process_info_t *copy_process_info(const linx_process_info_t *info)
+{
+    linx_process_info_t *copy = alloc_process_info();
+    if (!copy) {
+        return NULL;
+    }
+
+    memcpy(copy, info, sizeof(linx_process_info_t));
+    copy->next = NULL;
+    copy->retired_next = NULL;
+    ref_process_str(copy);
+
+    return copy;
+}
+
+/**
+ * 缓存中没有该进程，或者只有同一 pid 已经退出的旧进程时插入 info 并返回 info
+ * 否则释放 info，返回缓存中的进程
+*/
+static linx_process_info_t *insert_process_info(linx_process_info_t *info)
+{
+    linx_process_cache_shard_t *shard = process_shard(info->pid);
+    linx_process_info_t **link;
+
+    pthread_mutex_lock(&shard->lock);
+
+    link = shard_find_link(shard, info->pid);
+    if (*link && (*link)->is_alive) {
+        free_process_info(info);
+        info = *link;
+    } else {
+        shard_publish(shard, link, info);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return info;
+}
+
+/**
+ * 用 info 替换缓存中的进程，保留缓存创建时间和退出状态
+*/
+static void replace_process_info(linx_process_info_t *info)
+{
+    linx_process_cache_shard_t *shard = process_shard(info->pid);
+    linx_process_info_t **link, *old_info;
+
+    pthread_mutex_lock(&shard->lock);
+
+    link = shard_find_link(shard, info->pid);
+    old_info = *link;
+    if (old_info) {
+        info->create_time = old_info->create_time;
+
+        if (!old_info->is_alive && old_info->exit_time > 0) {
+            info->exit_time = old_info->exit_time;
+            info->is_alive = false;
+        }
+    }
+
+    shard_publish(shard, link, info);
+
+    pthread_mutex_unlock(&shard->lock);
 }
 
 static void *update_process_task(void *arg, int *should_stop)
 {
     pid_t pid = *(pid_t *)arg;
-    linx_process_info_t *info, *old_info;
+    linx_process_info_t *info;
 
     free(arg);
 
@@ -259,113 +698,291 @@ static void *update_process_task(void *arg, int *should_stop)
         return NULL;
     }
 
-    pthread_rwlock_wrlock(&g_process_cache->lock);
+    replace_process_info(info);
 
-    HASH_FIND_INT(g_process_cache->hash_table, &pid, old_info);
-    if (old_info) {
-        info->create_time = old_info->create_time;
+    return NULL;
+}
 
-        if (!old_info->is_alive && old_info->exit_time > 0) {
-            info->exit_time = old_info->exit_time;
-            info->is_alive = false;
+/**
+ * 读者没有命中时提交的任务，缓存中已经有该进程时保留缓存中的进程
+*/
+static void *fill_process_task(void *arg, int *should_stop)
+{
+    pid_t pid = (pid_t)(intptr_t)arg;
+    pid_t *slot = &g_process_cache->pending[pid & (LINX_PROCESS_CACHE_PENDING_SLOTS - 1)];
+    linx_process_info_t *info;
+
+    if (!*should_stop) {
+        info = create_process_info(pid);
+        if (info) {
+            insert_process_info(info);
         }
+    }
+
+    __atomic_store_n(slot, 0, __ATOMIC_RELEASE);
 
-        HASH_DEL(g_process_cache->hash_table, old_info);
-        free_process_info(old_info);
+    return NULL;
+}
+
+/**
+ * 槽位已经被占用时不提交，之后的事件、进程快照或者校正会补齐该进程
+*/
+static void process_cache_fill_async(pid_t pid)
+{
+    pid_t *slot = &g_process_cache->pending[pid & (LINX_PROCESS_CACHE_PENDING_SLOTS - 1)];
+    pid_t expected = 0;
+
+    if (!__atomic_compare_exchange_n(slot, &expected, pid, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
     }
 
-    HASH_ADD_INT(g_process_cache->hash_table, pid, info);
+    if (linx_thread_pool_add_task(g_process_cache->thread_pool, fill_process_task, (void *)(intptr_t)pid) < 0) {
+        __atomic_store_n(slot, 0, __ATOMIC_RELEASE);
+    }
+}
 
-    pthread_rwlock_unlock(&g_process_cache->lock);
+static bool process_cache_contains(pid_t pid)
+{
+    linx_process_cache_shard_t *shard = process_shard(pid);
+    bool found;
 
-    return NULL;
+    pthread_mutex_lock(&shard->lock);
+    found = (*shard_find_link(shard, pid) != NULL);
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
 }
 
-static void *monitor_thread_func(void *arg, int *should_stop)
+static void mark_process_exited(linx_process_info_t *info, time_t now)
+{
+    info->is_alive = false;
+    info->exit_time = now;
+    info->state = LINX_PROCESS_STATE_EXITED;
+}
+
+static int compare_pid(const void *a, const void *b)
+{
+    pid_t x = *(const pid_t *)a, y = *(const pid_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * 对照 /proc 校正缓存，只读取缓存中没有的进程，已有的进程由事件维护
+ * mark_exited 时把 /proc 中已经不存在的进程标记为退出
+*/
+static void reconcile_process_cache(bool mark_exited)
 {
-    (void)arg;
     DIR *proc_dir;
     struct dirent *entry;
-    pid_t pid, *pid_arg;
-    linx_process_info_t *info, *tmp;
+    pid_t pid, *pids = NULL, *new_pids;
+    size_t count = 0, capacity = 0;
+    bool complete = true;
+    time_t start = time(NULL);
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t **link, *info;
+
+    proc_dir = opendir("/proc");
+    if (proc_dir == NULL) {
+        return;
+    }
 
-    while (g_process_cache->running && !*should_stop) {
-        proc_dir = opendir("/proc");
-        if (proc_dir == NULL) {
-            sleep(LINX_PROCESS_CACHE_UPDATE_INTERVAL);
+    while ((entry = readdir(proc_dir)) != NULL) {
+        if (!isdigit(entry->d_name[0])) {
             continue;
         }
 
-        while ((entry = readdir(proc_dir)) != NULL) {
-            if (!isdigit(entry->d_name[0])) {
-                continue;
-            }
+        pid = atoi(entry->d_name);
+        if (pid <= 0) {
+            continue;
+        }
 
-            pid = atoi(entry->d_name);
-            if (pid <= 0) {
-                continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            new_pids = realloc(pids, capacity * sizeof(pid_t));
+            if (!new_pids) {
+                complete = false;
+                break;
             }
+            pids = new_pids;
+        }
+
+        pids[count++] = pid;
+    }
+
+    closedir(proc_dir);
+
+    /* 按 pid 从小到大加入，父进程通常先于子进程加入，子进程可以继承祖先 */
+    qsort(pids, count, sizeof(pid_t), compare_pid);
+
+    for (size_t i = 0; i < count && g_process_cache->running; i++) {
+        if (process_cache_contains(pids[i])) {
+            continue;
+        }
+
+        info = create_process_info(pids[i]);
+        if (info) {
+            insert_process_info(info);
+        }
+    }
 
-            pid_arg = malloc(sizeof(pid_t));
-            if (pid_arg) {
-                *pid_arg = pid;
-                linx_thread_pool_add_task(g_process_cache->thread_pool, update_process_task, pid_arg);
+    /* 扫描开始之后由事件加入的进程不在 pids 中，不能标记 */
+    if (mark_exited && complete) {
+        for (int i = 0; i < LINX_PROCESS_CACHE_SHARD_NUM; i++) {
+            shard = &g_process_cache->shards[i];
+
+            pthread_mutex_lock(&shard->lock);
+
+            for (int j = 0; j < LINX_PROCESS_CACHE_SHARD_BUCKETS; j++) {
+                for (link = &shard->buckets[j]; *link; link = &(*link)->next) {
+                    if (!(*link)->is_alive || (*link)->create_time >= start ||
+                        bsearch(&(*link)->pid, pids, count, sizeof(pid_t), compare_pid))
+                    {
+                        continue;
+                    }
+
+                    info = copy_process_info(*link);
+                    if (info) {
+                        mark_process_exited(info, time(NULL));
+                        shard_publish(shard, link, info);
+                    }
+                }
             }
+
+            pthread_mutex_unlock(&shard->lock);
         }
+    }
+
+    free(pids);
+}
+
+/**
+ * 启动时扫描一次 /proc，之后缓存由进程事件增量维护
+ * 配置了校正间隔时定期补齐遗漏的进程，例如被过滤掉而没有事件的进程
+*/
+static void *reconcile_thread_func(void *arg, int *should_stop)
+{
+    (void)arg;
 
-        closedir(proc_dir);
+    reconcile_process_cache(false);
 
-        pthread_rwlock_wrlock(&g_process_cache->lock);
+    if (g_process_cache->reconcile_interval == 0) {
+        return NULL;
+    }
 
-        HASH_ITER(hh, g_process_cache->hash_table, info, tmp) {
-            if (!info->is_rich && info->is_alive && !is_process_alive(info->pid)) {
-                info->is_alive = false;
-                info->exit_time = time(NULL);
-                info->state = LINX_PROCESS_STATE_EXITED;
+    while (g_process_cache->running && !*should_stop) {
+        for (uint32_t i = 0; i < g_process_cache->reconcile_interval; i++) {
+            if (!g_process_cache->running || *should_stop) {
+                return NULL;
             }
+            sleep(1);
         }
 
-        pthread_rwlock_unlock(&g_process_cache->lock);
-
-        sleep(LINX_PROCESS_CACHE_UPDATE_INTERVAL);
+        reconcile_process_cache(true);
     }
 
     return NULL;
 }
 
+/**
+ * 删除已退出且超过保留时间的进程，返回删除的个数
+*/
+static int process_cache_remove_expired(bool include_rich)
+{
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t **link, *info;
+    time_t now = time(NULL);
+    int cleaned = 0;
+
+    for (int i = 0; i < LINX_PROCESS_CACHE_SHARD_NUM; i++) {
+        shard = &g_process_cache->shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+
+        for (int j = 0; j < LINX_PROCESS_CACHE_SHARD_BUCKETS; j++) {
+            link = &shard->buckets[j];
+
+            while ((info = *link) != NULL) {
+                if ((include_rich && info->is_rich &&
+                     (now - info->start_time) > LINX_PROCESS_CACHE_EXPIRE_TIME) ||
+                    (!info->is_alive && info->exit_time > 0 &&
+                     (now - info->exit_time) > LINX_PROCESS_CACHE_EXPIRE_TIME))
+                {
+                    shard_remove(shard, link);
+                    cleaned++;
+                } else {
+                    link = &info->next;
+                }
+            }
+        }
+
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    return cleaned;
+}
+
+/**
+ * 回收所有分片中已经没有读者引用的进程
+*/
+static void process_cache_reclaim(void)
+{
+    linx_process_cache_shard_t *shard;
+    uint64_t safe = process_cache_safe_epoch();
+
+    for (int i = 0; i < LINX_PROCESS_CACHE_SHARD_NUM; i++) {
+        shard = &g_process_cache->shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+        shard_reclaim(shard, safe);
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
 static void *cleaner_thread_func(void *arg, int *should_stop)
 {
     (void)arg;
-    time_t now;
-    linx_process_info_t *info, *tmp;
-    
+
     while (g_process_cache->running && !*should_stop) {
         sleep(LINX_PROCESS_CACHE_EXPIRE_TIME / 2);
-        
-        now = time(NULL);
-        
-        pthread_rwlock_wrlock(&g_process_cache->lock);
-
-        HASH_ITER(hh, g_process_cache->hash_table, info, tmp) {
-            /* 清理已退出且超过保留时间的进程 */
-            if ((info->is_rich && 
-                 (now - info->start_time) > LINX_PROCESS_CACHE_EXPIRE_TIME) ||
-                (!info->is_alive && info->exit_time > 0 &&
-                (now - info->exit_time) > LINX_PROCESS_CACHE_EXPIRE_TIME)) 
-            {
-                HASH_DEL(g_process_cache->hash_table, info);
+
+        process_cache_remove_expired(true);
+        process_cache_reclaim();
+    }
+
+    return NULL;
+}
+
+static void process_cache_free(linx_process_cache_t *cache)
+{
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t *info, *next;
+
+    for (int i = 0; i < LINX_PROCESS_CACHE_SHARD_NUM; i++) {
+        shard = &cache->shards[i];
+
+        for (int j = 0; j < LINX_PROCESS_CACHE_SHARD_BUCKETS; j++) {
+            for (info = shard->buckets[j]; info; info = next) {
+                next = info->next;
                 free_process_info(info);
             }
         }
 
-        pthread_rwlock_unlock(&g_process_cache->lock);
+        for (info = shard->retired; info; info = next) {
+            next = info->retired_next;
+            free_process_info(info);
+        }
+
+        pthread_mutex_destroy(&shard->lock);
     }
-    
-    return NULL;
+
+    free(cache);
 }
 
 int linx_process_cache_init(void)
 {
+    linx_global_config_t *config;
+
     if (g_process_cache) {
         return 0;
     }
@@ -374,50 +991,52 @@ int linx_process_cache_init(void)
         return -1;
     }
 
-    g_process_cache = calloc(1, sizeof(linx_process_cache_t));
+    g_process_cache = aligned_alloc(64, sizeof(linx_process_cache_t));
     if (!g_process_cache) {
         return -1;
     }
 
-    if (pthread_rwlock_init(&g_process_cache->lock, NULL) != 0) {
-        free(g_process_cache);
-        g_process_cache = NULL;
-        return -1;
+    memset(g_process_cache, 0, sizeof(linx_process_cache_t));
+
+    for (int i = 0; i < LINX_PROCESS_CACHE_SHARD_NUM; i++) {
+        pthread_mutex_init(&g_process_cache->shards[i].lock, NULL);
     }
 
     g_process_cache->thread_pool = linx_thread_pool_create(LINX_PROCESS_CACHE_THREAD_NUM);
     if (!g_process_cache->thread_pool) {
-        pthread_rwlock_destroy(&g_process_cache->lock);
-        free(g_process_cache);
-        g_process_cache = NULL;
-        return -1;
+        goto clean_cache;
     }
 
-    g_process_cache->running = 1;
+    config = linx_config_get();
+    g_process_cache->reconcile_interval = config ? config->process_cache.reconcile_interval :
+                                                   LINX_PROCESS_CACHE_RECONCILE_INTERVAL;
 
-    if (linx_thread_pool_add_task(g_process_cache->thread_pool, monitor_thread_func, NULL) < 0) {
-        linx_thread_pool_destroy(g_process_cache->thread_pool, 0);
-        pthread_rwlock_destroy(&g_process_cache->lock);
-        free(g_process_cache);
-        g_process_cache = NULL;
-        return -1;
-    }
+    g_process_cache->running = 1;
 
-    if (linx_thread_pool_add_task(g_process_cache->thread_pool, cleaner_thread_func, NULL) < 0) {
+    if (linx_thread_pool_add_task(g_process_cache->thread_pool, reconcile_thread_func, NULL) < 0 ||
+        linx_thread_pool_add_task(g_process_cache->thread_pool, cleaner_thread_func, NULL) < 0)
+    {
         g_process_cache->running = 0;
         linx_thread_pool_destroy(g_process_cache->thread_pool, 0);
-        pthread_rwlock_destroy(&g_process_cache->lock);
-        free(g_process_cache);
-        g_process_cache = NULL;
-        return -1;
+        goto clean_cache;
     }
 
     return 0;
+
+clean_cache:
+    process_cache_free(g_process_cache);
+    g_process_cache = NULL;
+    return -1;
 }
 
+/**
+ * 调用前所有读者都已经离开读区间
+*/
 void linx_process_cache_deinit(void)
 {
-    linx_process_info_t *info, *tmp;
+    linx_process_cache_mem_stats_t stats;
+    int total, alive, expired;
+
     if (!g_process_cache) {
         return;
     }
@@ -426,73 +1045,99 @@ void linx_process_cache_deinit(void)
 
     linx_thread_pool_destroy(g_process_cache->thread_pool, 1);
 
-    pthread_rwlock_wrlock(&g_process_cache->lock);
+    linx_process_cache_stats(&total, &alive, &expired);
+    linx_process_cache_mem_stats(&stats);
+    LINX_LOG_INFO("process cache: %d processes(%d alive, %d expired), %lu entries(%lu bytes), "
+                  "%lu strings(%lu bytes, %lu refs), %lu bytes per process",
+                  total, alive, expired, stats.entries, stats.entry_bytes,
+                  stats.strings, stats.string_bytes, stats.string_refs, stats.bytes_per_process);
 
-    HASH_ITER(hh, g_process_cache->hash_table, info, tmp) {
-        HASH_DEL(g_process_cache->hash_table, info);
-        free_process_info(info);
-    }
-
-    pthread_rwlock_unlock(&g_process_cache->lock);
-
-    pthread_rwlock_destroy(&g_process_cache->lock);
-
-    free(g_process_cache);
+    process_cache_free(g_process_cache);
     g_process_cache = NULL;
 }
 
 linx_process_info_t *linx_process_cache_get(pid_t pid)
 {
-    linx_process_info_t *info = NULL;
+    linx_process_info_t *info;
 
     if (!g_process_cache) {
         return NULL;
     }
 
-    pthread_rwlock_rdlock(&g_process_cache->lock);
-
-    HASH_FIND_INT(g_process_cache->hash_table, &pid, info);
-    if (!info) {
-        info = create_process_info(pid);
+    info = process_cache_lookup(pid);
+    if (info || pid <= 0) {
+        return info;
     }
 
-    pthread_rwlock_unlock(&g_process_cache->lock);
+    /* 启动扫描和进程事件都没有覆盖到的进程，读取 /proc 会阻塞匹配线程，交给缓存线程补齐 */
+    process_cache_fill_async(pid);
 
-    return info;
+    return NULL;
 }
 
 int linx_process_cache_get_all(linx_process_info_t **list, int *count)
 {
-    linx_process_info_t *info;
-    int i = 0;
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t *info, *new_list;
+    int capacity = 0, i = 0;
 
     if (!g_process_cache || !list || !count) {
         return -1;
     }
 
-    pthread_rwlock_rdlock(&g_process_cache->lock);
+    *list = NULL;
 
-    *count = HASH_COUNT(g_process_cache->hash_table);
-    if (*count == 0) {
+    for (int s = 0; s < LINX_PROCESS_CACHE_SHARD_NUM; s++) {
+        shard = &g_process_cache->shards[s];
+
+        pthread_mutex_lock(&shard->lock);
+
+        /* 各个分片分别加锁，数量在复制的过程中可能变化 */
+        if (i + (int)shard->count > capacity) {
+            capacity = (i + shard->count) * 2;
+            new_list = realloc(*list, capacity * sizeof(linx_process_info_t));
+            if (!new_list) {
+                pthread_mutex_unlock(&shard->lock);
+                free(*list);
+                *list = NULL;
+                return -1;
+            }
+            *list = new_list;
+        }
+
+        for (int j = 0; j < LINX_PROCESS_CACHE_SHARD_BUCKETS; j++) {
+            for (info = shard->buckets[j]; info; info = info->next) {
+                memcpy(&(*list)[i], info, sizeof(linx_process_info_t));
+                (*list)[i].next = NULL;
+                (*list)[i].retired_next = NULL;
+                ref_process_str(&(*list)[i]);
+                i++;
+            }
+        }
+
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    *count = i;
+    if (i == 0) {
+        free(*list);
         *list = NULL;
-        pthread_rwlock_unlock(&g_process_cache->lock);
-        return 0;
     }
 
-    *list = calloc(*count, sizeof(linx_process_info_t));
-    if (!*list) {
-        pthread_rwlock_unlock(&g_process_cache->lock);
-        return -1;
+    return 0;
+}
+
+void linx_process_cache_release_all(linx_process_info_t *list, int count)
+{
+    if (!list) {
+        return;
     }
 
-    for (info = g_process_cache->hash_table; info != NULL; info = info->hh.next) {
-        memcpy(&(*list)[i], info, sizeof(linx_process_info_t));
-        memset(&(*list)[i].hh, 0, sizeof(UT_hash_handle));
-        i++;
+    for (int i = 0; i < count; i++) {
+        unref_process_str(&list[i]);
     }
 
-    pthread_rwlock_unlock(&g_process_cache->lock);
-    return 0;
+    free(list);
 }
 
 int linx_process_cache_update_async(pid_t pid)
@@ -534,119 +1179,381 @@ int linx_process_cache_update_sync(pid_t pid)
 
 int linx_process_cache_update(linx_process_info_t *info)
 {
-    linx_process_info_t *old_info;
-    pid_t pid;
-
-    if (!info) {
+    if (!g_process_cache || !info) {
         return -1;
     }
 
-    pid = info->pid;
+    replace_process_info(info);
 
-    pthread_rwlock_wrlock(&g_process_cache->lock);
+    return 0;
+}
 
-    HASH_FIND_INT(g_process_cache->hash_table, &pid, old_info);
-    if (old_info) {
-        info->create_time = old_info->create_time;
+/**
+ * 标记进程已退出，由清理线程在保留时间后删除
+ * 退出后的一段时间内仍可能有该进程的事件需要丰富
+*/
+int linx_process_cache_exit(pid_t pid)
+{
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t **link, *info;
 
-        if (!old_info->is_alive && old_info->exit_time > 0) {
-            info->exit_time = old_info->exit_time;
-            info->is_alive = false;
+    if (!g_process_cache) {
+        return -1;
+    }
+
+    shard = process_shard(pid);
+
+    pthread_mutex_lock(&shard->lock);
+
+    link = shard_find_link(shard, pid);
+    if (*link && (*link)->is_alive) {
+        info = copy_process_info(*link);
+        if (info) {
+            mark_process_exited(info, time(NULL));
+            shard_publish(shard, link, info);
         }
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return 0;
+}
+
+int linx_process_cache_fork(pid_t ppid, pid_t pid)
+{
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t *info = NULL, *child, *parent;
+    bool exists;
+
+    if (!g_process_cache) {
+        return -1;
+    }
+
+    /* 父进程和子进程的事件可能由不同的线程处理，子进程可能已经通过快照加入 */
+    shard = process_shard(pid);
+    pthread_mutex_lock(&shard->lock);
+    child = *shard_find_link(shard, pid);
+    exists = (child && child->is_alive);
+    pthread_mutex_unlock(&shard->lock);
+
+    if (exists) {
+        return 0;
+    }
+
+    /* 缓存中的进程只读，在读区间内复制父进程不需要加锁 */
+    linx_process_cache_read_begin();
 
-        HASH_DEL(g_process_cache->hash_table, old_info);
-        free_process_info(old_info);
+    parent = process_cache_lookup(ppid);
+    if (parent) {
+        info = copy_process_info(parent);
     }
 
-    HASH_ADD_INT(g_process_cache->hash_table, pid, info);
+    if (info) {
+        info->pid = pid;
+        info->ppid = ppid;
+        info->utime = 0;
+        info->stime = 0;
+        info->create_time = time(NULL);
+        info->update_time = info->create_time;
+        info->exit_time = 0;
+        info->is_alive = true;
+        info->is_rich = false;
+        info->state = LINX_PROCESS_STATE_RUNNING;
+        inherit_process_lineage(info, parent);
+    }
+
+    linx_process_cache_read_end();
+
+    if (!info) {
+        info = create_process_info(pid);
+        if (!info) {
+            return -1;
+        }
+    }
 
-    pthread_rwlock_unlock(&g_process_cache->lock);
+    insert_process_info(info);
 
     return 0;
 }
 
-int linx_process_cache_delete(pid_t pid)
+int linx_process_cache_exec(pid_t pid, const char *comm, const char *args, size_t args_len)
 {
-    linx_process_info_t *info;
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t **link, *info = NULL;
+    const char *comm_str, *cmdline_str, *exe_str;
+    char buffer[PROC_CMDLINE_LEN];
+    bool found;
 
     if (!g_process_cache) {
         return -1;
     }
 
-    pthread_rwlock_wrlock(&g_process_cache->lock);
+    /* 字符串在加锁之前驻留，事件中没有参数列表时从 /proc 读取 */
+    if (args) {
+        copy_cmdline(buffer, args, args_len);
+    } else if (read_proc_cmdline(pid, buffer) < 0) {
+        buffer[0] = '\0';
+    }
+
+    cmdline_str = linx_process_str_intern(buffer, strlen(buffer));
+    comm_str = comm ? linx_process_str_intern(comm, strlen(comm)) : NULL;
+
+    read_proc_link(pid, "exe", buffer, PROC_PATH_MAX_LEN);
+    exe_str = linx_process_str_intern(buffer, strlen(buffer));
+
+    shard = process_shard(pid);
+
+    pthread_mutex_lock(&shard->lock);
+
+    link = shard_find_link(shard, pid);
+    found = (*link != NULL);
+    if (found) {
+        info = copy_process_info(*link);
+    }
 
-    HASH_FIND_INT(g_process_cache->hash_table, &pid, info);
     if (info) {
-        HASH_DEL(g_process_cache->hash_table, info);
-        free_process_info(info);
+        if (comm_str) {
+            replace_process_str(&info->comm, comm_str);
+            replace_process_str(&info->name, comm_str);
+            replace_process_str(&info->aname[0], comm_str);
+        }
+
+        if (cmdline_str[0]) {
+            replace_process_str(&info->cmdline, cmdline_str);
+        }
+
+        if (exe_str[0]) {
+            replace_process_str(&info->exe, exe_str);
+        }
+
+        info->update_time = time(NULL);
+        shard_publish(shard, link, info);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    linx_process_str_unref(comm_str);
+    linx_process_str_unref(cmdline_str);
+    linx_process_str_unref(exe_str);
+
+    if (found) {
+        return info ? 0 : -1;
+    }
+
+    info = create_process_info(pid);
+    if (!info) {
+        return -1;
     }
 
-    pthread_rwlock_unlock(&g_process_cache->lock);
+    insert_process_info(info);
 
     return 0;
 }
 
-int linx_process_cache_cleanup(void)
+int linx_process_cache_chdir(pid_t pid, const char *path)
 {
-    time_t now;
-    linx_process_info_t *info, *tmp;
-    int cleaned = 0;
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t **link, *info = NULL;
+    const char *cwd_str;
+    char cwd[PROC_PATH_MAX_LEN];
 
     if (!g_process_cache) {
         return -1;
     }
 
-    now = time(NULL);
+    if (path && path[0] == '/') {
+        snprintf(cwd, sizeof(cwd), "%s", path);
+    } else if (read_proc_link(pid, "cwd", cwd, sizeof(cwd)) < 0) {
+        return -1;
+    }
 
-    pthread_rwlock_wrlock(&g_process_cache->lock);
+    cwd_str = linx_process_str_intern(cwd, strlen(cwd));
 
-    HASH_ITER(hh, g_process_cache->hash_table, info, tmp) { 
-        if (!info->is_alive && info->exit_time > 0 &&
-            (now - info->exit_time) > LINX_PROCESS_CACHE_EXPIRE_TIME)
-        {
-            HASH_DEL(g_process_cache->hash_table, info);
-            free_process_info(info);
-            cleaned++;
+    shard = process_shard(pid);
+
+    pthread_mutex_lock(&shard->lock);
+
+    link = shard_find_link(shard, pid);
+    if (*link) {
+        info = copy_process_info(*link);
+        if (info) {
+            replace_process_str(&info->cwd, cwd_str);
+            info->update_time = time(NULL);
+            shard_publish(shard, link, info);
         }
     }
 
-    pthread_rwlock_unlock(&g_process_cache->lock);
+    pthread_mutex_unlock(&shard->lock);
 
-    return cleaned;
+    linx_process_str_unref(cwd_str);
+
+    return info ? 0 : -1;
 }
 
-void linx_process_cache_stats(int *total, int *alive, int *expired)
+int linx_process_cache_snapshot(const linx_process_snapshot_t *snapshot)
 {
-    int t = 0, a = 0, e = 0;
-    linx_process_info_t *info;
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t **link, *info = NULL;
+    const char *comm_str, *cmdline_str = NULL, *exe_str = NULL;
+    char buffer[PROC_CMDLINE_LEN];
+    bool merged;
 
-    if (!g_process_cache) {
-        if (total) {
-            *total = 0;
+    if (!g_process_cache || !snapshot) {
+        return -1;
+    }
+
+    comm_str = linx_process_str_intern(snapshot->comm, strnlen(snapshot->comm, snapshot->comm_len));
+
+    /* 没有配置对应的上下文段时快照中没有命令行和路径 */
+    if (snapshot->cmdline) {
+        copy_cmdline(buffer, snapshot->cmdline, snapshot->cmdline_len);
+        cmdline_str = linx_process_str_intern(buffer, strlen(buffer));
+    }
+
+    if (snapshot->exe) {
+        exe_str = linx_process_str_intern(snapshot->exe, strnlen(snapshot->exe, snapshot->exe_len));
+    }
+
+    shard = process_shard(snapshot->pid);
+
+    pthread_mutex_lock(&shard->lock);
+
+    link = shard_find_link(shard, snapshot->pid);
+    merged = (*link && (*link)->is_alive);
+    if (merged) {
+        info = copy_process_info(*link);
+    }
+
+    /* 快照中没有的字段保持缓存中的值 */
+    if (info) {
+        info->uid = snapshot->uid;
+        info->gid = snapshot->gid;
+        info->update_time = time(NULL);
+
+        replace_process_str(&info->comm, comm_str);
+        replace_process_str(&info->name, comm_str);
+        replace_process_str(&info->aname[0], comm_str);
+
+        /* 父进程退出后被收养，重新继承祖先 */
+        if (info->ppid != snapshot->ppid) {
+            info->ppid = snapshot->ppid;
+            update_process_lineage(info);
         }
 
-        if (alive) {
-            *alive = 0;
+        if (cmdline_str && cmdline_str[0]) {
+            replace_process_str(&info->cmdline, cmdline_str);
         }
 
-        if (expired) {
-            *expired = 0;
+        if (exe_str && exe_str[0]) {
+            replace_process_str(&info->exe, exe_str);
         }
-        return;
+
+        shard_publish(shard, link, info);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    if (!merged) {
+        info = alloc_process_info();
+    } else {
+        info = NULL;
     }
 
-    pthread_rwlock_rdlock(&g_process_cache->lock);
+    if (info) {
+        info->pid = snapshot->pid;
+        info->ppid = snapshot->ppid;
+        info->uid = snapshot->uid;
+        info->gid = snapshot->gid;
+        info->create_time = time(NULL);
+        info->update_time = info->create_time;
+        info->is_alive = true;
+        info->state = LINX_PROCESS_STATE_RUNNING;
+
+        replace_process_str(&info->comm, comm_str);
+        replace_process_str(&info->name, comm_str);
+        replace_process_str(&info->cmdline, cmdline_str);
 
-    for (info = g_process_cache->hash_table; info != NULL; info = info->hh.next) {
-        t++;
-        if (info->is_alive) {
-            a++;
+        /* 快照中没有工作目录，新加入的进程从 /proc 读取一次 */
+        if (exe_str && exe_str[0]) {
+            replace_process_str(&info->exe, exe_str);
         } else {
-            e++;
+            read_proc_link(snapshot->pid, "exe", buffer, PROC_PATH_MAX_LEN);
+            set_process_str(&info->exe, buffer);
         }
+
+        read_proc_link(snapshot->pid, "cwd", buffer, PROC_PATH_MAX_LEN);
+        set_process_str(&info->cwd, buffer);
+
+        update_process_lineage(info);
+        fill_process_str(info);
+        insert_process_info(info);
+    }
+
+    linx_process_str_unref(comm_str);
+    linx_process_str_unref(cmdline_str);
+    linx_process_str_unref(exe_str);
+
+    return 0;
+}
+
+int linx_process_cache_delete(pid_t pid)
+{
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t **link;
+
+    if (!g_process_cache) {
+        return -1;
+    }
+
+    shard = process_shard(pid);
+
+    pthread_mutex_lock(&shard->lock);
+
+    link = shard_find_link(shard, pid);
+    if (*link) {
+        shard_remove(shard, link);
     }
 
-    pthread_rwlock_unlock(&g_process_cache->lock);
+    pthread_mutex_unlock(&shard->lock);
+
+    return 0;
+}
+
+int linx_process_cache_cleanup(void)
+{
+    if (!g_process_cache) {
+        return -1;
+    }
+
+    return process_cache_remove_expired(false);
+}
+
+void linx_process_cache_stats(int *total, int *alive, int *expired)
+{
+    int t = 0, a = 0, e = 0;
+    linx_process_cache_shard_t *shard;
+    linx_process_info_t *info;
+
+    if (g_process_cache) {
+        for (int i = 0; i < LINX_PROCESS_CACHE_SHARD_NUM; i++) {
+            shard = &g_process_cache->shards[i];
+
+            pthread_mutex_lock(&shard->lock);
+
+            for (int j = 0; j < LINX_PROCESS_CACHE_SHARD_BUCKETS; j++) {
+                for (info = shard->buckets[j]; info; info = info->next) {
+                    t++;
+                    if (info->is_alive) {
+                        a++;
+                    } else {
+                        e++;
+                    }
+                }
+            }
+
+            pthread_mutex_unlock(&shard->lock);
+        }
+    }
 
     if (total) {
         *total = t;
@@ -660,3 +1567,20 @@ void linx_process_cache_stats(int *total, int *alive, int *expired)
         *expired = e;
     }
 }
+
+void linx_process_cache_mem_stats(linx_process_cache_mem_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    stats->entries = __atomic_load_n(&s_info_count, __ATOMIC_RELAXED);
+    stats->entry_bytes = stats->entries * sizeof(linx_process_info_t);
+    linx_process_str_stats(&stats->strings, &stats->string_bytes, &stats->string_refs);
+
+    if (stats->entries) {
+        stats->bytes_per_process = (stats->entry_bytes + stats->string_bytes) / stats->entries;
+    }
+}
@@ -0,0 +1,191 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "linx_process_str.h"
+
+#define LINX_PROCESS_STR_STRIPE_NUM     64      /* 必须是2的幂 */
+#define LINX_PROCESS_STR_STRIPE_BUCKETS 1024    /* 必须是2的幂 */
+
+/**
+ * len 紧挨着 data，字段读取时从字符串之前取得长度
+*/
+typedef struct linx_process_str {
+    struct linx_process_str *next;
+    uint32_t hash;
+    uint32_t ref;
+    uint32_t len;
+    char data[];
+} linx_process_str_t;
+
+_Static_assert(offsetof(linx_process_str_t, data) == offsetof(linx_process_str_t, len) + sizeof(uint32_t),
+               "len must be stored right before data");
+
+typedef struct {
+    pthread_mutex_t lock;
+    linx_process_str_t *buckets[LINX_PROCESS_STR_STRIPE_BUCKETS];
+} __attribute__((aligned(64))) linx_process_str_stripe_t;
+
+static linx_process_str_stripe_t s_stripes[LINX_PROCESS_STR_STRIPE_NUM] = {
+    [0 ... LINX_PROCESS_STR_STRIPE_NUM - 1] = { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+
+static linx_process_str_t s_empty = { .len = 0, .data = "" };
+
+static uint64_t s_str_count = 0;
+static uint64_t s_str_bytes = 0;
+static uint64_t s_str_refs = 0;
+
+static inline linx_process_str_t *process_str_of(const char *str)
+{
+    return (linx_process_str_t *)(str - offsetof(linx_process_str_t, data));
+}
+
+static inline uint32_t process_str_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static inline linx_process_str_stripe_t *process_str_stripe(uint32_t hash)
+{
+    return &s_stripes[hash & (LINX_PROCESS_STR_STRIPE_NUM - 1)];
+}
+
+static inline linx_process_str_t **process_str_bucket(linx_process_str_stripe_t *stripe, uint32_t hash)
+{
+    return &stripe->buckets[(hash / LINX_PROCESS_STR_STRIPE_NUM) & (LINX_PROCESS_STR_STRIPE_BUCKETS - 1)];
+}
+
+const char *linx_process_str_intern(const char *str, size_t len)
+{
+    linx_process_str_stripe_t *stripe;
+    linx_process_str_t **bucket, *s;
+    uint32_t hash;
+
+    if (!str || len == 0 || len > UINT32_MAX) {
+        return s_empty.data;
+    }
+
+    hash = process_str_hash(str, len);
+    stripe = process_str_stripe(hash);
+    bucket = process_str_bucket(stripe, hash);
+
+    pthread_mutex_lock(&stripe->lock);
+
+    for (s = *bucket; s; s = s->next) {
+        if (s->hash == hash && s->len == len && memcmp(s->data, str, len) == 0) {
+            __atomic_add_fetch(&s->ref, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    if (!s) {
+        s = malloc(sizeof(linx_process_str_t) + len + 1);
+        if (s) {
+            s->hash = hash;
+            s->ref = 1;
+            s->len = (uint32_t)len;
+            memcpy(s->data, str, len);
+            s->data[len] = '\0';
+            s->next = *bucket;
+            *bucket = s;
+
+            __atomic_add_fetch(&s_str_count, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&s_str_bytes, sizeof(linx_process_str_t) + len + 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    if (!s) {
+        return s_empty.data;
+    }
+
+    __atomic_add_fetch(&s_str_refs, 1, __ATOMIC_RELAXED);
+
+    return s->data;
+}
+
+/**
+ * 调用者持有引用，计数不会在这里降到0，不需要加锁
+*/
+const char *linx_process_str_ref(const char *str)
+{
+    linx_process_str_t *s;
+
+    if (!str) {
+        return NULL;
+    }
+
+    s = process_str_of(str);
+    if (s == &s_empty) {
+        return str;
+    }
+
+    __atomic_add_fetch(&s->ref, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s_str_refs, 1, __ATOMIC_RELAXED);
+
+    return str;
+}
+
+/**
+ * 计数降到0和查找都在锁内进行，查找不会取得正在释放的字符串
+*/
+void linx_process_str_unref(const char *str)
+{
+    linx_process_str_stripe_t *stripe;
+    linx_process_str_t **link, *s;
+
+    if (!str) {
+        return;
+    }
+
+    s = process_str_of(str);
+    if (s == &s_empty) {
+        return;
+    }
+
+    __atomic_sub_fetch(&s_str_refs, 1, __ATOMIC_RELAXED);
+
+    stripe = process_str_stripe(s->hash);
+
+    pthread_mutex_lock(&stripe->lock);
+
+    if (__atomic_sub_fetch(&s->ref, 1, __ATOMIC_ACQ_REL) > 0) {
+        pthread_mutex_unlock(&stripe->lock);
+        return;
+    }
+
+    for (link = process_str_bucket(stripe, s->hash); *link != s; link = &(*link)->next) {
+    }
+    *link = s->next;
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    __atomic_sub_fetch(&s_str_count, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&s_str_bytes, sizeof(linx_process_str_t) + s->len + 1, __ATOMIC_RELAXED);
+
+    free(s);
+}
+
+void linx_process_str_stats(uint64_t *count, uint64_t *bytes, uint64_t *refs)
+{
+    if (count) {
+        *count = __atomic_load_n(&s_str_count, __ATOMIC_RELAXED);
+    }
+
+    if (bytes) {
+        *bytes = __atomic_load_n(&s_str_bytes, __ATOMIC_RELAXED);
+    }
+
+    if (refs) {
+        *refs = __atomic_load_n(&s_str_refs, __ATOMIC_RELAXED);
+    }
+}
@@ -1,6 +1,32 @@
 #ifndef __LINX_REGEX_H__
-#define __LINX_REGEX_H__ 
+#define __LINX_REGEX_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 编译后的正则表达式，由缓存持有，linx_regex_deinit 之前一直有效
+*/
+typedef struct linx_regex linx_regex_t;
+
+/**
+ * 锚定方式在编译时确定，匹配时再指定锚定会绕过 JIT
+*/
+typedef enum {
+    LINX_REGEX_SEARCH,          /* 在任意位置查找 */
+    LINX_REGEX_ANCHORED,        /* 从字符串起始位置开始匹配 */
+    LINX_REGEX_FULL,            /* 匹配整个字符串 */
+    LINX_REGEX_MODE_MAX
+} linx_regex_mode_t;
+
+linx_regex_t *linx_regex_get(const char *pattern, linx_regex_mode_t mode);
+
+int linx_regex_exec(const linx_regex_t *re, const char *str, size_t len, size_t *start, size_t *end);
+
+bool linx_regex_test(const linx_regex_t *re, const char *str, size_t len);
 
 int linx_regex_match(const char *regex, const char *str, char **match);
 
+void linx_regex_deinit(void);
+
 #endif /* __LINX_REGEX_H__ */
@@ -1,13 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "pcre2.h"
+#include "uthash.h"
 
 #include "linx_regex.h"
 #include "linx_log.h"
 
+#define LINX_REGEX_JIT_STACK_MIN    (32 * 1024)
+#define LINX_REGEX_JIT_STACK_MAX    (512 * 1024)
+#define LINX_REGEX_MATCH_LIMIT      100000      /* 限制解释执行时的回溯次数 */
+
+struct linx_regex {
+    char *key;                  /* 锚定方式加上正则表达式 */
+    pcre2_code *code;
+    bool jit;
+    UT_hash_handle hh;
+};
+
+/**
+ * 每个线程独占的匹配数据，只需要整体匹配的位置，ovector 只有一组
+*/
+typedef struct {
+    pcre2_match_data *match_data;
+    pcre2_match_context *match_context;
+    pcre2_jit_stack *jit_stack;
+} linx_regex_thread_t;
+
+static linx_regex_t *s_regex_cache = NULL;
+static pthread_mutex_t s_regex_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t s_regex_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t s_regex_key;
+static __thread linx_regex_thread_t *s_regex_thread = NULL;
+
+static void linx_regex_thread_free(void *arg)
+{
+    linx_regex_thread_t *thread = (linx_regex_thread_t *)arg;
+
+    if (!thread) {
+        return;
+    }
+
+    pcre2_match_data_free(thread->match_data);
+    pcre2_match_context_free(thread->match_context);
+    pcre2_jit_stack_free(thread->jit_stack);
+    free(thread);
+}
+
+static void linx_regex_key_create(void)
+{
+    pthread_key_create(&s_regex_key, linx_regex_thread_free);
+}
+
+/**
+ * 线程第一次匹配时创建，线程退出时释放
+*/
+static linx_regex_thread_t *linx_regex_thread_get(void)
+{
+    linx_regex_thread_t *thread = s_regex_thread;
+
+    if (thread) {
+        return thread;
+    }
+
+    pthread_once(&s_regex_key_once, linx_regex_key_create);
+
+    thread = calloc(1, sizeof(linx_regex_thread_t));
+    if (!thread) {
+        return NULL;
+    }
+
+    thread->match_data = pcre2_match_data_create(1, NULL);
+    thread->match_context = pcre2_match_context_create(NULL);
+    thread->jit_stack = pcre2_jit_stack_create(LINX_REGEX_JIT_STACK_MIN, LINX_REGEX_JIT_STACK_MAX, NULL);
+    if (!thread->match_data || !thread->match_context) {
+        linx_regex_thread_free(thread);
+        return NULL;
+    }
+
+    pcre2_set_match_limit(thread->match_context, LINX_REGEX_MATCH_LIMIT);
+
+    /* JIT 栈创建失败时使用默认的 32K 栈 */
+    if (thread->jit_stack) {
+        pcre2_jit_stack_assign(thread->match_context, NULL, thread->jit_stack);
+    }
+
+    pthread_setspecific(s_regex_key, thread);
+    s_regex_thread = thread;
+
+    return thread;
+}
+
+static linx_regex_t *linx_regex_compile(const char *key, const char *pattern, linx_regex_mode_t mode)
+{
+    static const uint32_t options[LINX_REGEX_MODE_MAX] = {
+        [LINX_REGEX_SEARCH] = 0,
+        [LINX_REGEX_ANCHORED] = PCRE2_ANCHORED,
+        [LINX_REGEX_FULL] = PCRE2_ANCHORED | PCRE2_ENDANCHORED,
+    };
+    linx_regex_t *re;
+    int ret, errornumber;
+    PCRE2_SIZE erroroffset;
+    PCRE2_UCHAR buffer[256];
+
+    re = calloc(1, sizeof(linx_regex_t));
+    if (!re) {
+        return NULL;
+    }
+
+    re->key = strdup(key);
+    if (!re->key) {
+        free(re);
+        return NULL;
+    }
+
+    re->code = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED, options[mode],
+                             &errornumber, &erroroffset, NULL);
+    if (re->code == NULL) {
+        pcre2_get_error_message(errornumber, buffer, sizeof(buffer));
+        LINX_LOG_ERROR("PCRE2 compilation of '%s' failed at offset %d: %s",
+                       pattern, (int)erroroffset, buffer);
+        free(re->key);
+        free(re);
+        return NULL;
+    }
+
+    /* JIT编译优化，失败时退回解释执行 */
+    ret = pcre2_jit_compile(re->code, PCRE2_JIT_COMPLETE);
+    if (ret != 0) {
+        pcre2_get_error_message(ret, buffer, sizeof(buffer));
+        LINX_LOG_WARNING("JIT compilation of '%s' failed: %s.", pattern, buffer);
+    } else {
+        re->jit = true;
+    }
+
+    return re;
+}
+
+/**
+ * 相同的正则表达式和锚定方式只编译一次，返回的对象可以在多个线程中同时使用
+*/
+linx_regex_t *linx_regex_get(const char *pattern, linx_regex_mode_t mode)
+{
+    linx_regex_t *re;
+    char *key;
+    size_t len;
+
+    if (pattern == NULL || mode >= LINX_REGEX_MODE_MAX) {
+        LINX_LOG_ERROR("invalid regex");
+        return NULL;
+    }
+
+    len = strlen(pattern) + 3;
+    key = malloc(len);
+    if (!key) {
+        return NULL;
+    }
+
+    snprintf(key, len, "%d:%s", mode, pattern);
+
+    pthread_mutex_lock(&s_regex_lock);
+
+    HASH_FIND_STR(s_regex_cache, key, re);
+    if (!re) {
+        re = linx_regex_compile(key, pattern, mode);
+        if (re) {
+            HASH_ADD_KEYPTR(hh, s_regex_cache, re->key, strlen(re->key), re);
+        }
+    }
+
+    pthread_mutex_unlock(&s_regex_lock);
+
+    free(key);
+
+    return re;
+}
+
+/**
+ * @brief 使用编译好的正则表达式匹配
+ *
+ * @return int 匹配成功返回1，并通过 start 和 end 返回匹配的范围，
+ *             无匹配返回0，错误返回-1
+ */
+int linx_regex_exec(const linx_regex_t *re, const char *str, size_t len, size_t *start, size_t *end)
+{
+    linx_regex_thread_t *thread = linx_regex_thread_get();
+    PCRE2_SIZE *ovector;
+    PCRE2_UCHAR buffer[256];
+    int ret;
+
+    if (!thread) {
+        return -1;
+    }
+
+    if (re->jit) {
+        ret = pcre2_jit_match(re->code, (PCRE2_SPTR)str, len, 0, 0,
+                              thread->match_data, thread->match_context);
+    } else {
+        ret = pcre2_match(re->code, (PCRE2_SPTR)str, len, 0, 0,
+                          thread->match_data, thread->match_context);
+    }
+
+    /* ovector 只有一组时返回0也表示匹配成功 */
+    if (ret >= 0) {
+        ovector = pcre2_get_ovector_pointer(thread->match_data);
+        if (start) {
+            *start = ovector[0];
+        }
+        if (end) {
+            *end = ovector[1];
+        }
+        return 1;
+    }
+
+    if (ret == PCRE2_ERROR_NOMATCH) {
+        return 0;
+    }
+
+    pcre2_get_error_message(ret, buffer, sizeof(buffer));
+    LINX_LOG_DEBUG("Matching error %s", buffer);
+
+    return -1;
+}
+
+bool linx_regex_test(const linx_regex_t *re, const char *str, size_t len)
+{
+    return linx_regex_exec(re, str, len, NULL, NULL) > 0;
+}
+
 /**
- * @brief 使用PCRE2库进行正则表达式匹配
- * 
+ * @brief 从字符串起始位置进行正则表达式匹配，正则表达式只在第一次使用时编译
+ *
  * @param regex 输入的正则表达式字符串
  * @param str 需要匹配的目标字符串
  * @return int 匹配结果:
@@ -17,16 +243,10 @@
  */
 int linx_regex_match(const char *regex, const char *str, char **match_str)
 {
+    linx_regex_t *re;
+    size_t start, end, len;
+    char *new_str;
     int ret;
-    size_t len;
-    int errornumber;
-    PCRE2_SIZE erroroffset;
-    PCRE2_SIZE *ovector, start, end;
-    PCRE2_UCHAR buffer[256];
-    pcre2_code *re;
-    pcre2_match_data *match_data;
-    PCRE2_SPTR pcre2_pattern = (PCRE2_SPTR)regex;
-    PCRE2_SIZE str_length = (PCRE2_SIZE)strlen(str);
 
     /* 参数有效性检查 */
     if (regex == NULL || str == NULL) {
@@ -34,80 +254,47 @@ int linx_regex_match(const char *regex, const char *str, char **match_str)
         return -1;
     }
 
-    /* 正则表达式编译阶段 */
-    re = pcre2_compile(
-        pcre2_pattern,          /* 正则表达式 */
-        PCRE2_ZERO_TERMINATED,  /* 模式以0为结尾 */
-        0,
-        &errornumber,           /* 错误代码 */
-        &erroroffset,           /* 错误位置 */
-        NULL);                  /* 编译上下文 */
-    if (re == NULL) {
-        pcre2_get_error_message(errornumber, buffer, sizeof(buffer));
-        LINX_LOG_ERROR("PCRE2 compilation failed at offset %d: %s", 
-                       (int)erroroffset, buffer);
+    re = linx_regex_get(regex, LINX_REGEX_ANCHORED);
+    if (!re) {
         return -1;
     }
 
-    /* JIT编译优化，提升匹配性能 */
-    ret = pcre2_jit_compile(re, PCRE2_JIT_COMPLETE);
-    if (ret != 0) {
-        pcre2_get_error_message(ret, buffer, sizeof(buffer));
-        LINX_LOG_WARNING("JIT compilation warning: %s.", buffer);
-    } else {
-        LINX_LOG_DEBUG("JIT compiled");
+    ret = linx_regex_exec(re, str, strlen(str), &start, &end);
+    if (ret <= 0) {
+        return ret;
     }
 
-    /* 创建匹配数据缓冲区 */
-    match_data = pcre2_match_data_create_from_pattern(re, NULL);
-    if (!match_data) {
-        LINX_LOG_ERROR("PCRE2 match data creation failed");
-        pcre2_code_free(re);
+    len = end - start;
+
+    new_str = realloc(*match_str, len + 1);
+    if (!new_str) {
         return -1;
     }
 
-    /* 执行正则匹配 */
-    ret = pcre2_match(
-        re,                 /* 编译后的模式 */
-        (PCRE2_SPTR)str,    /* 目标字符串 */
-        str_length,         /* 字符串长度 */
-        0,                  /* 启始偏移 */
-        PCRE2_ANCHORED,     /* 选项：从字符串启始位置开始匹配，隐含^锚点 */
-        match_data,         /* 匹配结果容器 */
-        NULL);              /* 匹配上下文 */
-
-    /* 处理匹配结果 */
-    if (ret < 0) {
-        switch (ret) {
-            case PCRE2_ERROR_NOMATCH:
-                LINX_LOG_DEBUG("No match");
-                break;
-            default:
-                pcre2_get_error_message(ret, buffer, sizeof(buffer));
-                LINX_LOG_ERROR("Matching error %s", buffer);
-                break;
-        }
-    } else {
-        /* 提取并打印匹配结果 */
-        ovector = pcre2_get_ovector_pointer(match_data);
+    memcpy(new_str, str + start, len);
+    new_str[len] = '\0';
+    *match_str = new_str;
 
-        for (int i = 0; i < 1; i++) {
-            start = ovector[2 * i];
-            end = ovector[2 * i + 1];
-            len = end - start;
+    LINX_LOG_DEBUG("Match [%zu:%zu](%zu): %s", start, end, len, *match_str);
 
-            *match_str = realloc(*match_str, len + 1);
-            snprintf(*match_str, len + 1, "%.*s", (int)len, str + start);
+    return len;
+}
 
-            LINX_LOG_DEBUG("Match [%d:%d](%d): %s", start, end, len, *match_str);
-        }
+/**
+ * 释放所有缓存的正则表达式，之后不能再使用 linx_regex_get 返回的对象
+*/
+void linx_regex_deinit(void)
+{
+    linx_regex_t *re, *tmp;
 
-        ret = len;
-    }
+    pthread_mutex_lock(&s_regex_lock);
 
-    /* 释放资源 */
-    pcre2_match_data_free(match_data);
-    pcre2_code_free(re);
+    HASH_ITER(hh, s_regex_cache, re, tmp) {
+        HASH_DEL(s_regex_cache, re);
+        pcre2_code_free(re->code);
+        free(re->key);
+        free(re);
+    }
 
-    return ret;
+    pthread_mutex_unlock(&s_regex_lock);
 }
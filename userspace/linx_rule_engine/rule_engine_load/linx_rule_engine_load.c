@@ -8,6 +8,8 @@
 #include "linx_rule_engine_load.h"
 #include "linx_rule_engine_set.h"
 #include "linx_rule_engine_ast.h"
+#include "linx_rule_engine_pushdown.h"
+#include "rule_match_pred.h"
 
 static int linx_rule_engine_add_rule_to_set(linx_yaml_node_t *root)
 {
@@ -17,6 +19,8 @@ static int linx_rule_engine_add_rule_to_set(linx_yaml_node_t *root)
     linx_rule_match_t *match = NULL;
     linx_output_match_t *output_match = NULL;
     char path_buf[256] = {0};
+    uint8_t types[LINX_EVENT_TYPE_MAX];
+    bool constrained;
 
     if (root == NULL) {
         return -1;
@@ -58,6 +62,10 @@ static int linx_rule_engine_add_rule_to_set(linx_yaml_node_t *root)
             LINX_LOG_ERROR("condition_to_ast failed");
         }
 
+        /* 在 ast 被释放之前分析规则需要哪些事件 */
+        linx_rule_pushdown_add(ret ? NULL : ast_root);
+        constrained = ret ? false : linx_rule_pushdown_event_types(ast_root, types);
+
         /* 该函数会释放 ast 因为已经没有用了 */
         ret = linx_compile_ast(ast_root, &match);
         if (ret) {
@@ -70,7 +78,7 @@ static int linx_rule_engine_add_rule_to_set(linx_yaml_node_t *root)
         }
 
         /* 转换成功则添加到列表中 */
-        ret = linx_rule_set_add(rule, match, output_match);
+        ret = linx_rule_set_add(rule, match, output_match, constrained ? types : NULL);
         if (ret) {
             LINX_LOG_ERROR("add rule to rule set failed");
         }
@@ -142,6 +150,7 @@ int linx_rule_engine_load(const char *rules_file_path)
      * 在加载规则时检查语法，错误就退出。
      * */
     struct stat path_stat;
+    uint32_t pred_refs, pred_count;
     int ret;
 
     ret = linx_rule_set_init();
@@ -149,6 +158,11 @@ int linx_rule_engine_load(const char *rules_file_path)
         return ret;
     }
 
+    ret = linx_rule_pushdown_init();
+    if (ret) {
+        return ret;
+    }
+
     if (stat(rules_file_path, &path_stat) == -1) {
         return -1;
     }
@@ -161,6 +175,15 @@ int linx_rule_engine_load(const char *rules_file_path)
         ret = -1;
     }
 
+    /* 所有规则的字面量都已知，为每个字段构建多模式匹配自动机 */
+    if (linx_rule_pred_build()) {
+        LINX_LOG_WARNING("Failed to build pattern automatons, predicates are matched one by one");
+    }
+
+    linx_rule_pred_get_stats(&pred_refs, &pred_count);
+    LINX_LOG_INFO("rules reference %u predicates, %u after merging identical ones",
+                  pred_refs, pred_count);
+
     return ret;
 }
 
@@ -12,7 +12,13 @@ int linx_compile_ast(ast_node_t *ast, linx_rule_match_t **match);
 
 void linx_rule_engine_match_destroy(linx_rule_match_t *match);
 
-bool linx_rule_engine_match(linx_rule_match_t *match);
+bool linx_rule_engine_match(linx_rule_match_t *match, linx_field_ctx_t *fields, linx_rule_memo_t *memo);
+
+linx_rule_memo_t *linx_rule_memo_create(void);
+
+void linx_rule_memo_destroy(linx_rule_memo_t *memo);
+
+void linx_rule_memo_reset(linx_rule_memo_t *memo);
 
 bool linx_rule_engine_match_with_base(linx_rule_match_t *match, void *base);
 
@@ -5,9 +5,9 @@
 
 int linx_output_match_compile(linx_output_match_t **match, char *format);
 
-int linx_output_match_format(linx_output_match_t *match, char *buffer, size_t buffer_size);
+int linx_output_match_format(linx_output_match_t *match, linx_field_ctx_t *fields, char *buffer, size_t buffer_size);
 
-size_t format_field_value(field_result_t *field, char *buffer, size_t buffer_size, size_t total_length);
+size_t format_field_value(linx_field_ctx_t *fields, field_result_t *field, char *buffer, size_t buffer_size, size_t total_length);
 
 void linx_output_match_destroy(linx_output_match_t *match);
 
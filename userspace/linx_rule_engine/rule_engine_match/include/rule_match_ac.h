@@ -0,0 +1,56 @@
+#ifndef __RULE_MATCH_AC_H__
+#define __RULE_MATCH_AC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Aho-Corasick 多模式匹配自动机
+ * 先用 add 加入所有模式，build 之后才能 scan，build 之后不能再加入模式
+*/
+typedef struct {
+    /* 构建前的字典树，兄弟链表保存子节点 */
+    struct {
+        int32_t first_child;
+        int32_t next_sibling;
+        uint8_t byte;
+    } *trie;
+
+    int32_t *pattern;           /* 每个状态结束的模式编号，-1 表示没有 */
+    int32_t *dict;              /* 沿失败链最近的有模式的状态，-1 表示没有 */
+    uint32_t state_count;
+    uint32_t state_capacity;
+
+    uint32_t *pattern_len;
+    uint32_t pattern_count;
+    uint32_t pattern_capacity;
+
+    /**
+     * 构建后的确定状态机，只为模式中出现过的字节分配列
+     * 转移表中保存目标状态的行偏移，最高位表示目标状态有模式结束，
+     * 扫描时每个字节只有一次依赖的查表
+    */
+    uint8_t classes[256];
+    uint32_t class_count;
+    uint32_t *delta;
+} linx_rule_ac_t;
+
+#define LINX_RULE_AC_OUTPUT     0x80000000U
+
+/**
+ * 每找到一个模式回调一次，start 和 end 为模式在值中的首尾下标
+*/
+typedef void (*linx_rule_ac_hit_t)(void *arg, uint32_t pattern, size_t start, size_t end);
+
+linx_rule_ac_t *linx_rule_ac_create(void);
+
+void linx_rule_ac_destroy(linx_rule_ac_t *ac);
+
+int linx_rule_ac_add(linx_rule_ac_t *ac, const char *pattern, size_t len);
+
+int linx_rule_ac_build(linx_rule_ac_t *ac);
+
+void linx_rule_ac_scan(const linx_rule_ac_t *ac, const char *value, size_t len,
+                       linx_rule_ac_hit_t hit, void *arg);
+
+#endif /* __RULE_MATCH_AC_H__ */
@@ -0,0 +1,58 @@
+#ifndef __RULE_MATCH_GLOB_H__
+#define __RULE_MATCH_GLOB_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * 编译后的 glob 模式，语义与不带标志的 fnmatch 相同
+ * '*' 匹配任意字符串(包括 '/')，'?' 匹配一个字符，[...] 为字符集，'\' 转义下一个字符
+ *
+ * 模式按 '*' 切分为若干段，段之间可以跳过任意字符，
+ * 因此依次查找每一段最靠左的出现位置即可，不需要回溯
+*/
+typedef enum {
+    LINX_RULE_GLOB_BYTE,
+    LINX_RULE_GLOB_ANY,
+    LINX_RULE_GLOB_CLASS,
+    LINX_RULE_GLOB_ATOM_MAX
+} linx_rule_glob_atom_type_t;
+
+typedef struct {
+    uint8_t type;                   /* linx_rule_glob_atom_type_t */
+    uint8_t byte;                   /* 忽略大小写时保存小写形式 */
+    uint16_t cls;                   /* 字符集在 classes 中的下标 */
+} linx_rule_glob_atom_t;
+
+typedef struct {
+    uint32_t start;                 /* 第一个元素在 atoms 中的下标 */
+    uint32_t len;
+    bool literal;                   /* 只有普通字符，可以直接比较 lits 中的内容 */
+} linx_rule_glob_seg_t;
+
+typedef struct {
+    linx_rule_glob_atom_t *atoms;
+    char *lits;                     /* 与 atoms 一一对应的字符，用于纯字面量段的快速比较 */
+    uint64_t (*classes)[4];
+    linx_rule_glob_seg_t *segs;
+    uint32_t seg_count;
+    bool icase;
+    bool has_star;
+    bool anchored_start;            /* 第一段必须从值的开头匹配 */
+    bool anchored_end;              /* 最后一段必须在值的结尾匹配 */
+    uint32_t min_len;               /* 值的最小长度 */
+} linx_rule_glob_t;
+
+linx_rule_glob_t *linx_rule_glob_compile(const char *pattern, bool icase);
+
+bool linx_rule_glob_match(const linx_rule_glob_t *glob, const char *value, size_t len);
+
+/**
+ * 返回匹配时值中必须出现的最长字面量段，用作多模式匹配的预筛选，没有时返回 NULL
+*/
+const char *linx_rule_glob_required(const linx_rule_glob_t *glob, size_t *len);
+
+void linx_rule_glob_destroy(linx_rule_glob_t *glob);
+
+#endif /* __RULE_MATCH_GLOB_H__ */
@@ -0,0 +1,27 @@
+#ifndef __RULE_MATCH_PRED_H__
+#define __RULE_MATCH_PRED_H__
+
+#include <stdbool.h>
+
+#include "rule_match_struct.h"
+
+/**
+ * 返回谓词编号，已有相同谓词时复用原来的编号
+ * field 的所有权转移给谓词表，icontains 的常量会转换为小写保存
+*/
+int linx_rule_pred_intern(linx_rule_op_t op, field_result_t *field, int64_t num,
+                          const char **strs, uint32_t str_count);
+
+bool linx_rule_pred_eval(uint32_t id, linx_field_ctx_t *fields);
+
+bool linx_rule_pred_test(uint32_t id, linx_field_ctx_t *fields, linx_rule_memo_t *memo);
+
+int linx_rule_pred_build(void);
+
+uint32_t linx_rule_pred_count(void);
+
+void linx_rule_pred_get_stats(uint32_t *refs, uint32_t *count);
+
+void linx_rule_pred_deinit(void);
+
+#endif /* __RULE_MATCH_PRED_H__ */
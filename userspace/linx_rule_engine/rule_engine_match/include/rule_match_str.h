@@ -0,0 +1,35 @@
+#ifndef __RULE_MATCH_STR_H__
+#define __RULE_MATCH_STR_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * 带长度的字符串，ptr 指向的内容以 '\0' 结尾，但比较时只使用前 len 个字节
+*/
+typedef struct {
+    const char *ptr;
+    size_t len;
+} linx_rule_str_view_t;
+
+/**
+ * 查找子串，返回第一次出现的位置，没有找到返回 NULL，不分配内存
+ * 首次调用时按 CPU 支持的指令集选择 AVX2、SSE2 或标量实现
+*/
+const char *linx_rule_str_find(const char *value, size_t value_len, const char *needle, size_t needle_len);
+
+/**
+ * 忽略大小写查找子串，needle 必须已经转换为小写，只折叠 ASCII 字母
+*/
+const char *linx_rule_str_ifind(const char *value, size_t value_len, const char *needle, size_t needle_len);
+
+/**
+ * 长度不同时不比较内容，memcmp 由 libc 按 CPU 选择向量实现
+*/
+static inline bool linx_rule_str_equal(const char *a, size_t a_len, const char *b, size_t b_len)
+{
+    return a_len == b_len && memcmp(a, b, a_len) == 0;
+}
+
+#endif /* __RULE_MATCH_STR_H__ */
@@ -1,14 +1,95 @@
 #ifndef __RULE_MATCH_STRUCT_H__
-#define __RULE_MATCH_STRUCT_H__ 
+#define __RULE_MATCH_STRUCT_H__
 
-#include "rule_match_context.h"
+#include <stdint.h>
 
-typedef bool (*match_func_t)(void *context);
+#include "linx_regex.h"
+#include "linx_hash_map.h"
+#include "rule_match_glob.h"
 
+/**
+ * 规则条件编译后的字节码指令
+ * 程序中只有控制指令和 PRED，比较由所有规则共享的谓词完成
+ * and/or 编译为条件跳转实现短路
+*/
+typedef enum {
+    LINX_RULE_OP_RET,               /* 返回累加器 */
+    LINX_RULE_OP_JMP_FALSE,         /* 累加器为假时跳转，用于 and */
+    LINX_RULE_OP_JMP_TRUE,          /* 累加器为真时跳转，用于 or */
+    LINX_RULE_OP_NOT,
+    LINX_RULE_OP_FALSE,             /* 累加器置为假，用于没有注册的字段 */
+    LINX_RULE_OP_PRED,              /* 计算一个共享谓词写入累加器 */
+    /* 以下为谓词的比较方式 */
+    LINX_RULE_OP_NUM_GT,
+    LINX_RULE_OP_NUM_GE,
+    LINX_RULE_OP_NUM_LT,
+    LINX_RULE_OP_NUM_LE,
+    LINX_RULE_OP_STR_EQ,
+    LINX_RULE_OP_STR_NE,
+    LINX_RULE_OP_STR_CONTAINS,
+    LINX_RULE_OP_STR_ICONTAINS,
+    LINX_RULE_OP_STR_STARTSWITH,
+    LINX_RULE_OP_STR_ENDSWITH,
+    LINX_RULE_OP_STR_REGEX,         /* 正则表达式匹配整个值 */
+    LINX_RULE_OP_STR_GLOB,
+    LINX_RULE_OP_STR_IGLOB,
+    LINX_RULE_OP_LIST_IN,
+    LINX_RULE_OP_LIST_PMATCH,       /* 列表中某一项是值的路径前缀 */
+    LINX_RULE_OP_LIST_INTERSECTS,   /* 字段都是单值，与 in 相同 */
+    LINX_RULE_OP_MAX
+} linx_rule_op_t;
+
+/**
+ * 字符串常量在字符串池中的位置，池中的字符串以 '\0' 结尾
+*/
+typedef struct {
+    uint32_t offset;
+    uint32_t len;
+} linx_rule_str_t;
+
+typedef struct {
+    uint8_t op;                     /* linx_rule_op_t */
+    union {
+        uint32_t pred;              /* 谓词编号 */
+        uint32_t target;            /* 跳转目标指令的下标 */
+    } arg;
+} linx_rule_insn_t;
+
+/**
+ * 一条规则条件编译出的程序，指令保存在连续的数组中
+*/
 typedef struct {
-    match_func_t func;
-    match_context_type_t type;
-    void *context;
+    linx_rule_insn_t *insns;
+    uint32_t insn_count;
 } linx_rule_match_t;
 
+/**
+ * 一个字段和常量的比较，相同的比较在所有规则中只保存一份
+*/
+typedef struct {
+    uint8_t op;                     /* LINX_RULE_OP_NUM_GT 到 LINX_RULE_OP_LIST_INTERSECTS */
+    int32_t group;                  /* 所属的多模式匹配组，-1 表示单独计算 */
+    field_result_t field;
+    union {
+        int64_t num;                /* 数值常量 */
+        linx_rule_str_t str;        /* 字符串常量，icontains 保存的是小写形式 */
+        const linx_regex_t *regex;  /* 加载规则时编译好的正则表达式 */
+        linx_rule_glob_t *glob;     /* 加载规则时编译好的 glob 模式，由谓词持有 */
+        struct {
+            uint32_t start;         /* 列表常量在 strs 中的起始下标 */
+            uint32_t count;
+        } list;
+    } arg;
+} linx_rule_pred_t;
+
+/**
+ * 每个事件的谓词缓存，known 中的位表示该谓词已经计算过，value 中为结果
+ * 由匹配线程持有，每个事件开始匹配前清空
+*/
+typedef struct {
+    uint32_t words;
+    uint64_t *known;
+    uint64_t *value;
+} linx_rule_memo_t;
+
 #endif /* __RULE_MATCH_STRUCT_H__ */
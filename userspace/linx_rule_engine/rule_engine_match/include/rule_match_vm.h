@@ -0,0 +1,10 @@
+#ifndef __RULE_MATCH_VM_H__
+#define __RULE_MATCH_VM_H__
+
+#include <stdbool.h>
+
+#include "rule_match_struct.h"
+
+bool linx_rule_vm_exec(const linx_rule_match_t *match, linx_field_ctx_t *fields, linx_rule_memo_t *memo);
+
+#endif /* __RULE_MATCH_VM_H__ */
@@ -1,372 +1,370 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "linx_log.h"
-#include "rule_match_func.h"
+#include "rule_match_vm.h"
+#include "rule_match_pred.h"
 #include "linx_rule_engine_ast.h"
 #include "linx_rule_engine_match.h"
 
-static linx_rule_match_t *compile_ast(ast_node_t *ast);
+typedef struct {
+    linx_rule_match_t *match;
+    uint32_t insn_capacity;
+} rule_compiler_t;
 
-static int find_field_name_and_value(ast_node_t *root, char **name, void **ctx)
-{
-    ast_node_t *left, *right;
-    num_context_t **num_ctx;
-    str_context_t **str_ctx;
-    list_context_t **list_ctx;
-
-    if (root == NULL || 
-        root->data.binary.left == NULL || 
-        root->data.binary.right == NULL)
-    {
-        *name = NULL;
-        return -1;
-    }
+static int compile_node(rule_compiler_t *compiler, ast_node_t *node);
 
-    if (root->data.binary.left->type == AST_NODE_TYPE_FIELD_NAME) {
-        left = root->data.binary.left;
-        right = root->data.binary.right;
-    } else if (root->data.binary.right->type == AST_NODE_TYPE_FIELD_NAME) {
-        left = root->data.binary.right;
-        right = root->data.binary.left;
-    } else {
-        *name = NULL;
-        return -1;
-    }
-
-    *name = left->data.field.name;
+static int compiler_emit(rule_compiler_t *compiler, linx_rule_op_t op, uint32_t arg)
+{
+    linx_rule_match_t *match = compiler->match;
+    uint32_t new_capacity = compiler->insn_capacity ? compiler->insn_capacity * 2 : 8;
+    linx_rule_insn_t *new_insns;
 
-    switch (right->type) {
-    case AST_NODE_TYPE_INT:
-        num_ctx = (num_context_t **)ctx;
-        (*num_ctx)->number.int_val = right->data.number_value.int_value;
-        break;
-    case AST_NODE_TYPE_FLOAT:
-        num_ctx = (num_context_t **)ctx;
-        (*num_ctx)->number.double_val = right->data.number_value.double_value;
-        break;
-    case AST_NODE_TYPE_STRING:
-        str_ctx = (str_context_t **)ctx;
-        (*str_ctx)->str = strdup(right->data.string_value);
-        (*str_ctx)->str_len = strlen(right->data.string_value);
-        break;
-    case AST_NODE_TYPE_LIST:
-        list_ctx = (list_context_t **)ctx;
-        (*list_ctx)->list_count = right->data.list.count;
-        (*list_ctx)->list = (char **)malloc(right->data.list.count * sizeof(char *));
-        if (!((*list_ctx)->list)) {
-            *name = NULL;
+    if (match->insn_count == compiler->insn_capacity) {
+        new_insns = realloc(match->insns, new_capacity * sizeof(linx_rule_insn_t));
+        if (!new_insns) {
             return -1;
         }
 
-        (*list_ctx)->list_len = (size_t *)malloc(right->data.list.count * sizeof(size_t));
-        if (!((*list_ctx)->list_len)) {
-            free((*list_ctx)->list);
-            (*list_ctx)->list = NULL;
-            *name = NULL;
-            return -1;
-        }
+        match->insns = new_insns;
+        compiler->insn_capacity = new_capacity;
+    }
 
-        for (int i = 0; i < right->data.list.count; i++) {
-            (*list_ctx)->list[i] = strdup(right->data.list.items[i]->data.string_value);
-            (*list_ctx)->list_len[i] = strlen(right->data.list.items[i]->data.string_value);
+    match->insns[match->insn_count].op = op;
+    match->insns[match->insn_count].arg.pred = arg;
 
-            if (!((*list_ctx)->list[i])) {
-                for (int j = 0; j < i; ++j) {
-                    free((*list_ctx)->list[i]);
-                    (*list_ctx)->list[i] = NULL;
-                }
+    return (int)match->insn_count++;
+}
 
-                free((*list_ctx)->list);
-                (*list_ctx)->list = NULL;
+/**
+ * 字段和常量组成的比较放入共享的谓词表，程序中只保存谓词编号
+*/
+static int compiler_emit_pred(rule_compiler_t *compiler, linx_rule_op_t op, ast_node_t *node,
+                              int64_t num, const char **strs, uint32_t str_count)
+{
+    field_result_t field;
+    char path[256];
+    int id;
 
-                free((*list_ctx)->list_len);
-                (*list_ctx)->list_len = NULL;
+    if (!node || node->type != AST_NODE_TYPE_FIELD_NAME) {
+        LINX_LOG_ERROR("expected a field name on one side of the comparison");
+        return -1;
+    }
 
-                *name = NULL;
-                return -1;
-            }
-        }
-    default:
-        break;
+    /* 按路径查找时会改写字段名，保留一份用于打印 */
+    snprintf(path, sizeof(path), "%s", node->data.field.name);
+
+    /* 与编译为字节码之前一样，没有注册的字段取不到值，比较结果总是假，不影响规则加载 */
+    field = linx_hash_map_get_field_by_path(node->data.field.name);
+    if (!field.found) {
+        LINX_LOG_WARNING("unknown field %s, the comparison is always false", path);
+        linx_hash_map_release_field(&field);
+        return compiler_emit(compiler, LINX_RULE_OP_FALSE, 0) < 0 ? -1 : 0;
     }
 
-    return 0;
+    id = linx_rule_pred_intern(op, &field, num, strs, str_count);
+    if (id < 0) {
+        return -1;
+    }
+
+    return compiler_emit(compiler, LINX_RULE_OP_PRED, id) < 0 ? -1 : 0;
 }
 
-static linx_rule_match_t *compile_binary_bool_node(ast_node_t *node)
+/**
+ * 找出比较两侧的字段和常量，字段可以写在任意一侧
+*/
+static int compile_operands(ast_node_t *node, ast_node_t **field, ast_node_t **value)
 {
-    linx_rule_match_t *left = compile_ast(node->data.binary.left);
-    linx_rule_match_t *right = compile_ast(node->data.binary.right);
-    linx_rule_match_t *match;
-    logic_context_t *context;
+    ast_node_t *left = node->data.binary.left;
+    ast_node_t *right = node->data.binary.right;
 
-    if (left == NULL || right == NULL) {
-        return NULL;
+    if (!left || !right) {
+        return -1;
     }
 
-    match = malloc(sizeof(linx_rule_match_t));
-    if (match == NULL) {
-        return NULL;
+    if (right->type == AST_NODE_TYPE_FIELD_NAME) {
+        *field = right;
+        *value = left;
+    } else {
+        *field = left;
+        *value = right;
     }
 
-    context = malloc(sizeof(logic_context_t));
-    if (context == NULL) {
-        return NULL;
-    }
+    return 0;
+}
 
-    context->left = left;
-    context->right = right;
-    match->context = context;
+static int compile_binary_bool_node(rule_compiler_t *compiler, ast_node_t *node)
+{
+    linx_rule_op_t op;
+    int jump;
 
     switch (node->data.binary.op.bool_op) {
     case BINARY_BOOL_OP_OR:
-        match->func = or_matcher;
+        op = LINX_RULE_OP_JMP_TRUE;
         break;
     case BINARY_BOOL_OP_AND:
-        match->func = and_matcher;
+        op = LINX_RULE_OP_JMP_FALSE;
         break;
     default:
-        break;
-    }
-
-    return match;
-}
-
-static linx_rule_match_t *compile_binary_num_node(ast_node_t *node)
-{
-    int ret;
-    char *field_name;
-    linx_rule_match_t *match;
-    num_context_t *context;
-
-    match = malloc(sizeof(linx_rule_match_t));
-    if (match == NULL) {
-        return NULL;
+        return -1;
     }
 
-    context = malloc(sizeof(num_context_t));
-    if (context == NULL) {
-        return NULL;
+    if (compile_node(compiler, node->data.binary.left)) {
+        return -1;
     }
 
-    ret = find_field_name_and_value(node, &field_name, (void *)&context);
-    if (ret) {
-        LINX_LOG_ERROR("Failed to find field name");
+    /* 左侧已能决定结果时跳过右侧，跳转目标在右侧编译完成后回填 */
+    jump = compiler_emit(compiler, op, 0);
+    if (jump < 0) {
+        return -1;
     }
 
-    context->field = linx_hash_map_get_field_by_path(field_name);
-
-    switch (node->data.binary.op.num_op) {
-    case BINARY_NUM_OP_GT:
-        match->func = num_gt_matcher;
-        break;
-    case BINARY_NUM_OP_GE:
-        match->func = num_ge_matcher;
-        break;
-    case BINARY_NUM_OP_LT:
-        match->func = num_lt_matcher;
-        break;
-    case BINARY_NUM_OP_LE:
-        match->func = num_le_matcher;
-        break;
-    default:
-        break;
+    if (compile_node(compiler, node->data.binary.right)) {
+        return -1;
     }
 
-    match->context = context;
+    compiler->match->insns[jump].arg.target = compiler->match->insn_count;
 
-    return match;
+    return 0;
 }
 
-static linx_rule_match_t *compile_binary_str_node(ast_node_t *node)
+static int compile_binary_num_node(rule_compiler_t *compiler, ast_node_t *node)
 {
-    int ret;
-    char *field_name;
-    linx_rule_match_t *match;
-    str_context_t *context;
-
-    match = malloc(sizeof(linx_rule_match_t));
-    if (match == NULL) {
-        return NULL;
+    static const linx_rule_op_t ops[BINARY_NUM_OP_MAX] = {
+        [BINARY_NUM_OP_GT] = LINX_RULE_OP_NUM_GT,
+        [BINARY_NUM_OP_GE] = LINX_RULE_OP_NUM_GE,
+        [BINARY_NUM_OP_LT] = LINX_RULE_OP_NUM_LT,
+        [BINARY_NUM_OP_LE] = LINX_RULE_OP_NUM_LE,
+    };
+    ast_node_t *field, *value;
+    int64_t num;
+
+    if (node->data.binary.op.num_op >= BINARY_NUM_OP_MAX ||
+        compile_operands(node, &field, &value))
+    {
+        return -1;
     }
 
-    context = malloc(sizeof(num_context_t));
-    if (context == NULL) {
-        free(match);
-        return NULL;
+    switch (value->type) {
+    case AST_NODE_TYPE_INT:
+        num = value->data.number_value.int_value;
+        break;
+    case AST_NODE_TYPE_FLOAT:
+        num = (int64_t)value->data.number_value.double_value;
+        break;
+    default:
+        LINX_LOG_ERROR("expected a number value for %s", g_binary_num_ops[node->data.binary.op.num_op]);
+        return -1;
     }
 
-    ret = find_field_name_and_value(node, &field_name, (void *)&context);
-    if (ret) {
-        LINX_LOG_ERROR("Failed to find field name");
-    }
+    return compiler_emit_pred(compiler, ops[node->data.binary.op.num_op], field, num, NULL, 0);
+}
 
-    context->field = linx_hash_map_get_field_by_path(field_name);
+static int compile_binary_str_node(rule_compiler_t *compiler, ast_node_t *node)
+{
+    binary_str_op_type_t str_op = node->data.binary.op.str_op;
+    ast_node_t *field, *value;
+    linx_rule_op_t op;
+    const char *str;
 
-    switch (node->data.binary.op.str_op) {
+    switch (str_op) {
     case BINARY_STR_OP_EQ:
-        break;
     case BINARY_STR_OP_ASSIGN:
-        match->func = str_assign_matcher;
+        op = LINX_RULE_OP_STR_EQ;
         break;
     case BINARY_STR_OP_NE:
-        match->func = str_ne_matcher;
-        break;
-    case BINARY_STR_OP_GLOB:
-        break;
-    case BINARY_STR_OP_IGLOB:
+        op = LINX_RULE_OP_STR_NE;
         break;
     case BINARY_STR_OP_CONTAINS:
-        match->func = str_contains_matcher;
+        op = LINX_RULE_OP_STR_CONTAINS;
         break;
     case BINARY_STR_OP_ICONTAINS:
-        match->func = str_icontains_matcher;
-        break;
-    case BINARY_STR_OP_BCONTAINS:
+        op = LINX_RULE_OP_STR_ICONTAINS;
         break;
     case BINARY_STR_OP_STARTSWITH:
-        match->func = str_startswith_matcher;
-        break;
-    case BINARY_STR_OP_BSTARTSWITH:
+        op = LINX_RULE_OP_STR_STARTSWITH;
         break;
     case BINARY_STR_OP_ENDSWITH:
-        match->func = str_endswith_matcher;
+        op = LINX_RULE_OP_STR_ENDSWITH;
         break;
     case BINARY_STR_OP_REGEX:
+        op = LINX_RULE_OP_STR_REGEX;
         break;
-    default:
+    case BINARY_STR_OP_GLOB:
+        op = LINX_RULE_OP_STR_GLOB;
+        break;
+    case BINARY_STR_OP_IGLOB:
+        op = LINX_RULE_OP_STR_IGLOB;
         break;
+    default:
+        LINX_LOG_ERROR("unsupported operator %s",
+                       str_op < BINARY_STR_OP_MAX ? g_binary_str_ops[str_op] : "unknown");
+        return -1;
+    }
+
+    if (compile_operands(node, &field, &value)) {
+        return -1;
+    }
+
+    if (value->type != AST_NODE_TYPE_STRING || !value->data.string_value) {
+        LINX_LOG_ERROR("expected a string value for %s", g_binary_str_ops[str_op]);
+        return -1;
     }
 
-    match->context = context;
+    str = value->data.string_value;
 
-    return match;
+    return compiler_emit_pred(compiler, op, field, 0, &str, 1);
 }
 
-static linx_rule_match_t *compile_binary_list_node(ast_node_t *node)
+static int compile_binary_list_node(rule_compiler_t *compiler, ast_node_t *node)
 {
+    binary_list_op_type_t list_op = node->data.binary.op.list_op;
+    ast_node_t *field, *value, *item;
+    linx_rule_op_t op;
+    const char **strs;
     int ret;
-    char *field_name;
-    linx_rule_match_t *match;
-    num_context_t *context;
 
-    match = malloc(sizeof(linx_rule_match_t));
-    if (match == NULL) {
-        return NULL;
+    switch (list_op) {
+    case BINARY_LIST_OP_IN:
+        op = LINX_RULE_OP_LIST_IN;
+        break;
+    case BINARY_LIST_OP_PMATCH:
+        op = LINX_RULE_OP_LIST_PMATCH;
+        break;
+    case BINARY_LIST_OP_INTERSECTS:
+        op = LINX_RULE_OP_LIST_INTERSECTS;
+        break;
+    default:
+        LINX_LOG_ERROR("unsupported operator %s",
+                       list_op < BINARY_LIST_OP_MAX ? g_binary_list_ops[list_op] : "unknown");
+        return -1;
     }
 
-    context = malloc(sizeof(num_context_t));
-    if (context == NULL) {
-        free(match);
-        return NULL;
+    if (compile_operands(node, &field, &value) || value->type != AST_NODE_TYPE_LIST) {
+        return -1;
     }
 
-    ret = find_field_name_and_value(node, &field_name, (void *)&context);
-    if (ret) {
-        LINX_LOG_ERROR("Failed to find field name");
+    strs = malloc((value->data.list.count + 1) * sizeof(char *));
+    if (!strs) {
+        return -1;
     }
 
-    context->field = linx_hash_map_get_field_by_path(field_name);
+    for (int i = 0; i < value->data.list.count; ++i) {
+        item = value->data.list.items[i];
+        if (!item || item->type != AST_NODE_TYPE_STRING || !item->data.string_value) {
+            free(strs);
+            return -1;
+        }
 
-    switch (node->data.binary.op.list_op) {
-    case BINARY_LIST_OP_INTERSECTS:
-        break;
-    case BINARY_LIST_OP_IN:
-        match->func = list_in_matcher;
-        break;
-    case BINARY_LIST_OP_PMATCH:
-        break;
-    default:
-        break;
+        strs[i] = item->data.string_value;
     }
 
-    match->context = context;
+    ret = compiler_emit_pred(compiler, op, field, 0, strs, value->data.list.count);
 
-    return match;
+    free(strs);
+
+    return ret;
 }
 
-static linx_rule_match_t *compile_unary_node(ast_node_t *node)
+static int compile_unary_node(rule_compiler_t *compiler, ast_node_t *node)
 {
-    linx_rule_match_t *match;
-    unary_context_t *context;
+    unary_op_type_t unary_op = node->data.unary.unary_op;
 
-    match = malloc(sizeof(linx_rule_match_t));
-    if (match == NULL) {
-        return NULL;
-    }
-
-    context = malloc(sizeof(num_context_t));
-    if (context == NULL) {
-        free(match);
-        return NULL;
+    if (unary_op != UNARY_OP_NOT) {
+        LINX_LOG_ERROR("unsupported operator %s",
+                       unary_op < UNARY_OP_MAX ? g_unary_ops[unary_op] : "unknown");
+        return -1;
     }
 
-    switch (node->data.unary.unary_op) {
-    case UNARY_OP_EXISTS:
-        break;
-    case UNARY_OP_NOT:
-        context->operand = compile_ast(node->data.unary.operand);
-        if (context->operand == NULL) {
-            free(context);
-            free(match);
-
-            return NULL;
-        }
-        match->func = not_matcher;
-        break;
-    default:
-        break;
+    if (compile_node(compiler, node->data.unary.operand)) {
+        return -1;
     }
 
-    match->context = context;
-
-    return match;
+    return compiler_emit(compiler, LINX_RULE_OP_NOT, 0) < 0 ? -1 : 0;
 }
 
-static linx_rule_match_t *compile_ast(ast_node_t *ast)
+static int compile_node(rule_compiler_t *compiler, ast_node_t *node)
 {
-    linx_rule_match_t *match = NULL;
-
-    if (ast == NULL) {
-        return match;
+    if (node == NULL) {
+        return -1;
     }
 
-    switch (ast->type) {
+    switch (node->type) {
     case AST_NODE_TYPE_BIN_BOOL_OP:
-        match = compile_binary_bool_node(ast);
-        break;
+        return compile_binary_bool_node(compiler, node);
     case AST_NODE_TYPE_BIN_NUM_OP:
-        match = compile_binary_num_node(ast);
-        break;
+        return compile_binary_num_node(compiler, node);
     case AST_NODE_TYPE_BIN_STR_OP:
-        match = compile_binary_str_node(ast);
-        break;
+        return compile_binary_str_node(compiler, node);
     case AST_NODE_TYPE_BIN_LIST_OP:
-        match = compile_binary_list_node(ast);
-        break;
+        return compile_binary_list_node(compiler, node);
     case AST_NODE_TYPE_UN_OP:
-        match = compile_unary_node(ast);
-        break;
+        return compile_unary_node(compiler, node);
     default:
-        match = NULL;
-        break;
+        return -1;
     }
+}
 
-    return match;
+/**
+ * 跳转之间累加器不变，跳到另一条跳转时可以直接计算出最终落点
+ * 如 a and b and c 中 a 为假时直接跳到末尾，而不是逐个经过 b、c 之后的跳转
+*/
+static void compile_thread_jumps(linx_rule_match_t *match)
+{
+    linx_rule_insn_t *insn, *next;
+    uint32_t target;
+
+    for (uint32_t i = 0; i < match->insn_count; ++i) {
+        insn = &match->insns[i];
+        if (insn->op != LINX_RULE_OP_JMP_FALSE && insn->op != LINX_RULE_OP_JMP_TRUE) {
+            continue;
+        }
+
+        target = insn->arg.target;
+        next = &match->insns[target];
+
+        while (next->op == LINX_RULE_OP_JMP_FALSE || next->op == LINX_RULE_OP_JMP_TRUE) {
+            /* 同类跳转一定会再次跳转，另一类跳转一定不会 */
+            target = (next->op == insn->op) ? next->arg.target : target + 1;
+            next = &match->insns[target];
+        }
+
+        insn->arg.target = target;
+    }
 }
 
 int linx_compile_ast(ast_node_t *ast, linx_rule_match_t **match)
 {
+    rule_compiler_t compiler = {0};
     int ret = 0;
 
+    *match = NULL;
+
     if (ast == NULL) {
         return -1;
     }
-    
-    *match = compile_ast(ast);
 
+    compiler.match = calloc(1, sizeof(linx_rule_match_t));
+    if (!compiler.match) {
+        ret = -1;
+        goto clean_ast;
+    }
+
+    if (compile_node(&compiler, ast) ||
+        compiler_emit(&compiler, LINX_RULE_OP_RET, 0) < 0)
+    {
+        linx_rule_engine_match_destroy(compiler.match);
+        ret = -1;
+        goto clean_ast;
+    }
+
+    compile_thread_jumps(compiler.match);
+
+    *match = compiler.match;
+
+clean_ast:
     ast_node_destroy(ast);
 
     return ret;
@@ -374,88 +372,60 @@ int linx_compile_ast(ast_node_t *ast, linx_rule_match_t **match)
 
 void linx_rule_engine_match_destroy(linx_rule_match_t *match)
 {
-    str_context_t *s_context;
-    num_context_t *n_context;
-    list_context_t *l_context;
-    unary_context_t *u_context;
-    logic_context_t *o_context;
-
     if (!match) {
         return;
     }
 
-    switch (match->type) {
-    case MATCH_CONTEXT_STR:
-        s_context = (str_context_t *)match->context;
-        if (s_context) {
-            if (s_context->str) {
-                free(s_context->str);
-                s_context->str = NULL;
-            }
+    free(match->insns);
+    free(match);
+}
 
-            free(s_context);
-            match->context = NULL;
-        }
-        break;
-    case MATCH_CONTEXT_NUM:
-        n_context = (num_context_t *)match->context;
-        if (n_context) {
-            free(n_context);
-            match->context = NULL;
-        }
-        break;
-    case MATCH_CONTEXT_LIST:
-        l_context = (list_context_t *)match->context;
-        if (l_context) {
-            if (l_context->list && l_context->list_count > 0) {
-                for (size_t i = 0; i < l_context->list_count; ++i) {
-                    free(l_context->list[i]);
-                    l_context->list[i] = NULL;
-                }
-
-                free(l_context->list_len);
-                l_context->list_len = NULL;
-
-                free(l_context->list);
-                l_context->list = NULL;
-            }
-        }
-        break;
-    case MATCH_CONTEXT_UNARY:
-        u_context = (unary_context_t *)match->context;
-        if (u_context) {
-            if (u_context->operand) {
-                linx_rule_engine_match_destroy(u_context->operand);
-            }
-
-            free(u_context);
-            u_context = NULL;
-        }
-        break;
-    case MATCH_CONTEXT_LOGIC:
-        o_context = (logic_context_t *)match->context;
-        if (o_context) {
-            if (o_context->left) {
-                linx_rule_engine_match_destroy(o_context->left);
-            }
-
-            if (o_context->right) {
-                linx_rule_engine_match_destroy(o_context->left);
-            }
-
-            free(o_context);
-            match->context = NULL;
-        }
-        break;
-    default:
-        break;
+/**
+ * 按当前谓词表的大小创建缓存，需要在规则加载完成后调用
+*/
+linx_rule_memo_t *linx_rule_memo_create(void)
+{
+    linx_rule_memo_t *memo;
+
+    memo = calloc(1, sizeof(linx_rule_memo_t));
+    if (!memo) {
+        return NULL;
     }
 
-    free(match);
-    match = NULL;
+    memo->words = (linx_rule_pred_count() + 63) / 64;
+    if (memo->words == 0) {
+        return memo;
+    }
+
+    memo->known = calloc(memo->words, sizeof(uint64_t));
+    memo->value = calloc(memo->words, sizeof(uint64_t));
+    if (!memo->known || !memo->value) {
+        linx_rule_memo_destroy(memo);
+        return NULL;
+    }
+
+    return memo;
+}
+
+void linx_rule_memo_destroy(linx_rule_memo_t *memo)
+{
+    if (!memo) {
+        return;
+    }
+
+    free(memo->known);
+    free(memo->value);
+    free(memo);
+}
+
+void linx_rule_memo_reset(linx_rule_memo_t *memo)
+{
+    if (memo && memo->words) {
+        memset(memo->known, 0, memo->words * sizeof(uint64_t));
+    }
 }
 
-bool linx_rule_engine_match(linx_rule_match_t *match)
+bool linx_rule_engine_match(linx_rule_match_t *match, linx_field_ctx_t *fields, linx_rule_memo_t *memo)
 {
-    return match->func(match->context);
+    return linx_rule_vm_exec(match, fields, memo);
 }
@@ -161,6 +161,7 @@ int linx_output_match_compile(linx_output_match_t **match, char *format)
  * 该函数根据字段类型将字段值格式化为字符串，并将其追加到指定的缓冲区中。
  * 如果字段未找到或值指针为空，则不进行任何操作。
  *
+ * @param fields 当前事件的字段上下文，保存各个表的基地址。
  * @param field 指向字段结果结构体的指针，包含字段类型和值信息。
  * @param buffer 用于存储格式化字符串的缓冲区。
  * @param buffer_size 缓冲区的总大小。
@@ -168,12 +169,12 @@ int linx_output_match_compile(linx_output_match_t **match, char *format)
  *
  * @return 成功时返回格式化后的字段字符串长度；如果缓冲区空间不足则返回 -1。
  */
-size_t format_field_value(field_result_t *field, char *buffer, size_t buffer_size, size_t total_length)
+size_t format_field_value(linx_field_ctx_t *fields, field_result_t *field, char *buffer, size_t buffer_size, size_t total_length)
 {
     size_t field_str_len = 0;
     char field_str[256] = {0};
     linx_field_type_t type;
-    void *value_ptr = linx_hash_map_get_value_ptr(field, &type);
+    void *value_ptr = linx_hash_map_get_value_ptr(fields, field, &type);
 
     // 如果字段未找到或值指针为空，直接返回0
     if (!field->found || value_ptr == NULL) {
@@ -218,6 +219,12 @@ size_t format_field_value(field_result_t *field, char *buffer, size_t buffer_siz
     case LINX_FIELD_TYPE_CHARBUF_ARRAY:
         field_str_len = snprintf(field_str, sizeof(field_str), "%s", (char *)(*(uint64_t *)value_ptr));
         break;
+    case LINX_FIELD_TYPE_CHARBUF_REF:
+        if (*(char **)value_ptr) {
+            field_str_len = snprintf(field_str, sizeof(field_str), "%.*s",
+                                     (int)linx_field_charbuf_ref_len(*(char **)value_ptr), *(char **)value_ptr);
+        }
+        break;
     case LINX_FIELD_TYPE_BOOL:
         field_str_len = snprintf(field_str, sizeof(field_str), "%s", *(bool *)value_ptr ? "true" : "false");
         break;
@@ -244,7 +251,7 @@ size_t format_field_value(field_result_t *field, char *buffer, size_t buffer_siz
     return field_str_len;
 }
 
-int linx_output_match_format(linx_output_match_t *match, char *buffer, size_t buffer_size)
+int linx_output_match_format(linx_output_match_t *match, linx_field_ctx_t *fields, char *buffer, size_t buffer_size)
 {
     size_t total_length = 0;
     size_t literal_len, field_len;
@@ -272,7 +279,7 @@ int linx_output_match_format(linx_output_match_t *match, char *buffer, size_t bu
             strncat(buffer + total_length, segment->data.literal.text, literal_len);
             total_length += literal_len;
         } else if (segment->type == SEGMENT_TYPE_VARIABLE) {
-            field_len = format_field_value(&segment->data.variable, buffer, buffer_size, total_length);
+            field_len = format_field_value(fields, &segment->data.variable, buffer, buffer_size, total_length);
             if (field_len == 0) {
                 continue;
             }
@@ -301,11 +308,18 @@ void linx_output_match_destroy(linx_output_match_t *match)
             free(segment->data.literal.text);
             segment->data.literal.text = NULL;
 
+            free(segment);
+            match->segments[i] = NULL;
+        } else if (segment) {
+            linx_hash_map_release_field(&segment->data.variable);
+
             free(segment);
             match->segments[i] = NULL;
         }
     }
 
+    free(match->segments);
+
     free(match);
     match = NULL;
 }
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "rule_match_ac.h"
+
+static int rule_ac_new_state(linx_rule_ac_t *ac, uint8_t byte)
+{
+    uint32_t new_capacity;
+    void *trie, *pattern;
+
+    if (ac->state_count == ac->state_capacity) {
+        new_capacity = ac->state_capacity ? ac->state_capacity * 2 : 64;
+
+        trie = realloc(ac->trie, new_capacity * sizeof(*ac->trie));
+        if (!trie) {
+            return -1;
+        }
+        ac->trie = trie;
+
+        pattern = realloc(ac->pattern, new_capacity * sizeof(int32_t));
+        if (!pattern) {
+            return -1;
+        }
+        ac->pattern = pattern;
+
+        ac->state_capacity = new_capacity;
+    }
+
+    ac->trie[ac->state_count].first_child = -1;
+    ac->trie[ac->state_count].next_sibling = -1;
+    ac->trie[ac->state_count].byte = byte;
+    ac->pattern[ac->state_count] = -1;
+
+    return (int)ac->state_count++;
+}
+
+linx_rule_ac_t *linx_rule_ac_create(void)
+{
+    linx_rule_ac_t *ac;
+
+    ac = calloc(1, sizeof(linx_rule_ac_t));
+    if (!ac) {
+        return NULL;
+    }
+
+    /* 状态0为根 */
+    if (rule_ac_new_state(ac, 0) < 0) {
+        linx_rule_ac_destroy(ac);
+        return NULL;
+    }
+
+    return ac;
+}
+
+void linx_rule_ac_destroy(linx_rule_ac_t *ac)
+{
+    if (!ac) {
+        return;
+    }
+
+    free(ac->trie);
+    free(ac->pattern);
+    free(ac->dict);
+    free(ac->pattern_len);
+    free(ac->delta);
+    free(ac);
+}
+
+/**
+ * 返回模式编号，相同的模式返回同一个编号
+*/
+int linx_rule_ac_add(linx_rule_ac_t *ac, const char *pattern, size_t len)
+{
+    int32_t state = 0, child;
+    uint32_t new_capacity;
+    uint32_t *pattern_len;
+
+    if (!ac->trie || len == 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < len; ++i) {
+        child = ac->trie[state].first_child;
+        while (child >= 0 && ac->trie[child].byte != (uint8_t)pattern[i]) {
+            child = ac->trie[child].next_sibling;
+        }
+
+        if (child < 0) {
+            child = rule_ac_new_state(ac, (uint8_t)pattern[i]);
+            if (child < 0) {
+                return -1;
+            }
+
+            ac->trie[child].next_sibling = ac->trie[state].first_child;
+            ac->trie[state].first_child = child;
+        }
+
+        state = child;
+    }
+
+    if (ac->pattern[state] >= 0) {
+        return ac->pattern[state];
+    }
+
+    if (ac->pattern_count == ac->pattern_capacity) {
+        new_capacity = ac->pattern_capacity ? ac->pattern_capacity * 2 : 16;
+        pattern_len = realloc(ac->pattern_len, new_capacity * sizeof(uint32_t));
+        if (!pattern_len) {
+            return -1;
+        }
+
+        ac->pattern_len = pattern_len;
+        ac->pattern_capacity = new_capacity;
+    }
+
+    ac->pattern_len[ac->pattern_count] = len;
+    ac->pattern[state] = ac->pattern_count;
+
+    return (int)ac->pattern_count++;
+}
+
+/**
+ * 按层次遍历计算失败链，同时把失败转移合并进状态机，
+ * 扫描时每个字节只需要查一次表
+*/
+int linx_rule_ac_build(linx_rule_ac_t *ac)
+{
+    uint32_t *queue, *row, *fail_row;
+    int32_t *fail;
+    uint32_t head = 0, tail = 0, s, f;
+    int32_t child;
+
+    if (!ac->trie) {
+        return -1;
+    }
+
+    memset(ac->classes, 0, sizeof(ac->classes));
+    ac->class_count = 1;
+
+    for (uint32_t i = 1; i < ac->state_count; ++i) {
+        if (ac->classes[ac->trie[i].byte] == 0) {
+            ac->classes[ac->trie[i].byte] = ac->class_count++;
+        }
+    }
+
+    if ((uint64_t)ac->state_count * ac->class_count >= LINX_RULE_AC_OUTPUT) {
+        return -1;
+    }
+
+    ac->delta = calloc((size_t)ac->state_count * ac->class_count, sizeof(uint32_t));
+    ac->dict = malloc(ac->state_count * sizeof(int32_t));
+    fail = calloc(ac->state_count, sizeof(int32_t));
+    queue = malloc(ac->state_count * sizeof(uint32_t));
+    if (!ac->delta || !ac->dict || !fail || !queue) {
+        free(fail);
+        free(queue);
+        return -1;
+    }
+
+    ac->dict[0] = -1;
+
+    /* 根的子节点失败后回到根，没有子节点的字节停在根 */
+    for (child = ac->trie[0].first_child; child >= 0; child = ac->trie[child].next_sibling) {
+        ac->delta[ac->classes[ac->trie[child].byte]] = child;
+        fail[child] = 0;
+        ac->dict[child] = -1;
+        queue[tail++] = child;
+    }
+
+    while (head < tail) {
+        s = queue[head++];
+        row = ac->delta + (size_t)s * ac->class_count;
+        fail_row = ac->delta + (size_t)fail[s] * ac->class_count;
+
+        /* 失败状态更浅，它的转移已经完整 */
+        memcpy(row, fail_row, ac->class_count * sizeof(uint32_t));
+
+        for (child = ac->trie[s].first_child; child >= 0; child = ac->trie[child].next_sibling) {
+            f = fail_row[ac->classes[ac->trie[child].byte]];
+            fail[child] = f;
+            ac->dict[child] = ac->pattern[f] >= 0 ? (int32_t)f : ac->dict[f];
+            row[ac->classes[ac->trie[child].byte]] = child;
+            queue[tail++] = child;
+        }
+    }
+
+    /* 状态编号换成行偏移，有输出的状态打上标记 */
+    for (size_t i = 0; i < (size_t)ac->state_count * ac->class_count; ++i) {
+        s = ac->delta[i];
+        ac->delta[i] = s * ac->class_count;
+        if (ac->pattern[s] >= 0 || ac->dict[s] >= 0) {
+            ac->delta[i] |= LINX_RULE_AC_OUTPUT;
+        }
+    }
+
+    free(fail);
+    free(queue);
+
+    free(ac->trie);
+    ac->trie = NULL;
+
+    return 0;
+}
+
+void linx_rule_ac_scan(const linx_rule_ac_t *ac, const char *value, size_t len,
+                       linx_rule_ac_hit_t hit, void *arg)
+{
+    uint32_t row = 0, next;
+    int32_t state;
+
+    for (size_t i = 0; i < len; ++i) {
+        next = ac->delta[row + ac->classes[(uint8_t)value[i]]];
+        row = next & ~LINX_RULE_AC_OUTPUT;
+
+        if (!(next & LINX_RULE_AC_OUTPUT)) {
+            continue;
+        }
+
+        state = row / ac->class_count;
+        if (ac->pattern[state] < 0) {
+            state = ac->dict[state];
+        }
+
+        while (state >= 0) {
+            hit(arg, ac->pattern[state], i + 1 - ac->pattern_len[ac->pattern[state]], i);
+            state = ac->dict[state];
+        }
+    }
+}
@@ -0,0 +1,304 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+
+#include "rule_match_str.h"
+#include "rule_match_glob.h"
+
+static inline uint8_t rule_glob_lower(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline void rule_glob_class_set(uint64_t *cls, uint8_t c)
+{
+    cls[c >> 6] |= 1ULL << (c & 63);
+}
+
+static inline bool rule_glob_class_test(const uint64_t *cls, uint8_t c)
+{
+    return (cls[c >> 6] >> (c & 63)) & 1;
+}
+
+/**
+ * 解析 pattern[*pos] 处的 [...]，成功时 *pos 指向 ']' 之后
+ * 没有闭合的 ']' 时返回 -1，此时 '[' 按普通字符处理
+*/
+static int rule_glob_parse_class(const char *pattern, size_t len, size_t *pos, bool icase, uint64_t *cls)
+{
+    size_t i = *pos + 1;
+    bool negate = false, first = true;
+    uint8_t lo, hi;
+
+    memset(cls, 0, 4 * sizeof(uint64_t));
+
+    if (i < len && (pattern[i] == '!' || pattern[i] == '^')) {
+        negate = true;
+        i++;
+    }
+
+    /* 紧跟在开头的 ']' 是字符集的成员 */
+    while (i < len && (pattern[i] != ']' || first)) {
+        first = false;
+
+        if (pattern[i] == '\\' && i + 1 < len) {
+            i++;
+        }
+
+        lo = (uint8_t)pattern[i++];
+        hi = lo;
+
+        if (i + 1 < len && pattern[i] == '-' && pattern[i + 1] != ']') {
+            i++;
+            if (pattern[i] == '\\' && i + 1 < len) {
+                i++;
+            }
+            hi = (uint8_t)pattern[i++];
+        }
+
+        for (uint32_t c = lo; c <= hi; ++c) {
+            rule_glob_class_set(cls, c);
+        }
+    }
+
+    if (i >= len) {
+        return -1;
+    }
+
+    /* 比较时字段值会转换为小写，字符集中的大写字母并入对应的小写字母 */
+    if (icase) {
+        for (uint8_t c = 'A'; c <= 'Z'; ++c) {
+            if (rule_glob_class_test(cls, c)) {
+                rule_glob_class_set(cls, rule_glob_lower(c));
+            }
+        }
+    }
+
+    if (negate) {
+        for (int k = 0; k < 4; ++k) {
+            cls[k] = ~cls[k];
+        }
+    }
+
+    *pos = i + 1;
+
+    return 0;
+}
+
+linx_rule_glob_t *linx_rule_glob_compile(const char *pattern, bool icase)
+{
+    size_t len = strlen(pattern), i = 0;
+    linx_rule_glob_t *glob;
+    linx_rule_glob_atom_t *atom;
+    linx_rule_glob_seg_t *seg = NULL;
+    uint32_t atom_count = 0, class_count = 0;
+    uint8_t c;
+
+    glob = calloc(1, sizeof(linx_rule_glob_t));
+    if (!glob) {
+        return NULL;
+    }
+
+    /* 每个元素至少占用模式中的一个字符，按模式长度分配即可 */
+    glob->atoms = malloc((len + 1) * sizeof(linx_rule_glob_atom_t));
+    glob->lits = malloc(len + 1);
+    glob->classes = malloc((len / 2 + 1) * sizeof(*glob->classes));
+    glob->segs = malloc((len + 1) * sizeof(linx_rule_glob_seg_t));
+    if (!glob->atoms || !glob->lits || !glob->classes || !glob->segs) {
+        linx_rule_glob_destroy(glob);
+        return NULL;
+    }
+
+    glob->icase = icase;
+    glob->anchored_start = (len == 0 || pattern[0] != '*');
+    glob->anchored_end = true;
+
+    while (i < len) {
+        if (pattern[i] == '*') {
+            glob->has_star = true;
+            glob->anchored_end = false;
+            seg = NULL;
+            i++;
+            continue;
+        }
+
+        glob->anchored_end = true;
+
+        if (!seg) {
+            seg = &glob->segs[glob->seg_count++];
+            seg->start = atom_count;
+            seg->len = 0;
+            seg->literal = true;
+        }
+
+        atom = &glob->atoms[atom_count];
+        glob->lits[atom_count] = '\0';
+
+        if (pattern[i] == '?') {
+            atom->type = LINX_RULE_GLOB_ANY;
+            seg->literal = false;
+            i++;
+        } else if (pattern[i] == '[' &&
+                   rule_glob_parse_class(pattern, len, &i, icase, glob->classes[class_count]) == 0)
+        {
+            atom->type = LINX_RULE_GLOB_CLASS;
+            atom->cls = class_count++;
+            seg->literal = false;
+        } else {
+            if (pattern[i] == '\\' && i + 1 < len) {
+                i++;
+            }
+
+            c = (uint8_t)pattern[i++];
+            atom->type = LINX_RULE_GLOB_BYTE;
+            atom->byte = icase ? rule_glob_lower(c) : c;
+            glob->lits[atom_count] = atom->byte;
+        }
+
+        atom_count++;
+        seg->len++;
+        glob->min_len++;
+    }
+
+    return glob;
+}
+
+static inline bool rule_glob_seg_at(const linx_rule_glob_t *glob, const linx_rule_glob_seg_t *seg,
+                                    const char *value)
+{
+    const linx_rule_glob_atom_t *atom = glob->atoms + seg->start;
+    uint8_t c;
+
+    if (seg->literal && !glob->icase) {
+        return memcmp(value, glob->lits + seg->start, seg->len) == 0;
+    }
+
+    for (uint32_t i = 0; i < seg->len; ++i, ++atom) {
+        c = glob->icase ? rule_glob_lower((uint8_t)value[i]) : (uint8_t)value[i];
+
+        switch (atom->type) {
+        case LINX_RULE_GLOB_BYTE:
+            if (c != atom->byte) {
+                return false;
+            }
+            break;
+        case LINX_RULE_GLOB_CLASS:
+            if (!rule_glob_class_test(glob->classes[atom->cls], c)) {
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * 在 [from, to) 中查找段最靠左的出现位置
+*/
+static inline const char *rule_glob_seg_find(const linx_rule_glob_t *glob, const linx_rule_glob_seg_t *seg,
+                                             const char *value, size_t from, size_t to)
+{
+    if (seg->literal) {
+        if (glob->icase) {
+            return linx_rule_str_ifind(value + from, to - from, glob->lits + seg->start, seg->len);
+        }
+
+        return memmem(value + from, to - from, glob->lits + seg->start, seg->len);
+    }
+
+    for (size_t pos = from; pos + seg->len <= to; ++pos) {
+        if (rule_glob_seg_at(glob, seg, value + pos)) {
+            return value + pos;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * 先检查固定在开头和结尾的段，中间的段依次取最靠左的匹配，不会回溯
+*/
+bool linx_rule_glob_match(const linx_rule_glob_t *glob, const char *value, size_t len)
+{
+    const linx_rule_glob_seg_t *seg;
+    uint32_t first = 0, last = glob->seg_count;
+    size_t pos = 0, end = len;
+    const char *found;
+
+    if (len < glob->min_len) {
+        return false;
+    }
+
+    if (!glob->has_star) {
+        return len == glob->min_len && (glob->seg_count == 0 || rule_glob_seg_at(glob, &glob->segs[0], value));
+    }
+
+    if (glob->anchored_start && first < last) {
+        seg = &glob->segs[first++];
+        if (!rule_glob_seg_at(glob, seg, value)) {
+            return false;
+        }
+        pos = seg->len;
+    }
+
+    if (glob->anchored_end && first < last) {
+        seg = &glob->segs[--last];
+        if (!rule_glob_seg_at(glob, seg, value + len - seg->len)) {
+            return false;
+        }
+        end = len - seg->len;
+    }
+
+    for (; first < last; ++first) {
+        seg = &glob->segs[first];
+
+        found = rule_glob_seg_find(glob, seg, value, pos, end);
+        if (!found) {
+            return false;
+        }
+
+        pos = (found - value) + seg->len;
+    }
+
+    return true;
+}
+
+const char *linx_rule_glob_required(const linx_rule_glob_t *glob, size_t *len)
+{
+    const linx_rule_glob_seg_t *best = NULL;
+
+    /* 自动机区分大小写，iglob 不能用它预筛选 */
+    if (glob->icase) {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < glob->seg_count; ++i) {
+        if (glob->segs[i].literal && (!best || glob->segs[i].len > best->len)) {
+            best = &glob->segs[i];
+        }
+    }
+
+    if (!best) {
+        return NULL;
+    }
+
+    *len = best->len;
+
+    return glob->lits + best->start;
+}
+
+void linx_rule_glob_destroy(linx_rule_glob_t *glob)
+{
+    if (!glob) {
+        return;
+    }
+
+    free(glob->atoms);
+    free(glob->lits);
+    free(glob->classes);
+    free(glob->segs);
+    free(glob);
+}
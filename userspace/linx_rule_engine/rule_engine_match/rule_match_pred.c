@@ -0,0 +1,878 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "uthash.h"
+#include "linx_log.h"
+#include "rule_match_ac.h"
+#include "rule_match_pred.h"
+#include "rule_match_str.h"
+#include "output_match_func.h"
+#include "linx_field_type.h"
+
+/**
+ * 字段上的字面量少于这个数时逐个比较比扫描自动机更快
+*/
+#define LINX_RULE_PRED_GROUP_MIN_LITERALS   8
+
+/**
+ * 谓词的规范化键，由比较方式、字段和常量组成
+*/
+typedef struct {
+    char *key;
+    size_t key_len;
+    uint32_t id;
+    UT_hash_handle hh;
+} rule_pred_key_t;
+
+/**
+ * 一个模式命中后需要检查的谓词
+*/
+typedef struct {
+    uint32_t pred;
+    uint8_t op;
+} rule_pred_use_t;
+
+/**
+ * 同一字段上的字面量比较组成一个组，共用一个自动机
+ * 对字段值扫描一次就能得到组内所有谓词的结果，与字面量的数量无关
+*/
+typedef struct {
+    uint32_t field_pred;            /* 组内任一谓词，用它的字段取值 */
+    linx_rule_ac_t *ac;
+    uint32_t *members;
+    uint32_t member_count;
+    uint32_t *use_start;            /* 模式 i 的命中项为 uses[use_start[i], use_start[i + 1]) */
+    rule_pred_use_t *uses;
+} rule_pred_group_t;
+
+/**
+ * 所有规则共享的谓词表，只在加载规则时修改，匹配时只读
+*/
+typedef struct {
+    linx_rule_pred_t *preds;
+    uint32_t size;
+    uint32_t capacity;
+
+    linx_rule_str_t *strs;          /* 列表常量的各个元素 */
+    uint32_t str_count;
+    uint32_t str_capacity;
+
+    char *pool;                     /* 所有字符串常量 */
+    uint32_t pool_size;
+    uint32_t pool_capacity;
+
+    rule_pred_key_t *index;
+    uint32_t refs;                  /* 规则中引用谓词的总次数 */
+
+    rule_pred_group_t *groups;
+    uint32_t group_count;
+} rule_pred_table_t;
+
+static rule_pred_table_t s_pred_table;
+
+static inline bool rule_pred_is_list(linx_rule_op_t op)
+{
+    return op == LINX_RULE_OP_LIST_IN ||
+           op == LINX_RULE_OP_LIST_PMATCH ||
+           op == LINX_RULE_OP_LIST_INTERSECTS;
+}
+
+static int rule_pred_grow(void **array, uint32_t *capacity, uint32_t need, size_t elem_size)
+{
+    uint32_t new_capacity = *capacity ? *capacity : 16;
+    void *new_array;
+
+    if (need <= *capacity) {
+        return 0;
+    }
+
+    while (new_capacity < need) {
+        new_capacity *= 2;
+    }
+
+    new_array = realloc(*array, new_capacity * elem_size);
+    if (!new_array) {
+        return -1;
+    }
+
+    *array = new_array;
+    *capacity = new_capacity;
+
+    return 0;
+}
+
+static int rule_pred_add_str(rule_pred_table_t *table, const char *str, bool lower, linx_rule_str_t *out)
+{
+    size_t len = strlen(str);
+
+    if (rule_pred_grow((void **)&table->pool, &table->pool_capacity,
+                       table->pool_size + len + 1, sizeof(char)))
+    {
+        return -1;
+    }
+
+    out->offset = table->pool_size;
+    out->len = len;
+
+    for (size_t i = 0; i <= len; ++i) {
+        table->pool[out->offset + i] = lower ? tolower((unsigned char)str[i]) : str[i];
+    }
+
+    table->pool_size += len + 1;
+
+    return 0;
+}
+
+/**
+ * 常量已追加到字符串池的末尾，键由头部和这段池内容拼接而成
+*/
+static char *rule_pred_make_key(rule_pred_table_t *table, linx_rule_op_t op, field_result_t *field,
+                                int64_t num, uint32_t pool_start, size_t *key_len)
+{
+    char header[128];
+    int header_len;
+    char *key;
+
+    header_len = snprintf(header, sizeof(header), "%u|%d|%zu|%s|%lld|", op, field->table_index,
+                          field->offset, field->arg ? field->arg : "", (long long)num);
+    if (header_len < 0 || (size_t)header_len >= sizeof(header)) {
+        return NULL;
+    }
+
+    *key_len = header_len + (table->pool_size - pool_start);
+
+    key = malloc(*key_len);
+    if (!key) {
+        return NULL;
+    }
+
+    memcpy(key, header, header_len);
+    memcpy(key + header_len, table->pool + pool_start, table->pool_size - pool_start);
+
+    return key;
+}
+
+int linx_rule_pred_intern(linx_rule_op_t op, field_result_t *field, int64_t num,
+                          const char **strs, uint32_t str_count)
+{
+    rule_pred_table_t *table = &s_pred_table;
+    uint32_t pool_start = table->pool_size;
+    uint32_t str_start = table->str_count;
+    linx_rule_str_t str = {0};
+    linx_rule_pred_t *pred;
+    rule_pred_key_t *entry;
+    char *key = NULL;
+    size_t key_len;
+
+    for (uint32_t i = 0; i < str_count; ++i) {
+        if (rule_pred_add_str(table, strs[i], op == LINX_RULE_OP_STR_ICONTAINS, &str)) {
+            goto clean_rollback;
+        }
+
+        if (!rule_pred_is_list(op)) {
+            continue;
+        }
+
+        if (rule_pred_grow((void **)&table->strs, &table->str_capacity,
+                           table->str_count + 1, sizeof(linx_rule_str_t)))
+        {
+            goto clean_rollback;
+        }
+
+        table->strs[table->str_count++] = str;
+    }
+
+    key = rule_pred_make_key(table, op, field, num, pool_start, &key_len);
+    if (!key) {
+        goto clean_rollback;
+    }
+
+    HASH_FIND(hh, table->index, key, key_len, entry);
+    if (entry) {
+        /* 已有相同的谓词，撤销本次追加的常量 */
+        table->pool_size = pool_start;
+        table->str_count = str_start;
+        linx_hash_map_release_field(field);
+        free(key);
+        table->refs++;
+        return (int)entry->id;
+    }
+
+    if (rule_pred_grow((void **)&table->preds, &table->capacity,
+                       table->size + 1, sizeof(linx_rule_pred_t)))
+    {
+        goto clean_rollback;
+    }
+
+    entry = malloc(sizeof(rule_pred_key_t));
+    if (!entry) {
+        goto clean_rollback;
+    }
+
+    pred = &table->preds[table->size];
+    memset(pred, 0, sizeof(linx_rule_pred_t));
+    pred->op = op;
+    pred->group = -1;
+    pred->field = *field;
+
+    switch (op) {
+    case LINX_RULE_OP_NUM_GT:
+    case LINX_RULE_OP_NUM_GE:
+    case LINX_RULE_OP_NUM_LT:
+    case LINX_RULE_OP_NUM_LE:
+        pred->arg.num = num;
+        break;
+    case LINX_RULE_OP_LIST_IN:
+    case LINX_RULE_OP_LIST_PMATCH:
+    case LINX_RULE_OP_LIST_INTERSECTS:
+        pred->arg.list.start = str_start;
+        pred->arg.list.count = str_count;
+        break;
+    case LINX_RULE_OP_STR_REGEX:
+        /* 表达式仍保存在字符串池中作为键的一部分 */
+        pred->arg.regex = linx_regex_get(table->pool + str.offset, LINX_REGEX_FULL);
+        if (!pred->arg.regex) {
+            free(entry);
+            goto clean_rollback;
+        }
+        break;
+    case LINX_RULE_OP_STR_GLOB:
+    case LINX_RULE_OP_STR_IGLOB:
+        pred->arg.glob = linx_rule_glob_compile(table->pool + str.offset, op == LINX_RULE_OP_STR_IGLOB);
+        if (!pred->arg.glob) {
+            free(entry);
+            goto clean_rollback;
+        }
+        break;
+    default:
+        pred->arg.str = str;
+        break;
+    }
+
+    entry->key = key;
+    entry->key_len = key_len;
+    entry->id = table->size++;
+    HASH_ADD_KEYPTR(hh, table->index, entry->key, entry->key_len, entry);
+
+    table->refs++;
+
+    return (int)entry->id;
+
+clean_rollback:
+    table->pool_size = pool_start;
+    table->str_count = str_start;
+    linx_hash_map_release_field(field);
+    free(key);
+    return -1;
+}
+
+static inline void *rule_pred_get_value_ptr(linx_field_ctx_t *fields, const field_result_t *field,
+                                            linx_field_type_t *type, size_t *len)
+{
+    void *ptr = linx_hash_map_get_value(fields, field, type, len);
+
+    if (ptr && field->type == LINX_FIELD_TYPE_STRUCT) {
+        ptr = (void *)(*(uint64_t *)ptr);
+    }
+
+    return ptr;
+}
+
+/**
+ * 取字段的字符串值和长度，buffer 不为空时非字符串类型的字段格式化后再比较
+ * 参数字段直接使用内核给出的长度，定长字段最多只查找到字段末尾
+*/
+static inline bool rule_pred_get_str(linx_field_ctx_t *fields, field_result_t *field,
+                                     char *buffer, size_t size, linx_rule_str_view_t *view)
+{
+    linx_field_type_t type;
+    size_t len;
+    char *value_ptr = rule_pred_get_value_ptr(fields, field, &type, &len);
+
+    if (!value_ptr) {
+        return false;
+    }
+
+    switch (type) {
+    case LINX_FIELD_TYPE_CHARBUF:
+    case LINX_FIELD_TYPE_UID:
+    case LINX_FIELD_TYPE_PID:
+        view->ptr = value_ptr;
+        if (len != LINX_HASH_MAP_LEN_UNKNOWN) {
+            view->len = len;
+        } else if (type == LINX_FIELD_TYPE_CHARBUF && field->size) {
+            view->len = strnlen(value_ptr, field->size);
+        } else {
+            view->len = strlen(value_ptr);
+        }
+        return true;
+    case LINX_FIELD_TYPE_CHARBUF_ARRAY:
+        view->ptr = (const char *)(*(uint64_t *)value_ptr);
+        if (!view->ptr) {
+            return false;
+        }
+        view->len = strlen(view->ptr);
+        return true;
+    case LINX_FIELD_TYPE_CHARBUF_REF:
+        view->ptr = (const char *)(*(uint64_t *)value_ptr);
+        if (!view->ptr) {
+            return false;
+        }
+        view->len = linx_field_charbuf_ref_len(view->ptr);
+        return true;
+    default:
+        break;
+    }
+
+    if (!buffer) {
+        return false;
+    }
+
+    buffer[0] = '\0';
+    len = format_field_value(fields, field, buffer, size, 0);
+    if (len == 0 || len == (size_t)-1) {
+        return false;
+    }
+
+    view->ptr = buffer;
+    view->len = len;
+
+    return true;
+}
+
+static inline bool rule_pred_get_num(linx_field_ctx_t *fields, const field_result_t *field, int64_t *value)
+{
+    linx_field_type_t type;
+    void *value_ptr = rule_pred_get_value_ptr(fields, field, &type, NULL);
+
+    if (!value_ptr) {
+        return false;
+    }
+
+    switch (type) {
+    case LINX_FIELD_TYPE_INT8:
+        *value = *(int8_t *)value_ptr;
+        break;
+    case LINX_FIELD_TYPE_UINT8:
+        *value = *(uint8_t *)value_ptr;
+        break;
+    case LINX_FIELD_TYPE_INT16:
+        *value = *(int16_t *)value_ptr;
+        break;
+    case LINX_FIELD_TYPE_UINT16:
+        *value = *(uint16_t *)value_ptr;
+        break;
+    case LINX_FIELD_TYPE_INT32:
+        *value = *(int32_t *)value_ptr;
+        break;
+    case LINX_FIELD_TYPE_UINT32:
+        *value = *(uint32_t *)value_ptr;
+        break;
+    case LINX_FIELD_TYPE_BOOL:
+        *value = *(bool *)value_ptr;
+        break;
+    default:
+        *value = *(int64_t *)value_ptr;
+        break;
+    }
+
+    return true;
+}
+
+/**
+ * prefix 是 value 本身或者 value 的上级目录
+*/
+static inline bool rule_pred_path_prefix(const char *value, size_t value_len, const char *prefix, size_t len)
+{
+    if (len > value_len || memcmp(value, prefix, len) != 0) {
+        return false;
+    }
+
+    return len == value_len || prefix[len - 1] == '/' || value[len] == '/';
+}
+
+bool linx_rule_pred_eval(uint32_t id, linx_field_ctx_t *fields)
+{
+    rule_pred_table_t *table = &s_pred_table;
+    linx_rule_pred_t *pred = &table->preds[id];
+    const linx_rule_str_t *item;
+    linx_rule_str_view_t value;
+    const char *str = NULL;
+    size_t len = 0;
+    int64_t num;
+    char buffer[256];
+
+    if (pred->op >= LINX_RULE_OP_STR_EQ && pred->op <= LINX_RULE_OP_STR_ENDSWITH) {
+        str = table->pool + pred->arg.str.offset;
+        len = pred->arg.str.len;
+    }
+
+    switch (pred->op) {
+    case LINX_RULE_OP_NUM_GT:
+        return rule_pred_get_num(fields, &pred->field, &num) && num > pred->arg.num;
+    case LINX_RULE_OP_NUM_GE:
+        return rule_pred_get_num(fields, &pred->field, &num) && num >= pred->arg.num;
+    case LINX_RULE_OP_NUM_LT:
+        return rule_pred_get_num(fields, &pred->field, &num) && num < pred->arg.num;
+    case LINX_RULE_OP_NUM_LE:
+        return rule_pred_get_num(fields, &pred->field, &num) && num <= pred->arg.num;
+    case LINX_RULE_OP_STR_EQ:
+        return rule_pred_get_str(fields, &pred->field, buffer, sizeof(buffer), &value) &&
+               linx_rule_str_equal(value.ptr, value.len, str, len);
+    case LINX_RULE_OP_STR_NE:
+        return !rule_pred_get_str(fields, &pred->field, buffer, sizeof(buffer), &value) ||
+               !linx_rule_str_equal(value.ptr, value.len, str, len);
+    case LINX_RULE_OP_STR_CONTAINS:
+        return rule_pred_get_str(fields, &pred->field, NULL, 0, &value) &&
+               linx_rule_str_find(value.ptr, value.len, str, len) != NULL;
+    case LINX_RULE_OP_STR_ICONTAINS:
+        return rule_pred_get_str(fields, &pred->field, NULL, 0, &value) &&
+               linx_rule_str_ifind(value.ptr, value.len, str, len) != NULL;
+    case LINX_RULE_OP_STR_STARTSWITH:
+        return rule_pred_get_str(fields, &pred->field, NULL, 0, &value) &&
+               value.len >= len && memcmp(value.ptr, str, len) == 0;
+    case LINX_RULE_OP_STR_ENDSWITH:
+        return rule_pred_get_str(fields, &pred->field, NULL, 0, &value) &&
+               value.len >= len && memcmp(value.ptr + value.len - len, str, len) == 0;
+    case LINX_RULE_OP_STR_REGEX:
+        return rule_pred_get_str(fields, &pred->field, buffer, sizeof(buffer), &value) &&
+               linx_regex_test(pred->arg.regex, value.ptr, value.len);
+    case LINX_RULE_OP_STR_GLOB:
+    case LINX_RULE_OP_STR_IGLOB:
+        return rule_pred_get_str(fields, &pred->field, buffer, sizeof(buffer), &value) &&
+               linx_rule_glob_match(pred->arg.glob, value.ptr, value.len);
+    case LINX_RULE_OP_LIST_IN:
+    case LINX_RULE_OP_LIST_INTERSECTS:
+        if (!rule_pred_get_str(fields, &pred->field, buffer, sizeof(buffer), &value)) {
+            return false;
+        }
+
+        item = table->strs + pred->arg.list.start;
+
+        for (uint32_t i = 0; i < pred->arg.list.count; ++i, ++item) {
+            if (linx_rule_str_equal(value.ptr, value.len, table->pool + item->offset, item->len)) {
+                return true;
+            }
+        }
+
+        return false;
+    case LINX_RULE_OP_LIST_PMATCH:
+        if (!rule_pred_get_str(fields, &pred->field, NULL, 0, &value)) {
+            return false;
+        }
+
+        item = table->strs + pred->arg.list.start;
+
+        for (uint32_t i = 0; i < pred->arg.list.count; ++i, ++item) {
+            if (item->len && rule_pred_path_prefix(value.ptr, value.len, table->pool + item->offset, item->len)) {
+                return true;
+            }
+        }
+
+        return false;
+    default:
+        return false;
+    }
+}
+
+/**
+ * 只有非空的字面量比较可以放入自动机
+ * glob 用其中最长的字面量段预筛选，自动机没有找到这一段时 glob 一定不匹配
+*/
+static bool rule_pred_groupable(rule_pred_table_t *table, linx_rule_pred_t *pred)
+{
+    size_t len;
+
+    switch (pred->op) {
+    case LINX_RULE_OP_STR_GLOB:
+        return linx_rule_glob_required(pred->arg.glob, &len) != NULL;
+    case LINX_RULE_OP_STR_EQ:
+    case LINX_RULE_OP_STR_NE:
+    case LINX_RULE_OP_STR_CONTAINS:
+    case LINX_RULE_OP_STR_STARTSWITH:
+    case LINX_RULE_OP_STR_ENDSWITH:
+        return pred->arg.str.len > 0;
+    case LINX_RULE_OP_LIST_IN:
+    case LINX_RULE_OP_LIST_PMATCH:
+    case LINX_RULE_OP_LIST_INTERSECTS:
+        for (uint32_t i = 0; i < pred->arg.list.count; ++i) {
+            if (table->strs[pred->arg.list.start + i].len == 0) {
+                return false;
+            }
+        }
+
+        return pred->arg.list.count > 0;
+    default:
+        return false;
+    }
+}
+
+static bool rule_pred_same_field(const field_result_t *a, const field_result_t *b)
+{
+    if (a->table_index != b->table_index || a->offset != b->offset) {
+        return false;
+    }
+
+    return (!a->arg && !b->arg) || (a->arg && b->arg && strcmp(a->arg, b->arg) == 0);
+}
+
+static void rule_pred_group_free(rule_pred_group_t *group)
+{
+    linx_rule_ac_destroy(group->ac);
+    free(group->members);
+    free(group->use_start);
+    free(group->uses);
+    memset(group, 0, sizeof(rule_pred_group_t));
+}
+
+static int rule_pred_group_init(rule_pred_table_t *table, rule_pred_group_t *group,
+                                const uint32_t *members, uint32_t member_count)
+{
+    linx_rule_pred_t *pred;
+    linx_rule_str_t *strs;
+    uint32_t *patterns = NULL, *pos = NULL;
+    rule_pred_use_t *uses = NULL;
+    uint32_t total = 0, count, k = 0;
+    const char *lit;
+    size_t lit_len;
+    int id;
+
+    memset(group, 0, sizeof(rule_pred_group_t));
+    group->field_pred = members[0];
+
+    for (uint32_t i = 0; i < member_count; ++i) {
+        pred = &table->preds[members[i]];
+        total += rule_pred_is_list(pred->op) ? pred->arg.list.count : 1;
+    }
+
+    group->ac = linx_rule_ac_create();
+    group->members = malloc(member_count * sizeof(uint32_t));
+    patterns = malloc(total * sizeof(uint32_t));
+    uses = malloc(total * sizeof(rule_pred_use_t));
+    if (!group->ac || !group->members || !patterns || !uses) {
+        goto clean_group;
+    }
+
+    memcpy(group->members, members, member_count * sizeof(uint32_t));
+    group->member_count = member_count;
+
+    for (uint32_t i = 0; i < member_count; ++i) {
+        pred = &table->preds[members[i]];
+
+        if (rule_pred_is_list(pred->op)) {
+            strs = table->strs + pred->arg.list.start;
+            count = pred->arg.list.count;
+        } else if (pred->op != LINX_RULE_OP_STR_GLOB) {
+            strs = &pred->arg.str;
+            count = 1;
+        } else {
+            strs = NULL;
+            count = 1;
+        }
+
+        for (uint32_t j = 0; j < count; ++j) {
+            if (strs) {
+                id = linx_rule_ac_add(group->ac, table->pool + strs[j].offset, strs[j].len);
+            } else {
+                lit = linx_rule_glob_required(pred->arg.glob, &lit_len);
+                id = linx_rule_ac_add(group->ac, lit, lit_len);
+            }
+
+            if (id < 0) {
+                goto clean_group;
+            }
+
+            patterns[k] = id;
+            uses[k].pred = members[i];
+            uses[k].op = pred->op;
+            k++;
+        }
+    }
+
+    if (linx_rule_ac_build(group->ac)) {
+        goto clean_group;
+    }
+
+    /* 按模式编号排序命中项 */
+    group->use_start = calloc(group->ac->pattern_count + 1, sizeof(uint32_t));
+    group->uses = malloc(total * sizeof(rule_pred_use_t));
+    pos = malloc((group->ac->pattern_count + 1) * sizeof(uint32_t));
+    if (!group->use_start || !group->uses || !pos) {
+        goto clean_group;
+    }
+
+    for (uint32_t i = 0; i < total; ++i) {
+        group->use_start[patterns[i] + 1]++;
+    }
+
+    for (uint32_t i = 0; i < group->ac->pattern_count; ++i) {
+        group->use_start[i + 1] += group->use_start[i];
+    }
+
+    memcpy(pos, group->use_start, (group->ac->pattern_count + 1) * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < total; ++i) {
+        group->uses[pos[patterns[i]]++] = uses[i];
+    }
+
+    free(pos);
+    free(patterns);
+    free(uses);
+    return 0;
+
+clean_group:
+    free(pos);
+    free(patterns);
+    free(uses);
+    rule_pred_group_free(group);
+    return -1;
+}
+
+/**
+ * 所有规则加载完成后调用，把同一字段上的多个字面量比较编译为一个自动机
+ * 构建失败的字段仍然逐个计算谓词
+*/
+int linx_rule_pred_build(void)
+{
+    rule_pred_table_t *table = &s_pred_table;
+    rule_pred_group_t *groups;
+    linx_rule_pred_t *pred, *other;
+    uint32_t *members;
+    uint32_t count, literals;
+
+    if (table->size == 0) {
+        return 0;
+    }
+
+    members = malloc(table->size * sizeof(uint32_t));
+    if (!members) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < table->size; ++i) {
+        pred = &table->preds[i];
+        if (pred->group >= 0 || !rule_pred_groupable(table, pred)) {
+            continue;
+        }
+
+        count = 0;
+        literals = 0;
+
+        for (uint32_t j = i; j < table->size; ++j) {
+            other = &table->preds[j];
+            if (other->group >= 0 || !rule_pred_groupable(table, other) ||
+                !rule_pred_same_field(&pred->field, &other->field))
+            {
+                continue;
+            }
+
+            members[count++] = j;
+            literals += rule_pred_is_list(other->op) ? other->arg.list.count : 1;
+        }
+
+        if (literals < LINX_RULE_PRED_GROUP_MIN_LITERALS) {
+            continue;
+        }
+
+        groups = realloc(table->groups, (table->group_count + 1) * sizeof(rule_pred_group_t));
+        if (!groups) {
+            break;
+        }
+
+        table->groups = groups;
+
+        if (rule_pred_group_init(table, &table->groups[table->group_count], members, count)) {
+            LINX_LOG_WARNING("Failed to build pattern automaton for %u predicates", count);
+            continue;
+        }
+
+        for (uint32_t j = 0; j < count; ++j) {
+            table->preds[members[j]].group = table->group_count;
+        }
+
+        LINX_LOG_INFO("%u predicates with %u literals share one pattern automaton of %u states",
+                      count, literals, table->groups[table->group_count].ac->state_count);
+
+        table->group_count++;
+    }
+
+    free(members);
+
+    return 0;
+}
+
+typedef struct {
+    const rule_pred_group_t *group;
+    linx_rule_memo_t *memo;
+    const char *value;
+    size_t len;
+    bool formatted;                 /* 值是格式化得到的，只参与相等比较 */
+} rule_pred_scan_t;
+
+static void rule_pred_group_hit(void *arg, uint32_t pattern, size_t start, size_t end)
+{
+    rule_pred_scan_t *scan = (rule_pred_scan_t *)arg;
+    const rule_pred_group_t *group = scan->group;
+    const rule_pred_use_t *use;
+    bool whole = (start == 0 && end + 1 == scan->len);
+    bool hit;
+
+    for (uint32_t u = group->use_start[pattern]; u < group->use_start[pattern + 1]; ++u) {
+        use = &group->uses[u];
+
+        switch (use->op) {
+        case LINX_RULE_OP_STR_EQ:
+        case LINX_RULE_OP_STR_NE:
+        case LINX_RULE_OP_LIST_IN:
+        case LINX_RULE_OP_LIST_INTERSECTS:
+            hit = whole;
+            break;
+        case LINX_RULE_OP_STR_CONTAINS:
+            hit = !scan->formatted;
+            break;
+        case LINX_RULE_OP_STR_STARTSWITH:
+            hit = !scan->formatted && start == 0;
+            break;
+        case LINX_RULE_OP_STR_ENDSWITH:
+            hit = !scan->formatted && end + 1 == scan->len;
+            break;
+        case LINX_RULE_OP_LIST_PMATCH:
+            hit = !scan->formatted && start == 0 &&
+                  (end + 1 == scan->len || scan->value[end] == '/' || scan->value[end + 1] == '/');
+            break;
+        case LINX_RULE_OP_STR_GLOB:
+            /* 预筛选通过，改为单独计算 */
+            scan->memo->known[use->pred >> 6] &= ~(1ULL << (use->pred & 63));
+            continue;
+        default:
+            hit = false;
+            break;
+        }
+
+        if (!hit) {
+            continue;
+        }
+
+        if (use->op == LINX_RULE_OP_STR_NE) {
+            scan->memo->value[use->pred >> 6] &= ~(1ULL << (use->pred & 63));
+        } else {
+            scan->memo->value[use->pred >> 6] |= 1ULL << (use->pred & 63);
+        }
+    }
+}
+
+static void rule_pred_group_eval(rule_pred_table_t *table, const rule_pred_group_t *group,
+                                 linx_field_ctx_t *fields, linx_rule_memo_t *memo)
+{
+    linx_rule_pred_t *pred = &table->preds[group->field_pred];
+    linx_rule_str_view_t value;
+    rule_pred_scan_t scan;
+    char buffer[256];
+    uint32_t id;
+
+    /* 先按没有命中设置所有成员的结果 */
+    for (uint32_t i = 0; i < group->member_count; ++i) {
+        id = group->members[i];
+        memo->known[id >> 6] |= 1ULL << (id & 63);
+
+        if (table->preds[id].op == LINX_RULE_OP_STR_NE) {
+            memo->value[id >> 6] |= 1ULL << (id & 63);
+        } else {
+            memo->value[id >> 6] &= ~(1ULL << (id & 63));
+        }
+    }
+
+    if (!rule_pred_get_str(fields, &pred->field, buffer, sizeof(buffer), &value)) {
+        return;
+    }
+
+    scan.group = group;
+    scan.memo = memo;
+    scan.value = value.ptr;
+    scan.len = value.len;
+    scan.formatted = (value.ptr == buffer);
+
+    linx_rule_ac_scan(group->ac, scan.value, scan.len, rule_pred_group_hit, &scan);
+}
+
+/**
+ * 谓词在本事件中已经计算过时直接使用缓存的结果
+ * 属于某个组的谓词会一次算出整组的结果，通过预筛选的 glob 仍需单独计算
+*/
+bool linx_rule_pred_test(uint32_t id, linx_field_ctx_t *fields, linx_rule_memo_t *memo)
+{
+    rule_pred_table_t *table = &s_pred_table;
+    uint32_t word = id >> 6;
+    uint64_t bit = 1ULL << (id & 63);
+    bool result;
+
+    if (!memo || word >= memo->words) {
+        return linx_rule_pred_eval(id, fields);
+    }
+
+    if (memo->known[word] & bit) {
+        return (memo->value[word] & bit) != 0;
+    }
+
+    if (table->preds[id].group >= 0) {
+        rule_pred_group_eval(table, &table->groups[table->preds[id].group], fields, memo);
+        if (memo->known[word] & bit) {
+            return (memo->value[word] & bit) != 0;
+        }
+    }
+
+    result = linx_rule_pred_eval(id, fields);
+
+    memo->known[word] |= bit;
+    if (result) {
+        memo->value[word] |= bit;
+    } else {
+        memo->value[word] &= ~bit;
+    }
+
+    return result;
+}
+
+uint32_t linx_rule_pred_count(void)
+{
+    return s_pred_table.size;
+}
+
+void linx_rule_pred_get_stats(uint32_t *refs, uint32_t *count)
+{
+    *refs = s_pred_table.refs;
+    *count = s_pred_table.size;
+}
+
+void linx_rule_pred_deinit(void)
+{
+    rule_pred_table_t *table = &s_pred_table;
+    rule_pred_key_t *entry, *tmp;
+
+    for (uint32_t i = 0; i < table->group_count; ++i) {
+        rule_pred_group_free(&table->groups[i]);
+    }
+
+    free(table->groups);
+
+    HASH_ITER(hh, table->index, entry, tmp) {
+        HASH_DEL(table->index, entry);
+        free(entry->key);
+        free(entry);
+    }
+
+    for (uint32_t i = 0; i < table->size; ++i) {
+        linx_hash_map_release_field(&table->preds[i].field);
+
+        if (table->preds[i].op == LINX_RULE_OP_STR_GLOB || table->preds[i].op == LINX_RULE_OP_STR_IGLOB) {
+            linx_rule_glob_destroy(table->preds[i].arg.glob);
+        }
+    }
+
+    free(table->preds);
+    free(table->strs);
+    free(table->pool);
+    memset(table, 0, sizeof(rule_pred_table_t));
+}
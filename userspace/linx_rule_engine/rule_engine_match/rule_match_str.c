@@ -0,0 +1,279 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+
+#include "rule_match_str.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINX_RULE_STR_X86
+#endif
+
+typedef const char *(*rule_str_find_t)(const char *value, size_t value_len,
+                                       const char *needle, size_t needle_len);
+
+/**
+ * 一套实现，按 CPU 支持的指令集选择其中一套
+*/
+typedef struct {
+    rule_str_find_t find;
+    rule_str_find_t ifind;
+} rule_str_impl_t;
+
+static inline char rule_str_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline bool rule_str_iequal(const char *value, const char *needle, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        if (rule_str_lower(value[i]) != needle[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * 从 pos 开始逐字节查找，也用于向量实现处理剩余的尾部
+*/
+static inline const char *rule_str_find_from(const char *value, size_t value_len,
+                                             const char *needle, size_t needle_len, size_t pos, bool fold)
+{
+    for (; pos + needle_len <= value_len; ++pos) {
+        if (fold) {
+            if (rule_str_lower(value[pos]) == needle[0] &&
+                rule_str_iequal(value + pos + 1, needle + 1, needle_len - 1))
+            {
+                return value + pos;
+            }
+        } else if (value[pos] == needle[0] && memcmp(value + pos + 1, needle + 1, needle_len - 1) == 0) {
+            return value + pos;
+        }
+    }
+
+    return NULL;
+}
+
+static const char *rule_str_find_scalar(const char *value, size_t value_len,
+                                        const char *needle, size_t needle_len)
+{
+    return memmem(value, value_len, needle, needle_len);
+}
+
+static const char *rule_str_ifind_scalar(const char *value, size_t value_len,
+                                         const char *needle, size_t needle_len)
+{
+    return rule_str_find_from(value, value_len, needle, needle_len, 0, true);
+}
+
+static const rule_str_impl_t s_rule_str_scalar = {
+    .find = rule_str_find_scalar,
+    .ifind = rule_str_ifind_scalar,
+};
+
+#ifdef LINX_RULE_STR_X86
+
+/**
+ * 向量实现先比较每个候选位置的首尾字节，两者都相同的位置再比较中间部分
+ * 候选位置的首字节和尾字节分别来自两次错开 needle_len - 1 的加载
+ * 忽略大小写时加载后先在寄存器中转换为小写
+*/
+static inline bool rule_str_check(const char *pos, const char *needle, size_t needle_len, bool fold)
+{
+    if (needle_len <= 2) {
+        return true;
+    }
+
+    return fold ? rule_str_iequal(pos + 1, needle + 1, needle_len - 2) :
+                  memcmp(pos + 1, needle + 1, needle_len - 2) == 0;
+}
+
+__attribute__((target("sse2"), always_inline))
+static inline __m128i rule_str_load_sse2(const char *pos, bool fold)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)pos);
+    __m128i upper;
+
+    if (!fold) {
+        return x;
+    }
+
+    upper = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('A' - 1)),
+                          _mm_cmplt_epi8(x, _mm_set1_epi8('Z' + 1)));
+
+    return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+}
+
+__attribute__((target("sse2"), always_inline))
+static inline const char *rule_str_find_sse2_impl(const char *value, size_t value_len,
+                                                  const char *needle, size_t needle_len, bool fold)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    __m128i head, tail;
+    uint32_t mask, bit;
+    size_t i = 0;
+
+    for (; i + needle_len - 1 + 16 <= value_len; i += 16) {
+        head = rule_str_load_sse2(value + i, fold);
+        tail = rule_str_load_sse2(value + i + needle_len - 1, fold);
+        mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+
+        while (mask) {
+            bit = __builtin_ctz(mask);
+            if (rule_str_check(value + i + bit, needle, needle_len, fold)) {
+                return value + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return rule_str_find_from(value, value_len, needle, needle_len, i, fold);
+}
+
+__attribute__((target("sse2")))
+static const char *rule_str_find_sse2(const char *value, size_t value_len,
+                                      const char *needle, size_t needle_len)
+{
+    return rule_str_find_sse2_impl(value, value_len, needle, needle_len, false);
+}
+
+__attribute__((target("sse2")))
+static const char *rule_str_ifind_sse2(const char *value, size_t value_len,
+                                       const char *needle, size_t needle_len)
+{
+    return rule_str_find_sse2_impl(value, value_len, needle, needle_len, true);
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline __m256i rule_str_load_avx2(const char *pos, bool fold)
+{
+    __m256i x = _mm256_loadu_si256((const __m256i *)pos);
+    __m256i upper;
+
+    if (!fold) {
+        return x;
+    }
+
+    upper = _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8('A' - 1)),
+                             _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), x));
+
+    return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8('a' - 'A')));
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline const char *rule_str_find_avx2_impl(const char *value, size_t value_len,
+                                                  const char *needle, size_t needle_len, bool fold)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+    __m256i head, tail;
+    uint32_t mask, bit;
+    size_t i = 0;
+
+    for (; i + needle_len - 1 + 32 <= value_len; i += 32) {
+        head = rule_str_load_avx2(value + i, fold);
+        tail = rule_str_load_avx2(value + i + needle_len - 1, fold);
+        mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first),
+                                                     _mm256_cmpeq_epi8(tail, last)));
+
+        while (mask) {
+            bit = __builtin_ctz(mask);
+            if (rule_str_check(value + i + bit, needle, needle_len, fold)) {
+                return value + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    /* 不足 32 字节的尾部交给 SSE2，先清掉高位避免 AVX 和 SSE 切换的开销 */
+    _mm256_zeroupper();
+
+    return fold ? rule_str_ifind_sse2(value + i, value_len - i, needle, needle_len) :
+                  rule_str_find_sse2(value + i, value_len - i, needle, needle_len);
+}
+
+__attribute__((target("avx2")))
+static const char *rule_str_find_avx2(const char *value, size_t value_len,
+                                      const char *needle, size_t needle_len)
+{
+    return rule_str_find_avx2_impl(value, value_len, needle, needle_len, false);
+}
+
+__attribute__((target("avx2")))
+static const char *rule_str_ifind_avx2(const char *value, size_t value_len,
+                                       const char *needle, size_t needle_len)
+{
+    return rule_str_find_avx2_impl(value, value_len, needle, needle_len, true);
+}
+
+static const rule_str_impl_t s_rule_str_sse2 = {
+    .find = rule_str_find_sse2,
+    .ifind = rule_str_ifind_sse2,
+};
+
+static const rule_str_impl_t s_rule_str_avx2 = {
+    .find = rule_str_find_avx2,
+    .ifind = rule_str_ifind_avx2,
+};
+
+#endif /* LINX_RULE_STR_X86 */
+
+static const rule_str_impl_t *s_rule_str_impl = NULL;
+
+/**
+ * 第一次调用时选择实现，多个线程同时选择时结果相同，重复写入没有影响
+*/
+static inline const rule_str_impl_t *rule_str_impl(void)
+{
+    const rule_str_impl_t *impl = __atomic_load_n(&s_rule_str_impl, __ATOMIC_RELAXED);
+
+    if (impl) {
+        return impl;
+    }
+
+    impl = &s_rule_str_scalar;
+
+#ifdef LINX_RULE_STR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impl = &s_rule_str_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        impl = &s_rule_str_sse2;
+    }
+#endif
+
+    __atomic_store_n(&s_rule_str_impl, impl, __ATOMIC_RELAXED);
+
+    return impl;
+}
+
+const char *linx_rule_str_find(const char *value, size_t value_len, const char *needle, size_t needle_len)
+{
+    if (needle_len == 0) {
+        return value;
+    }
+
+    if (needle_len > value_len) {
+        return NULL;
+    }
+
+    return rule_str_impl()->find(value, value_len, needle, needle_len);
+}
+
+const char *linx_rule_str_ifind(const char *value, size_t value_len, const char *needle, size_t needle_len)
+{
+    if (needle_len == 0) {
+        return value;
+    }
+
+    if (needle_len > value_len) {
+        return NULL;
+    }
+
+    return rule_str_impl()->ifind(value, value_len, needle, needle_len);
+}
@@ -0,0 +1,57 @@
+#include "rule_match_vm.h"
+#include "rule_match_pred.h"
+
+/**
+ * 解释执行规则条件的字节码，使用计算跳转分派指令
+ * 每条指令执行完直接跳到下一条指令的处理代码，没有函数调用和循环分支
+*/
+bool linx_rule_vm_exec(const linx_rule_match_t *match, linx_field_ctx_t *fields, linx_rule_memo_t *memo)
+{
+    static const void *dispatch[LINX_RULE_OP_PRED + 1] = {
+        [LINX_RULE_OP_RET]          = &&op_ret,
+        [LINX_RULE_OP_JMP_FALSE]    = &&op_jmp_false,
+        [LINX_RULE_OP_JMP_TRUE]     = &&op_jmp_true,
+        [LINX_RULE_OP_NOT]          = &&op_not,
+        [LINX_RULE_OP_FALSE]        = &&op_false,
+        [LINX_RULE_OP_PRED]         = &&op_pred,
+    };
+    const linx_rule_insn_t *pc = match->insns;
+    bool acc = false;
+
+#define DISPATCH()      goto *dispatch[pc->op]
+#define NEXT()          do { ++pc; DISPATCH(); } while (0)
+
+    DISPATCH();
+
+op_jmp_false:
+    if (!acc) {
+        pc = match->insns + pc->arg.target;
+        DISPATCH();
+    }
+    NEXT();
+
+op_jmp_true:
+    if (acc) {
+        pc = match->insns + pc->arg.target;
+        DISPATCH();
+    }
+    NEXT();
+
+op_not:
+    acc = !acc;
+    NEXT();
+
+op_false:
+    acc = false;
+    NEXT();
+
+op_pred:
+    acc = linx_rule_pred_test(pc->arg.pred, fields, memo);
+    NEXT();
+
+op_ret:
+    return acc;
+
+#undef DISPATCH
+#undef NEXT
+}
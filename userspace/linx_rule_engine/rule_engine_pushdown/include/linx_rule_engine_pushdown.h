@@ -0,0 +1,40 @@
+#ifndef __LINX_RULE_ENGINE_PUSHDOWN_H__
+#define __LINX_RULE_ENGINE_PUSHDOWN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "linx_config.h"
+#include "linx_syscall_id.h"
+#include "linx_event_type.h"
+#include "linx_size_define.h"
+#include "ast_node.h"
+
+/**
+ * 规则条件对事件的约束，all_xxx 为 true 表示该维度没有约束
+ * 所有规则约束的并集就是内核需要发送到用户态的事件
+*/
+typedef struct {
+    bool all_types;
+    uint8_t types[LINX_EVENT_TYPE_MAX];     /* evt.type 按名称匹配，进入和退出事件同名 */
+
+    bool all_comms;
+    uint32_t ncomms;
+    char comms[LINX_BPF_FILTER_COMM_MAX_SIZE][LINX_COMM_MAX_SIZE];
+
+    bool all_uids;
+    uint32_t nuids;
+    uint32_t uids[LINX_BPF_FILTER_UID_MAX_SIZE];
+} linx_rule_pushdown_t;
+
+int linx_rule_pushdown_init(void);
+
+void linx_rule_pushdown_deinit(void);
+
+void linx_rule_pushdown_add(ast_node_t *ast);
+
+int linx_rule_pushdown_apply(linx_global_config_t *config);
+
+bool linx_rule_pushdown_event_types(ast_node_t *ast, uint8_t types[LINX_EVENT_TYPE_MAX]);
+
+#endif /* __LINX_RULE_ENGINE_PUSHDOWN_H__ */
@@ -0,0 +1,576 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linx_log.h"
+#include "linx_type.h"
+#include "linx_event_table.h"
+#include "linx_rule_engine_pushdown.h"
+
+typedef enum {
+    PUSHDOWN_FIELD_NONE,
+    PUSHDOWN_FIELD_TYPE,        /* evt.type */
+    PUSHDOWN_FIELD_COMM,        /* proc.name, proc.comm */
+    PUSHDOWN_FIELD_UID,         /* proc.uid */
+    PUSHDOWN_FIELD_MAX
+} pushdown_field_t;
+
+/* 所有规则约束的并集 */
+static linx_rule_pushdown_t *s_pushdown = NULL;
+static size_t s_nrules = 0;
+
+static pushdown_field_t pushdown_field_kind(ast_node_t *node)
+{
+    const char *name;
+
+    if (node == NULL || node->type != AST_NODE_TYPE_FIELD_NAME) {
+        return PUSHDOWN_FIELD_NONE;
+    }
+
+    name = node->data.field.name;
+
+    if (strcmp(name, "evt.type") == 0) {
+        return PUSHDOWN_FIELD_TYPE;
+    } else if (strcmp(name, "proc.name") == 0 || strcmp(name, "proc.comm") == 0) {
+        return PUSHDOWN_FIELD_COMM;
+    } else if (strcmp(name, "proc.uid") == 0) {
+        return PUSHDOWN_FIELD_UID;
+    }
+
+    return PUSHDOWN_FIELD_NONE;
+}
+
+/**
+ * 父进程、祖先进程的信息来自它们自己的进程快照
+ * 引用了这些字段的规则不能按 comm/uid 过滤，否则父进程的快照可能被内核丢弃
+*/
+static bool pushdown_has_ancestor_field(ast_node_t *node)
+{
+    const char *name;
+
+    if (node == NULL) {
+        return false;
+    }
+
+    switch (node->type) {
+    case AST_NODE_TYPE_FIELD_NAME:
+        name = node->data.field.name;
+        if (strncmp(name, "proc.p", 6) == 0 && strcmp(name, "proc.pid") != 0) {
+            return true;
+        }
+        if (strncmp(name, "proc.a", 6) == 0 && strcmp(name, "proc.args") != 0) {
+            return true;
+        }
+        return false;
+    case AST_NODE_TYPE_BIN_BOOL_OP:
+    case AST_NODE_TYPE_BIN_NUM_OP:
+    case AST_NODE_TYPE_BIN_STR_OP:
+    case AST_NODE_TYPE_BIN_LIST_OP:
+        return pushdown_has_ancestor_field(node->data.binary.left) ||
+               pushdown_has_ancestor_field(node->data.binary.right);
+    case AST_NODE_TYPE_UN_OP:
+        return pushdown_has_ancestor_field(node->data.unary.operand);
+    case AST_NODE_TYPE_FIELD_TRANSFORMER:
+    case AST_NODE_TYPE_FIELD_TRANSFORMER_VAL:
+        return pushdown_has_ancestor_field(node->data.field_transformer.operand);
+    default:
+        return false;
+    }
+}
+
+static void pushdown_set_all(linx_rule_pushdown_t *p)
+{
+    p->all_types = true;
+    p->all_comms = true;
+    p->all_uids = true;
+}
+
+/**
+ * 将某一维度置为空集，之后再逐个添加允许的值
+*/
+static void pushdown_clear(linx_rule_pushdown_t *p, pushdown_field_t kind)
+{
+    switch (kind) {
+    case PUSHDOWN_FIELD_TYPE:
+        p->all_types = false;
+        memset(p->types, 0, sizeof(p->types));
+        break;
+    case PUSHDOWN_FIELD_COMM:
+        p->all_comms = false;
+        p->ncomms = 0;
+        break;
+    case PUSHDOWN_FIELD_UID:
+        p->all_uids = false;
+        p->nuids = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+static void pushdown_set_field_all(linx_rule_pushdown_t *p, pushdown_field_t kind)
+{
+    switch (kind) {
+    case PUSHDOWN_FIELD_TYPE:
+        p->all_types = true;
+        break;
+    case PUSHDOWN_FIELD_COMM:
+        p->all_comms = true;
+        break;
+    case PUSHDOWN_FIELD_UID:
+        p->all_uids = true;
+        break;
+    default:
+        break;
+    }
+}
+
+static bool pushdown_has_comm(linx_rule_pushdown_t *p, const char *comm)
+{
+    for (uint32_t i = 0; i < p->ncomms; ++i) {
+        if (strcmp(p->comms[i], comm) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool pushdown_has_uid(linx_rule_pushdown_t *p, uint32_t uid)
+{
+    for (uint32_t i = 0; i < p->nuids; ++i) {
+        if (p->uids[i] == uid) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void pushdown_add_comm(linx_rule_pushdown_t *p, const char *comm)
+{
+    if (p->all_comms || pushdown_has_comm(p, comm)) {
+        return;
+    }
+
+    /* 内核中的 comm 会被截断，过长的名字无法精确过滤 */
+    if (strlen(comm) >= LINX_COMM_MAX_SIZE || p->ncomms >= LINX_BPF_FILTER_COMM_MAX_SIZE) {
+        p->all_comms = true;
+        return;
+    }
+
+    snprintf(p->comms[p->ncomms++], LINX_COMM_MAX_SIZE, "%s", comm);
+}
+
+static void pushdown_add_uid(linx_rule_pushdown_t *p, uint32_t uid)
+{
+    if (p->all_uids || pushdown_has_uid(p, uid)) {
+        return;
+    }
+
+    if (p->nuids >= LINX_BPF_FILTER_UID_MAX_SIZE) {
+        p->all_uids = true;
+        return;
+    }
+
+    p->uids[p->nuids++] = uid;
+}
+
+static void pushdown_add_value(linx_rule_pushdown_t *p, pushdown_field_t kind, ast_node_t *value)
+{
+    const char *str;
+    char *end;
+    unsigned long uid;
+    bool found = false;
+
+    /* 值是字段或转换函数时无法在加载时确定 */
+    if (value == NULL || value->type != AST_NODE_TYPE_STRING) {
+        pushdown_set_field_all(p, kind);
+        return;
+    }
+
+    str = value->data.string_value;
+
+    switch (kind) {
+    case PUSHDOWN_FIELD_TYPE:
+        for (int i = 0; i < LINX_EVENT_TYPE_MAX; ++i) {
+            if (strcmp(g_linx_event_table[i].name, str) == 0) {
+                p->types[i] = 1;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            LINX_LOG_WARNING("rule pushdown: '%s' is not an event type", str);
+        }
+        break;
+    case PUSHDOWN_FIELD_COMM:
+        pushdown_add_comm(p, str);
+        break;
+    case PUSHDOWN_FIELD_UID:
+        uid = strtoul(str, &end, 10);
+        if (*str == '\0' || *end != '\0') {
+            pushdown_set_field_all(p, kind);
+            break;
+        }
+
+        pushdown_add_uid(p, (uint32_t)uid);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * a and b，没有约束的一方不影响结果，否则取交集
+*/
+static void pushdown_and(linx_rule_pushdown_t *dst, linx_rule_pushdown_t *src)
+{
+    uint32_t n;
+
+    if (dst->all_types) {
+        dst->all_types = src->all_types;
+        memcpy(dst->types, src->types, sizeof(dst->types));
+    } else if (!src->all_types) {
+        for (int i = 0; i < LINX_EVENT_TYPE_MAX; ++i) {
+            dst->types[i] &= src->types[i];
+        }
+    }
+
+    if (dst->all_comms) {
+        dst->all_comms = src->all_comms;
+        dst->ncomms = src->ncomms;
+        memcpy(dst->comms, src->comms, sizeof(dst->comms));
+    } else if (!src->all_comms) {
+        n = 0;
+        for (uint32_t i = 0; i < dst->ncomms; ++i) {
+            if (pushdown_has_comm(src, dst->comms[i])) {
+                memmove(dst->comms[n++], dst->comms[i], LINX_COMM_MAX_SIZE);
+            }
+        }
+        dst->ncomms = n;
+    }
+
+    if (dst->all_uids) {
+        dst->all_uids = src->all_uids;
+        dst->nuids = src->nuids;
+        memcpy(dst->uids, src->uids, sizeof(dst->uids));
+    } else if (!src->all_uids) {
+        n = 0;
+        for (uint32_t i = 0; i < dst->nuids; ++i) {
+            if (pushdown_has_uid(src, dst->uids[i])) {
+                dst->uids[n++] = dst->uids[i];
+            }
+        }
+        dst->nuids = n;
+    }
+}
+
+/**
+ * a or b，任意一方没有约束则结果没有约束，否则取并集
+*/
+static void pushdown_or(linx_rule_pushdown_t *dst, linx_rule_pushdown_t *src)
+{
+    if (src->all_types) {
+        dst->all_types = true;
+    } else if (!dst->all_types) {
+        for (int i = 0; i < LINX_EVENT_TYPE_MAX; ++i) {
+            dst->types[i] |= src->types[i];
+        }
+    }
+
+    if (src->all_comms) {
+        dst->all_comms = true;
+    } else {
+        for (uint32_t i = 0; i < src->ncomms; ++i) {
+            pushdown_add_comm(dst, src->comms[i]);
+        }
+    }
+
+    if (src->all_uids) {
+        dst->all_uids = true;
+    } else {
+        for (uint32_t i = 0; i < src->nuids; ++i) {
+            pushdown_add_uid(dst, src->uids[i]);
+        }
+    }
+}
+
+/**
+ * 只识别 field = value 和 field in (...) 两种形式，
+ * not 以及其它无法判断的条件都视为没有约束
+*/
+static void pushdown_analyze(ast_node_t *node, linx_rule_pushdown_t *p)
+{
+    linx_rule_pushdown_t *right;
+    pushdown_field_t kind;
+
+    pushdown_set_all(p);
+
+    if (node == NULL) {
+        return;
+    }
+
+    switch (node->type) {
+    case AST_NODE_TYPE_BIN_BOOL_OP:
+        right = malloc(sizeof(linx_rule_pushdown_t));
+        if (!right) {
+            return;
+        }
+
+        pushdown_analyze(node->data.binary.left, p);
+        pushdown_analyze(node->data.binary.right, right);
+
+        if (node->data.binary.op.bool_op == BINARY_BOOL_OP_AND) {
+            pushdown_and(p, right);
+        } else {
+            pushdown_or(p, right);
+        }
+
+        free(right);
+        break;
+    case AST_NODE_TYPE_BIN_STR_OP:
+        if (node->data.binary.op.str_op != BINARY_STR_OP_EQ &&
+            node->data.binary.op.str_op != BINARY_STR_OP_ASSIGN)
+        {
+            break;
+        }
+
+        kind = pushdown_field_kind(node->data.binary.left);
+        if (kind == PUSHDOWN_FIELD_NONE) {
+            break;
+        }
+
+        pushdown_clear(p, kind);
+        pushdown_add_value(p, kind, node->data.binary.right);
+        break;
+    case AST_NODE_TYPE_BIN_LIST_OP:
+        if (node->data.binary.op.list_op != BINARY_LIST_OP_IN ||
+            node->data.binary.right == NULL ||
+            node->data.binary.right->type != AST_NODE_TYPE_LIST)
+        {
+            break;
+        }
+
+        kind = pushdown_field_kind(node->data.binary.left);
+        if (kind == PUSHDOWN_FIELD_NONE) {
+            break;
+        }
+
+        pushdown_clear(p, kind);
+        for (int i = 0; i < node->data.binary.right->data.list.count; ++i) {
+            pushdown_add_value(p, kind, node->data.binary.right->data.list.items[i]);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+int linx_rule_pushdown_init(void)
+{
+    if (s_pushdown) {
+        return 0;
+    }
+
+    /* 并集的初始值为空集 */
+    s_pushdown = calloc(1, sizeof(linx_rule_pushdown_t));
+    if (!s_pushdown) {
+        return -1;
+    }
+
+    s_nrules = 0;
+
+    return 0;
+}
+
+void linx_rule_pushdown_deinit(void)
+{
+    if (!s_pushdown) {
+        return;
+    }
+
+    free(s_pushdown);
+    s_pushdown = NULL;
+    s_nrules = 0;
+}
+
+void linx_rule_pushdown_add(ast_node_t *ast)
+{
+    linx_rule_pushdown_t *rule;
+
+    if (!s_pushdown) {
+        return;
+    }
+
+    rule = malloc(sizeof(linx_rule_pushdown_t));
+    if (!rule) {
+        pushdown_set_all(s_pushdown);
+        return;
+    }
+
+    /* 转换失败的规则没有 ast，视为没有约束 */
+    pushdown_analyze(ast, rule);
+
+    if (pushdown_has_ancestor_field(ast)) {
+        rule->all_comms = true;
+        rule->all_uids = true;
+    }
+
+    pushdown_or(s_pushdown, rule);
+    s_nrules++;
+
+    free(rule);
+}
+
+/**
+ * 单条规则能匹配的事件类型，规则集据此按事件类型分桶
+ * 返回 false 表示没有约束，该规则需要匹配所有事件
+*/
+bool linx_rule_pushdown_event_types(ast_node_t *ast, uint8_t types[LINX_EVENT_TYPE_MAX])
+{
+    linx_rule_pushdown_t *rule;
+    bool constrained;
+
+    if (ast == NULL) {
+        return false;
+    }
+
+    rule = malloc(sizeof(linx_rule_pushdown_t));
+    if (!rule) {
+        return false;
+    }
+
+    pushdown_analyze(ast, rule);
+
+    constrained = !rule->all_types;
+    if (constrained) {
+        memcpy(types, rule->types, sizeof(rule->types));
+    }
+
+    free(rule);
+
+    return constrained;
+}
+
+static bool pushdown_config_has_comm(linx_global_config_t *config, const char *comm)
+{
+    for (int i = 0;
+         i < LINX_BPF_FILTER_COMM_MAX_SIZE &&
+         config->engine.data.ebpf.filter_comms[i][0] != 0;
+         ++i)
+    {
+        if (strcmp((char *)config->engine.data.ebpf.filter_comms[i], comm) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool pushdown_config_has_uid(linx_global_config_t *config, uint32_t uid)
+{
+    for (uint32_t i = 0; i < config->engine.data.ebpf.filter_uid_count; ++i) {
+        if (config->engine.data.ebpf.filter_uids[i] == uid) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * 规则得到的 comm 集合与配置中的过滤表合并后，以 include 的方式下发
+ * exclude 配置从集合中去掉，include 配置与集合取交集
+*/
+static void pushdown_apply_comms(linx_global_config_t *config)
+{
+    char comms[LINX_BPF_FILTER_COMM_MAX_SIZE][LINX_COMM_MAX_SIZE];
+    uint32_t n = 0;
+    bool found;
+
+    for (uint32_t i = 0; i < s_pushdown->ncomms; ++i) {
+        found = pushdown_config_has_comm(config, s_pushdown->comms[i]);
+        if (found == (config->engine.data.ebpf.filter_comm_mode == LINX_FILTER_MODE_INCLUDE)) {
+            memcpy(comms[n++], s_pushdown->comms[i], LINX_COMM_MAX_SIZE);
+        }
+    }
+
+    memset(config->engine.data.ebpf.filter_comms, 0, sizeof(config->engine.data.ebpf.filter_comms));
+    memcpy(config->engine.data.ebpf.filter_comms, comms, n * LINX_COMM_MAX_SIZE);
+    config->engine.data.ebpf.filter_comm_mode = LINX_FILTER_MODE_INCLUDE;
+
+    if (n == 0) {
+        LINX_LOG_WARNING("rule pushdown: no process name can match any rule");
+    }
+}
+
+static void pushdown_apply_uids(linx_global_config_t *config)
+{
+    uint32_t uids[LINX_BPF_FILTER_UID_MAX_SIZE];
+    uint32_t n = 0;
+    bool found;
+
+    for (uint32_t i = 0; i < s_pushdown->nuids; ++i) {
+        found = pushdown_config_has_uid(config, s_pushdown->uids[i]);
+        if (found == (config->engine.data.ebpf.filter_uid_mode == LINX_FILTER_MODE_INCLUDE)) {
+            uids[n++] = s_pushdown->uids[i];
+        }
+    }
+
+    memcpy(config->engine.data.ebpf.filter_uids, uids, n * sizeof(uint32_t));
+    config->engine.data.ebpf.filter_uid_count = n;
+    config->engine.data.ebpf.filter_uid_mode = LINX_FILTER_MODE_INCLUDE;
+
+    if (n == 0) {
+        LINX_LOG_WARNING("rule pushdown: no uid can match any rule");
+    }
+}
+
+int linx_rule_pushdown_apply(linx_global_config_t *config)
+{
+    uint32_t nsyscalls = 0;
+
+    if (!s_pushdown) {
+        return 0;
+    }
+
+    if (strcmp(config->engine.kind, "ebpf") != 0) {
+        goto out;
+    }
+
+    /* 没有加载规则时保留 interest_syscall_file 的配置，但进程缓存需要的系统调用必须采集 */
+    if (!config->engine.data.ebpf.rule_pushdown || s_nrules == 0) {
+        for (int i = 0; i < LINX_SYSCALL_ID_MAX; ++i) {
+            if (linx_syscall_is_proc_lifecycle(i)) {
+                config->engine.data.ebpf.interest_syscall_table[i] = 1;
+            }
+        }
+        goto out;
+    }
+
+    /* 系统调用 i 对应的进入和退出事件为 2i 和 2i + 1 */
+    for (int i = 0; i < LINX_SYSCALL_ID_MAX; ++i) {
+        config->engine.data.ebpf.interest_syscall_table[i] =
+            s_pushdown->all_types || linx_syscall_is_proc_lifecycle(i) ?
+            1 : (s_pushdown->types[i * 2] | s_pushdown->types[i * 2 + 1]);
+        nsyscalls += config->engine.data.ebpf.interest_syscall_table[i];
+    }
+
+    if (!s_pushdown->all_comms) {
+        pushdown_apply_comms(config);
+    }
+
+    if (!s_pushdown->all_uids) {
+        pushdown_apply_uids(config);
+    }
+
+    LINX_LOG_INFO("rule pushdown: %zu rules need %u syscalls, comm filter %s, uid filter %s",
+                  s_nrules, nsyscalls,
+                  s_pushdown->all_comms ? "off" : "on",
+                  s_pushdown->all_uids ? "off" : "on");
+
+out:
+    linx_rule_pushdown_deinit();
+    return 0;
+}
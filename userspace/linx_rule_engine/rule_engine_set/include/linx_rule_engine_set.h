@@ -2,10 +2,21 @@
 #define __LINX_RULE_ENGINE_SET_H__ 
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include "linx_event_type.h"
 #include "linx_rule_engine_load.h"
 #include "linx_rule_engine_match.h"
 
+/**
+ * 一组规则在规则集中的下标，按加载顺序递增
+*/
+typedef struct {
+    uint32_t *rules;
+    uint32_t size;
+    uint32_t capacity;
+} linx_rule_bucket_t;
+
 typedef struct {
     struct {
         linx_rule_t **rules;
@@ -15,6 +26,13 @@ typedef struct {
 
     size_t size;
     size_t capacity;
+
+    /**
+     * 规则按条件能匹配的事件类型分桶，没有 evt.type 约束的规则放在 catch_all 中
+     * 每个事件只需要匹配对应桶和 catch_all 中的规则
+    */
+    linx_rule_bucket_t buckets[LINX_EVENT_TYPE_MAX];
+    linx_rule_bucket_t catch_all;
 } linx_rule_set_t;
 
 int linx_rule_set_init(void);
@@ -23,8 +41,9 @@ void linx_rule_set_deinit(void);
 
 linx_rule_set_t *linx_rule_set_get(void);
 
-int linx_rule_set_add(linx_rule_t *rule, linx_rule_match_t *match, linx_output_match_t *output);
+int linx_rule_set_add(linx_rule_t *rule, linx_rule_match_t *match, linx_output_match_t *output,
+                      const uint8_t *types);
 
-bool linx_rule_set_match_rule(void);
+bool linx_rule_set_match_rule(linx_field_ctx_t *fields, linx_rule_memo_t *memo);
 
 #endif /* __LINX_RULE_ENGINE_SET_H__ */
@@ -3,23 +3,19 @@
 
 #include "linx_rule_engine_set.h"
 #include "linx_alert.h"
+#include "rule_match_pred.h"
+#include "linx_regex.h"
 
 static linx_rule_set_t *rule_set = NULL;
 
 int linx_rule_set_init(void)
 {
-    rule_set = malloc(sizeof(linx_rule_set_t));
+    /* 所有桶初始为空 */
+    rule_set = calloc(1, sizeof(linx_rule_set_t));
     if (rule_set == NULL) {
         return -1;
     }
 
-    rule_set->capacity = 0;
-    rule_set->size = 0;
-
-    rule_set->data.rules = NULL;
-    rule_set->data.matches = NULL;
-    rule_set->data.outputs = NULL;
-
     return 0;
 }
 
@@ -35,8 +31,19 @@ void linx_rule_set_deinit(void)
         linx_output_match_destroy(rule_set->data.outputs[i]);
     }
 
+    for (int i = 0; i < LINX_EVENT_TYPE_MAX; i++) {
+        free(rule_set->buckets[i].rules);
+    }
+
+    free(rule_set->catch_all.rules);
+    free(rule_set->data.rules);
+    free(rule_set->data.matches);
+    free(rule_set->data.outputs);
     free(rule_set);
     rule_set = NULL;
+
+    linx_rule_pred_deinit();
+    linx_regex_deinit();
 }
 
 linx_rule_set_t *linx_rule_set_get(void)
@@ -79,8 +86,37 @@ static int linx_rule_set_resize(void)
     return 0;
 }
 
-int linx_rule_set_add(linx_rule_t *rule, linx_rule_match_t *match, linx_output_match_t *output)
+static int linx_rule_bucket_add(linx_rule_bucket_t *bucket, uint32_t index)
+{
+    uint32_t new_capacity;
+    uint32_t *new_rules;
+
+    if (bucket->size >= bucket->capacity) {
+        new_capacity = bucket->capacity == 0 ? 4 : bucket->capacity * 2;
+
+        new_rules = realloc(bucket->rules, new_capacity * sizeof(uint32_t));
+        if (new_rules == NULL) {
+            return -1;
+        }
+
+        bucket->rules = new_rules;
+        bucket->capacity = new_capacity;
+    }
+
+    bucket->rules[bucket->size++] = index;
+
+    return 0;
+}
+
+/**
+ * types 为规则能匹配的事件类型，NULL 表示没有约束
+*/
+int linx_rule_set_add(linx_rule_t *rule, linx_rule_match_t *match, linx_output_match_t *output,
+                      const uint8_t *types)
 {
+    uint32_t index;
+    int ret = 0;
+
     if (rule_set == NULL || rule == NULL || 
         match == NULL || output == NULL) 
     {
@@ -93,38 +129,75 @@ int linx_rule_set_add(linx_rule_t *rule, linx_rule_match_t *match, linx_output_m
         }
     }
 
-    rule_set->data.rules[rule_set->size] = rule;
-    rule_set->data.matches[rule_set->size] = match;
-    rule_set->data.outputs[rule_set->size] = output;
+    index = (uint32_t)rule_set->size;
+
+    rule_set->data.rules[index] = rule;
+    rule_set->data.matches[index] = match;
+    rule_set->data.outputs[index] = output;
 
     rule_set->size++;
 
-    return 0;
+    if (types == NULL) {
+        ret = linx_rule_bucket_add(&rule_set->catch_all, index);
+    } else {
+        for (int i = 0; i < LINX_EVENT_TYPE_MAX && !ret; i++) {
+            if (types[i]) {
+                ret = linx_rule_bucket_add(&rule_set->buckets[i], index);
+            }
+        }
+    }
+
+    return ret;
 }
 
-bool linx_rule_set_match_rule(void)
+static bool linx_rule_set_match_one(uint32_t index, linx_field_ctx_t *fields, linx_rule_memo_t *memo)
 {
-    bool match = false;
+    linx_rule_match_t *match = rule_set->data.matches[index];
 
-    if (rule_set == NULL) {
+    if (!match || !linx_rule_engine_match(match, fields, memo)) {
         return false;
     }
 
-    for (size_t i = 0; i < rule_set->size; i++) {
-        if (rule_set->data.matches[i]) {
-            if (rule_set->data.matches[i]->func(rule_set->data.matches[i]->context)) {
-                match = true;
-                
-                linx_alert_send_async(rule_set->data.outputs[i], rule_set->data.rules[i]->name, 0);
-                /**
-                 * 这里有一个yaml配置可以控制匹配到规则后是否继续匹配后面的规则
-                 * 计划在后续添加 
-                 * 这里还要添加一个匹配成功然后输出消息的逻辑
-                */
-                break;
-            }
+    linx_alert_send_async(rule_set->data.outputs[index], fields, rule_set->data.rules[index]->name, 0);
+
+    return true;
+}
+
+/**
+ * memo 为匹配线程持有的谓词缓存，多条规则中相同的谓词对一个事件只计算一次
+*/
+bool linx_rule_set_match_rule(linx_field_ctx_t *fields, linx_rule_memo_t *memo)
+{
+    linx_rule_bucket_t *bucket, *catch_all;
+    uint32_t i = 0, j = 0, index;
+
+    if (rule_set == NULL || fields->event_type >= LINX_EVENT_TYPE_MAX) {
+        return false;
+    }
+
+    bucket = &rule_set->buckets[fields->event_type];
+    catch_all = &rule_set->catch_all;
+
+    linx_rule_memo_reset(memo);
+
+    /* 两个桶中的下标都是递增的，按下标合并，保证先加载的规则先匹配 */
+    while (i < bucket->size || j < catch_all->size) {
+        if (j >= catch_all->size ||
+            (i < bucket->size && bucket->rules[i] < catch_all->rules[j]))
+        {
+            index = bucket->rules[i++];
+        } else {
+            index = catch_all->rules[j++];
+        }
+
+        if (linx_rule_set_match_one(index, fields, memo)) {
+            /**
+             * 这里有一个yaml配置可以控制匹配到规则后是否继续匹配后面的规则
+             * 计划在后续添加
+            */
+            return true;
         }
     }
 
-    return match;
+    return false;
 }
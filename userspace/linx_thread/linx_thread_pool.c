@@ -155,6 +155,7 @@ linx_thread_pool_t *linx_thread_pool_create(int num_threads)
     pool->queue_size = 0;
     pool->task_queue_head = NULL;
     pool->task_queue_tail = NULL;
+    pool->task_runing = NULL;
     pool->shutdown = 0;
 
     /* 分配线程信息数组内存 */